@@ -653,7 +653,7 @@ public:
         switch (rhs.GetType()) {
         case kObjectType: {
                 SizeType count = rhs.data_.o.size;
-                Member* lm = reinterpret_cast<Member*>(allocator.Malloc(count * sizeof(Member)));
+                Member* lm = AllocateMembers(count, allocator);
                 const typename GenericValue<Encoding,SourceAllocator>::Member* rm = rhs.GetMembersPointer();
                 for (SizeType i = 0; i < count; i++) {
                     new (&lm[i].name) GenericValue(rm[i].name, allocator, copyConstStrings);
@@ -662,6 +662,9 @@ public:
                 data_.f.flags = kObjectFlag;
                 data_.o.size = data_.o.capacity = count;
                 SetMembersPointer(lm);
+#if RAPIDJSON_USE_MEMBERSINDEX
+                UpdateMembersIndex(allocator);
+#endif
             }
             break;
         case kArrayType: {
@@ -812,7 +815,7 @@ public:
             case kObjectFlag:
                 for (MemberIterator m = MemberBegin(); m != MemberEnd(); ++m)
                     m->~Member();
-                Allocator::Free(GetMembersPointer());
+                FreeMembers(GetMembersPointer());
                 break;
 
             case kCopyStringFlag:
@@ -1178,7 +1181,7 @@ public:
     GenericValue& MemberReserve(SizeType newCapacity, Allocator &allocator) {
         RAPIDJSON_ASSERT(IsObject());
         if (newCapacity > data_.o.capacity) {
-            SetMembersPointer(reinterpret_cast<Member*>(allocator.Realloc(GetMembersPointer(), data_.o.capacity * sizeof(Member), newCapacity * sizeof(Member))));
+            SetMembersPointer(ReallocateMembers(GetMembersPointer(), data_.o.capacity, newCapacity, allocator));
             data_.o.capacity = newCapacity;
         }
         return *this;
@@ -1248,12 +1251,28 @@ public:
         \note Earlier versions of Rapidjson returned a \c NULL pointer, in case
             the requested member doesn't exist. For consistency with e.g.
             \c std::map, this has been changed to MemberEnd() now.
-        \note Linear time complexity.
+        \note Linear time complexity, or expected constant time for objects
+            with a members index (see \ref RAPIDJSON_USE_MEMBERSINDEX).
     */
     template <typename SourceAllocator>
     MemberIterator FindMember(const GenericValue<Encoding, SourceAllocator>& name) {
         RAPIDJSON_ASSERT(IsObject());
         RAPIDJSON_ASSERT(name.IsString());
+#if RAPIDJSON_USE_MEMBERSINDEX
+        if (Member* members = GetMembersPointer()) {
+            const MembersIndex* index = GetMembersIndex(members);
+            if (index->bucketCount) {
+                const SizeType hash = HashMemberName(name.GetString(), name.GetStringLength());
+                const SizeType mask = index->bucketCount - 1;
+                for (SizeType b = hash & mask; index->buckets[b].position != 0; b = (b + 1) & mask) {
+                    Member* m = members + (index->buckets[b].position - 1);
+                    if (index->buckets[b].hash == hash && name.StringEqual(m->name))
+                        return MemberIterator(m);
+                }
+                return MemberEnd();
+            }
+        }
+#endif
         MemberIterator member = MemberBegin();
         for ( ; member != MemberEnd(); ++member)
             if (name.StringEqual(member->name))
@@ -1295,6 +1314,13 @@ public:
         members[o.size].name.RawAssign(name);
         members[o.size].value.RawAssign(value);
         o.size++;
+#if RAPIDJSON_USE_MEMBERSINDEX
+        if (!UpdateMembersIndex(allocator)) {
+            MembersIndex* index = GetMembersIndex(members);
+            if (index->bucketCount)
+                InsertMembersIndexEntry(index, HashMemberName(members[o.size - 1].name.GetString(), members[o.size - 1].name.GetStringLength()), o.size - 1);
+        }
+#endif
         return *this;
     }
 
@@ -1431,6 +1457,9 @@ public:
         for (MemberIterator m = MemberBegin(); m != MemberEnd(); ++m)
             m->~Member();
         data_.o.size = 0;
+#if RAPIDJSON_USE_MEMBERSINDEX
+        ReindexMembers();
+#endif
     }
 
     //! Remove a member in object by its name.
@@ -1475,6 +1504,9 @@ public:
         RAPIDJSON_ASSERT(GetMembersPointer() != 0);
         RAPIDJSON_ASSERT(m >= MemberBegin() && m < MemberEnd());
 
+#if RAPIDJSON_USE_MEMBERSINDEX
+        UnindexMember(static_cast<SizeType>(m - MemberBegin()));
+#endif
         MemberIterator last(GetMembersPointer() + (data_.o.size - 1));
         if (data_.o.size > 1 && m != last)
             *m = *last; // Move the last one to this place
@@ -1519,6 +1551,9 @@ public:
             itr->~Member();
         std::memmove(static_cast<void*>(&*pos), &*last, static_cast<size_t>(MemberEnd() - last) * sizeof(Member));
         data_.o.size -= static_cast<SizeType>(last - first);
+#if RAPIDJSON_USE_MEMBERSINDEX
+        ReindexMembers();
+#endif
         return pos;
     }
 
@@ -2030,6 +2065,157 @@ private:
     RAPIDJSON_FORCEINLINE Member* GetMembersPointer() const { return RAPIDJSON_GETPOINTER(Member, data_.o.members); }
     RAPIDJSON_FORCEINLINE Member* SetMembersPointer(Member* members) { return RAPIDJSON_SETPOINTER(Member, data_.o.members, members); }
 
+#if RAPIDJSON_USE_MEMBERSINDEX
+    //! Slot of the open-addressing members index.
+    struct MembersIndexEntry {
+        SizeType hash;      //!< Hash of the member name.
+        SizeType position;  //!< Position of the member in the object plus one, 0 for an empty slot.
+    };
+
+    //! Header stored in front of every members block.
+    struct MembersIndex {
+        SizeType bucketCount;           //!< Number of slots (power of two), 0 if the object is not indexed.
+        MembersIndexEntry* buckets;     //!< Linear probing hash table, allocated with the value's allocator.
+    };
+
+    static size_t GetMembersHeaderSize() { return RAPIDJSON_ALIGN(sizeof(MembersIndex)); }
+
+    static MembersIndex* GetMembersIndex(Member* members) {
+        return reinterpret_cast<MembersIndex*>(reinterpret_cast<char*>(members) - GetMembersHeaderSize());
+    }
+
+    //! FNV-1a hash of a member name.
+    static SizeType HashMemberName(const Ch* str, SizeType length) {
+        return internal::StrHash(str, length);
+    }
+
+    static void InsertMembersIndexEntry(MembersIndex* index, SizeType hash, SizeType position) {
+        const SizeType mask = index->bucketCount - 1;
+        SizeType b = hash & mask;
+        while (index->buckets[b].position != 0)
+            b = (b + 1) & mask;
+        index->buckets[b].hash = hash;
+        index->buckets[b].position = position + 1;
+    }
+
+    //! Finds the slot referring to the member at \c position.
+    static SizeType FindMembersIndexEntry(const MembersIndex* index, SizeType hash, SizeType position) {
+        const SizeType mask = index->bucketCount - 1;
+        SizeType b = hash & mask;
+        while (index->buckets[b].position != position + 1) {
+            RAPIDJSON_ASSERT(index->buckets[b].position != 0);
+            b = (b + 1) & mask;
+        }
+        return b;
+    }
+
+    //! Empties a slot, shifting back the following entries of the probe sequence (no tombstones).
+    static void EraseMembersIndexEntry(MembersIndex* index, SizeType hole) {
+        const SizeType mask = index->bucketCount - 1;
+        for (SizeType b = (hole + 1) & mask; index->buckets[b].position != 0; b = (b + 1) & mask) {
+            const SizeType home = index->buckets[b].hash & mask;
+            // The entry may fill the hole only if the hole lies between its home slot and its current slot.
+            if (((b - home) & mask) >= ((b - hole) & mask)) {
+                index->buckets[hole] = index->buckets[b];
+                hole = b;
+            }
+        }
+        index->buckets[hole].position = 0;
+    }
+
+    static void RebuildMembersIndex(MembersIndex* index, const Member* members, SizeType count) {
+        std::memset(static_cast<void*>(index->buckets), 0, index->bucketCount * sizeof(MembersIndexEntry));
+        for (SizeType i = 0; i < count; i++)
+            InsertMembersIndexEntry(index, HashMemberName(members[i].name.GetString(), members[i].name.GetStringLength()), i);
+    }
+
+    //! Builds or grows the members index when the object needs one.
+    /*! The table is sized for the current capacity at a load factor of at most one half.
+        \return true if the index was (re)built, i.e. it already contains every member.
+    */
+    bool UpdateMembersIndex(Allocator& allocator) {
+        Member* members = GetMembersPointer();
+        if (!members)
+            return false;
+        MembersIndex* index = GetMembersIndex(members);
+        const SizeType size = data_.o.size;
+        if (index->bucketCount == 0 ? size < RAPIDJSON_MEMBERSINDEX_THRESHOLD : size * 2 <= index->bucketCount)
+            return false;
+
+        SizeType bucketCount = 16;
+        while (bucketCount < data_.o.capacity * 2)
+            bucketCount *= 2;
+        Allocator::Free(index->buckets);
+        index->buckets = static_cast<MembersIndexEntry*>(allocator.Malloc(bucketCount * sizeof(MembersIndexEntry)));
+        index->bucketCount = bucketCount;
+        RebuildMembersIndex(index, members, size);
+        return true;
+    }
+
+    //! Re-inserts all members after they were moved or removed.
+    void ReindexMembers() {
+        if (Member* members = GetMembersPointer()) {
+            MembersIndex* index = GetMembersIndex(members);
+            if (index->bucketCount)
+                RebuildMembersIndex(index, members, data_.o.size);
+        }
+    }
+
+    //! Removes the member at \c position from the index; the last member takes its place.
+    void UnindexMember(SizeType position) {
+        Member* members = GetMembersPointer();
+        MembersIndex* index = GetMembersIndex(members);
+        if (!index->bucketCount)
+            return;
+        const Member& m = members[position];
+        EraseMembersIndexEntry(index, FindMembersIndexEntry(index, HashMemberName(m.name.GetString(), m.name.GetStringLength()), position));
+        const SizeType last = data_.o.size - 1;
+        if (position != last) {
+            const Member& l = members[last];
+            index->buckets[FindMembersIndexEntry(index, HashMemberName(l.name.GetString(), l.name.GetStringLength()), last)].position = position + 1;
+        }
+    }
+#endif // RAPIDJSON_USE_MEMBERSINDEX
+
+    //! Allocates a members block, including the members index header if enabled.
+    static Member* AllocateMembers(SizeType capacity, Allocator& allocator) {
+#if RAPIDJSON_USE_MEMBERSINDEX
+        if (!capacity)
+            return 0;
+        char* block = static_cast<char*>(allocator.Malloc(GetMembersHeaderSize() + capacity * sizeof(Member)));
+        MembersIndex* index = reinterpret_cast<MembersIndex*>(block);
+        index->bucketCount = 0;
+        index->buckets = 0;
+        return reinterpret_cast<Member*>(block + GetMembersHeaderSize());
+#else
+        return static_cast<Member*>(allocator.Malloc(capacity * sizeof(Member)));
+#endif
+    }
+
+    static Member* ReallocateMembers(Member* members, SizeType oldCapacity, SizeType newCapacity, Allocator& allocator) {
+#if RAPIDJSON_USE_MEMBERSINDEX
+        if (!members)
+            return AllocateMembers(newCapacity, allocator);
+        char* block = static_cast<char*>(allocator.Realloc(GetMembersIndex(members),
+            GetMembersHeaderSize() + oldCapacity * sizeof(Member), GetMembersHeaderSize() + newCapacity * sizeof(Member)));
+        return reinterpret_cast<Member*>(block + GetMembersHeaderSize());
+#else
+        return static_cast<Member*>(allocator.Realloc(members, oldCapacity * sizeof(Member), newCapacity * sizeof(Member)));
+#endif
+    }
+
+    static void FreeMembers(Member* members) {
+#if RAPIDJSON_USE_MEMBERSINDEX
+        if (members) {
+            MembersIndex* index = GetMembersIndex(members);
+            Allocator::Free(index->buckets);
+            Allocator::Free(index);
+        }
+#else
+        Allocator::Free(members);
+#endif
+    }
+
     // Initialize this value as array with initial data, without calling destructor.
     void SetArrayRaw(GenericValue* values, SizeType count, Allocator& allocator) {
         data_.f.flags = kArrayFlag;
@@ -2047,13 +2233,16 @@ private:
     void SetObjectRaw(Member* members, SizeType count, Allocator& allocator) {
         data_.f.flags = kObjectFlag;
         if (count) {
-            Member* m = static_cast<Member*>(allocator.Malloc(count * sizeof(Member)));
+            Member* m = AllocateMembers(count, allocator);
             SetMembersPointer(m);
             std::memcpy(static_cast<void*>(m), members, count * sizeof(Member));
         }
         else
             SetMembersPointer(0);
         data_.o.size = data_.o.capacity = count;
+#if RAPIDJSON_USE_MEMBERSINDEX
+        UpdateMembersIndex(allocator);
+#endif
     }
 
     //! Initialize this value as constant string, without calling destructor.
@@ -2109,6 +2298,175 @@ private:
 //! GenericValue with UTF8 encoding
 typedef GenericValue<UTF8<> > Value;
 
+///////////////////////////////////////////////////////////////////////////////
+// GenericKeyPool
+
+//! A pool of interned member names, which can be shared by documents.
+/*! Arrays of homogeneous objects repeat the same member names. When a pool is
+    set with GenericDocument::SetKeyPool(), parsing stores each distinct name
+    which is too long for the short string optimization once in the pool, and
+    the members refer to it as a constant string. This saves an allocation and
+    a copy per member, and comparing two names from the same pool is a pointer
+    comparison (see GenericValue::FindMember()).
+
+    \code
+    KeyPool keys;
+    for (...) {
+        Document d;
+        d.SetKeyPool(&keys);
+        d.Parse(json);
+        // Null if no document had the name, or it came after the pool was full.
+        if (const char* name = keys.Find("customer_identifier")) {
+            Value::ConstMemberIterator m = d.FindMember(Value(name, 19));
+            ...
+        }
+    }
+    \endcode
+
+    Looking up the pooled string compares pooled names by pointer;
+    \c d.FindMember("customer_identifier") finds the same member by comparing
+    the characters.
+
+    The strings are never freed before the pool, so it must outlive all
+    documents and values referring to them. The number of strings is bounded
+    by \c maxSize, further names are copied into the documents as usual, so
+    that untrusted input cannot grow a shared pool without bound.
+
+    \tparam Encoding Encoding of the names.
+    \tparam Allocator Allocator type for the strings and the hash table.
+    \note A pool is not thread-safe. Use a pool per thread, or synchronize parsing.
+*/
+template <typename Encoding, typename Allocator = MemoryPoolAllocator<> >
+class GenericKeyPool {
+public:
+    typedef typename Encoding::Ch Ch;   //!< Character type derived from Encoding.
+
+    //! Constructor.
+    /*! \param allocator Optional allocator for the strings and the table. If no allocator is provided, it creates a self-owned one.
+        \param maxSize Maximum number of strings in the pool.
+    */
+    explicit GenericKeyPool(Allocator* allocator = 0, SizeType maxSize = kDefaultMaxSize) :
+        allocator_(allocator), ownAllocator_(), entries_(), capacity_(), size_(), maxSize_(maxSize)
+    {
+        if (!allocator_)
+            ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
+    }
+
+    //! Destructor, the interned strings become invalid.
+    ~GenericKeyPool() {
+        if (Allocator::kNeedFree) {
+            for (SizeType i = 0; i < capacity_; i++)
+                Allocator::Free(const_cast<Ch*>(entries_[i].str));
+            Allocator::Free(entries_);
+        }
+        RAPIDJSON_DELETE(ownAllocator_);
+    }
+
+    //! Get the interned copy of a string, adding it if needed.
+    /*! \return Null-terminated string owned by the pool, or null if the pool is full.
+    */
+    const Ch* Intern(const Ch* str, SizeType length) {
+        const SizeType hash = Hash(str, length);
+        if (capacity_ != 0) {
+            const Entry* e = entries_ + Probe(str, length, hash);
+            if (e->str)
+                return e->str;
+        }
+        if (size_ >= maxSize_)
+            return 0;
+        if (size_ * 2 >= capacity_)
+            Grow();
+
+        Entry* e = entries_ + Probe(str, length, hash);
+        Ch* copy = static_cast<Ch*>(allocator_->Malloc((length + 1) * sizeof(Ch)));
+        std::memcpy(copy, str, length * sizeof(Ch));
+        copy[length] = '\0';
+        e->str = copy;
+        e->length = length;
+        e->hash = hash;
+        size_++;
+        return copy;
+    }
+
+    //! Get the interned copy of a string, or null if it is not in the pool.
+    const Ch* Find(const Ch* str, SizeType length) const {
+        return capacity_ != 0 ? entries_[Probe(str, length, Hash(str, length))].str : 0;
+    }
+
+    //! Get the interned copy of a null-terminated string, or null if it is not in the pool.
+    const Ch* Find(const Ch* str) const { return Find(str, internal::StrLen(str)); }
+
+    //! Get the number of strings in the pool.
+    SizeType GetSize() const { return size_; }
+
+private:
+    struct Entry {
+        const Ch* str;  //!< Interned string, null for an empty slot.
+        SizeType length;
+        SizeType hash;
+    };
+
+    static const SizeType kDefaultMaxSize = 65536;
+
+    // Prohibit copying
+    GenericKeyPool(const GenericKeyPool&);
+    GenericKeyPool& operator=(const GenericKeyPool&);
+
+    //! Hash of a name, 8 bytes at a time.
+    static SizeType Hash(const Ch* str, SizeType length) {
+        const char* p = reinterpret_cast<const char*>(str);
+        size_t n = length * sizeof(Ch);
+        uint64_t h = n;
+        for (; n >= 8; n -= 8, p += 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            h = (h ^ w) * RAPIDJSON_UINT64_C2(0x9E3779B9, 0x7F4A7C15);
+        }
+        uint64_t w = 0;
+        std::memcpy(&w, p, n);
+        h = (h ^ w) * RAPIDJSON_UINT64_C2(0x9E3779B9, 0x7F4A7C15);
+        return static_cast<SizeType>(h >> 32);
+    }
+
+    //! Linear probing for the slot of a string, or the empty slot where it would be inserted.
+    SizeType Probe(const Ch* str, SizeType length, SizeType hash) const {
+        const SizeType mask = capacity_ - 1;
+        SizeType b = hash & mask;
+        for (; entries_[b].str; b = (b + 1) & mask)
+            if (entries_[b].hash == hash && entries_[b].length == length && std::memcmp(entries_[b].str, str, length * sizeof(Ch)) == 0)
+                break;
+        return b;
+    }
+
+    void Grow() {
+        const SizeType oldCapacity = capacity_;
+        Entry* old = entries_;
+        capacity_ = capacity_ == 0 ? 64 : capacity_ * 2;
+        entries_ = static_cast<Entry*>(allocator_->Malloc(capacity_ * sizeof(Entry)));
+        std::memset(static_cast<void*>(entries_), 0, capacity_ * sizeof(Entry));
+        const SizeType mask = capacity_ - 1;
+        for (SizeType i = 0; i < oldCapacity; i++) {
+            if (old[i].str) {
+                SizeType b = old[i].hash & mask;
+                while (entries_[b].str)
+                    b = (b + 1) & mask;
+                entries_[b] = old[i];
+            }
+        }
+        Allocator::Free(old);
+    }
+
+    Allocator* allocator_;
+    Allocator* ownAllocator_;
+    Entry* entries_;        //!< Hash table, at most half full.
+    SizeType capacity_;     //!< Number of slots, a power of two.
+    SizeType size_;         //!< Number of strings.
+    SizeType maxSize_;
+};
+
+//! GenericKeyPool with UTF8 encoding
+typedef GenericKeyPool<UTF8<> > KeyPool;
+
 ///////////////////////////////////////////////////////////////////////////////
 // GenericDocument 
 
@@ -2126,6 +2484,7 @@ public:
     typedef typename Encoding::Ch Ch;                       //!< Character type derived from Encoding.
     typedef GenericValue<Encoding, Allocator> ValueType;    //!< Value type of the document.
     typedef Allocator AllocatorType;                        //!< Allocator type from template parameter.
+    typedef GenericKeyPool<Encoding, Allocator> KeyPoolType; //!< Key pool type for SetKeyPool().
 
     //! Constructor
     /*! Creates an empty document of specified type.
@@ -2135,7 +2494,7 @@ public:
         \param stackAllocator   Optional allocator for allocating memory for stack.
     */
     explicit GenericDocument(Type type, Allocator* allocator = 0, size_t stackCapacity = kDefaultStackCapacity, StackAllocator* stackAllocator = 0) :
-        GenericValue<Encoding, Allocator>(type),  allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_()
+        GenericValue<Encoding, Allocator>(type),  allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_(), keyPool_()
     {
         if (!allocator_)
             ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
@@ -2148,7 +2507,7 @@ public:
         \param stackAllocator   Optional allocator for allocating memory for stack.
     */
     GenericDocument(Allocator* allocator = 0, size_t stackCapacity = kDefaultStackCapacity, StackAllocator* stackAllocator = 0) : 
-        allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_()
+        allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_(), keyPool_()
     {
         if (!allocator_)
             ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
@@ -2161,7 +2520,8 @@ public:
           allocator_(rhs.allocator_),
           ownAllocator_(rhs.ownAllocator_),
           stack_(std::move(rhs.stack_)),
-          parseResult_(rhs.parseResult_)
+          parseResult_(rhs.parseResult_),
+          keyPool_(rhs.keyPool_)
     {
         rhs.allocator_ = 0;
         rhs.ownAllocator_ = 0;
@@ -2188,6 +2548,7 @@ public:
         ownAllocator_ = rhs.ownAllocator_;
         stack_ = std::move(rhs.stack_);
         parseResult_ = rhs.parseResult_;
+        keyPool_ = rhs.keyPool_;
 
         rhs.allocator_ = 0;
         rhs.ownAllocator_ = 0;
@@ -2209,6 +2570,7 @@ public:
         internal::Swap(allocator_, rhs.allocator_);
         internal::Swap(ownAllocator_, rhs.ownAllocator_);
         internal::Swap(parseResult_, rhs.parseResult_);
+        internal::Swap(keyPool_, rhs.keyPool_);
         return *this;
     }
 
@@ -2417,6 +2779,18 @@ public:
     //! Get the capacity of stack in bytes.
     size_t GetStackCapacity() const { return stack_.GetCapacity(); }
 
+    //! Set a pool to intern the member names with during parsing.
+    /*! Names which need to be copied and are too long for the short string
+        optimization are stored as constant strings referring to the pool.
+        \param keyPool The pool, which must outlive the document. Null to copy names into the document.
+        \return The document itself for fluent API.
+        \see GenericKeyPool
+    */
+    GenericDocument& SetKeyPool(KeyPoolType* keyPool) { keyPool_ = keyPool; return *this; }
+
+    //! Get the pool of member names, null if there is none.
+    KeyPoolType* GetKeyPool() const { return keyPool_; }
+
 private:
     // clear stack on any exit from ParseStream, e.g. due to exception
     struct ClearStackOnExit {
@@ -2460,7 +2834,15 @@ public:
 
     bool StartObject() { new (stack_.template Push<ValueType>()) ValueType(kObjectType); return true; }
     
-    bool Key(const Ch* str, SizeType length, bool copy) { return String(str, length, copy); }
+    bool Key(const Ch* str, SizeType length, bool copy) {
+        if (keyPool_ && copy && !ValueType::ShortString::Usable(length)) {
+            if (const Ch* s = keyPool_->Intern(str, length)) {
+                new (stack_.template Push<ValueType>()) ValueType(s, length);
+                return true;
+            }
+        }
+        return String(str, length, copy);
+    }
 
     bool EndObject(SizeType memberCount) {
         typename ValueType::Member* members = stack_.template Pop<typename ValueType::Member>(memberCount);
@@ -2500,6 +2882,7 @@ private:
     Allocator* ownAllocator_;
     internal::Stack<StackAllocator> stack_;
     ParseResult parseResult_;
+    KeyPoolType* keyPool_;
 };
 
 //! GenericDocument with UTF8 encoding
@@ -41,6 +41,16 @@ class CrtAllocator;
 template <typename BaseAllocator>
 class MemoryPoolAllocator;
 
+// pooledallocator.h
+
+template <typename BaseAllocator>
+class GenericChunkPool;
+
+typedef GenericChunkPool<CrtAllocator> ChunkPool;
+
+template <typename BaseAllocator>
+class PooledAllocator;
+
 // stream.h
 
 template <typename Encoding>
@@ -89,6 +99,13 @@ class GenericReader;
 
 typedef GenericReader<UTF8<char>, UTF8<char>, CrtAllocator> Reader;
 
+// pushreader.h
+
+template <typename SourceEncoding, typename TargetEncoding, typename StackAllocator>
+class GenericPushReader;
+
+typedef GenericPushReader<UTF8<char>, UTF8<char>, CrtAllocator> PushReader;
+
 // writer.h
 
 template<typename OutputStream, typename SourceEncoding, typename TargetEncoding, typename StackAllocator, unsigned writeFlags>
@@ -99,6 +116,11 @@ class Writer;
 template<typename OutputStream, typename SourceEncoding, typename TargetEncoding, typename StackAllocator, unsigned writeFlags>
 class PrettyWriter;
 
+// parallelwriter.h
+
+template<typename SourceEncoding, typename TargetEncoding, typename StackAllocator, unsigned writeFlags>
+class GenericParallelWriter;
+
 // document.h
 
 template <typename Encoding, typename Allocator> 
@@ -115,6 +137,11 @@ class GenericValue;
 
 typedef GenericValue<UTF8<char>, MemoryPoolAllocator<CrtAllocator> > Value;
 
+template <typename Encoding, typename Allocator>
+class GenericKeyPool;
+
+typedef GenericKeyPool<UTF8<char>, MemoryPoolAllocator<CrtAllocator> > KeyPool;
+
 template <typename Encoding, typename Allocator, typename StackAllocator>
 class GenericDocument;
 
@@ -127,6 +154,54 @@ class GenericPointer;
 
 typedef GenericPointer<Value, CrtAllocator> Pointer;
 
+template <typename ValueType, typename Allocator>
+class GenericCompiledPointer;
+
+typedef GenericCompiledPointer<Value, CrtAllocator> CompiledPointer;
+
+template <typename ValueType, typename Allocator>
+class GenericCompiledPointerSet;
+
+typedef GenericCompiledPointerSet<Value, CrtAllocator> CompiledPointerSet;
+
+// patch.h
+
+template <typename ValueType, typename Allocator>
+class GenericPatch;
+
+typedef GenericPatch<Value, CrtAllocator> Patch;
+
+// lazydocument.h
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyValue;
+
+typedef GenericLazyValue<UTF8<char>, MemoryPoolAllocator<CrtAllocator>, CrtAllocator> LazyValue;
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyDocument;
+
+typedef GenericLazyDocument<UTF8<char>, MemoryPoolAllocator<CrtAllocator>, CrtAllocator> LazyDocument;
+
+// snapshot.h
+
+template <typename Encoding>
+class GenericSnapshotValue;
+
+typedef GenericSnapshotValue<UTF8<char> > SnapshotValue;
+
+template <typename Encoding, typename Allocator>
+class GenericSnapshot;
+
+typedef GenericSnapshot<UTF8<char>, CrtAllocator> Snapshot;
+
+// projection.h
+
+template <typename Encoding, typename Allocator>
+class GenericProjection;
+
+typedef GenericProjection<UTF8<char>, CrtAllocator> Projection;
+
 // schema.h
 
 template <typename SchemaDocumentType>
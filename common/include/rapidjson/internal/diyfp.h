@@ -41,6 +41,53 @@ RAPIDJSON_DIAG_PUSH
 RAPIDJSON_DIAG_OFF(padded)
 #endif
 
+//! Computes the full 128-bit product of two 64-bit integers.
+/*! \param hi receives the upper 64 bits.
+    \return the lower 64 bits.
+*/
+inline uint64_t Umul128(uint64_t a, uint64_t b, uint64_t* hi) {
+#if defined(_MSC_VER) && defined(_M_AMD64)
+    return _umul128(a, b, hi);
+#elif (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)) && defined(__x86_64__)
+    __extension__ typedef unsigned __int128 uint128;
+    const uint128 p = static_cast<uint128>(a) * static_cast<uint128>(b);
+    *hi = static_cast<uint64_t>(p >> 64);
+    return static_cast<uint64_t>(p);
+#else
+    const uint64_t M32 = 0xFFFFFFFF;
+    const uint64_t a1 = a >> 32;
+    const uint64_t a0 = a & M32;
+    const uint64_t b1 = b >> 32;
+    const uint64_t b0 = b & M32;
+    const uint64_t p00 = a0 * b0;
+    const uint64_t p01 = a0 * b1;
+    const uint64_t p10 = a1 * b0;
+    const uint64_t p11 = a1 * b1;
+    const uint64_t mid = (p00 >> 32) + (p01 & M32) + (p10 & M32);
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    return (mid << 32) | (p00 & M32);
+#endif
+}
+
+//! Counts the leading zero bits of a non-zero 64-bit integer.
+inline int CountLeadingZeros64(uint64_t x) {
+    RAPIDJSON_ASSERT(x != 0);
+#if defined(_MSC_VER) && defined(_M_AMD64)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - static_cast<int>(index);
+#elif defined(__GNUC__) && __GNUC__ >= 4
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & (static_cast<uint64_t>(1) << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
 struct DiyFp {
     DiyFp() : f(), e() {}
 
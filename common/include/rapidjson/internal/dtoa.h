@@ -12,9 +12,10 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the 
 // specific language governing permissions and limitations under the License.
 
-// This is a C++ header-only implementation of Grisu2 algorithm from the publication:
-// Loitsch, Florian. "Printing floating-point numbers quickly and accurately with
-// integers." ACM Sigplan Notices 45.6 (2010): 233-243.
+// This is a C++ header-only implementation of the Schubfach algorithm from the publication:
+// Giulietti, Raffaello. "The Schubfach way to render doubles." (2020).
+// It produces the shortest decimal representation that reads back to the same double,
+// choosing the one closest to the exact value when there are several.
 
 #ifndef RAPIDJSON_DTOA_
 #define RAPIDJSON_DTOA_
@@ -22,6 +23,7 @@
 #include "itoa.h" // GetDigitsLut()
 #include "diyfp.h"
 #include "ieee754.h"
+#include "pow10.h"
 
 RAPIDJSON_NAMESPACE_BEGIN
 namespace internal {
@@ -32,95 +34,116 @@ RAPIDJSON_DIAG_OFF(effc++)
 RAPIDJSON_DIAG_OFF(array-bounds) // some gcc versions generate wrong warnings https://gcc.gnu.org/bugzilla/show_bug.cgi?id=59124
 #endif
 
-inline void GrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
-    while (rest < wp_w && delta - rest >= ten_kappa &&
-           (rest + ten_kappa < wp_w ||  /// closer
-            wp_w - rest > rest + ten_kappa - wp_w)) {
-        buffer[len - 1]--;
-        rest += ten_kappa;
-    }
+//! Computes floor(g * cp / 2^128), setting the lowest bit if the result is inexact (round to odd).
+inline uint64_t SchubfachRoundToOdd(uint64_t gHi, uint64_t gLo, uint64_t cp) {
+    uint64_t xHi, yHi;
+    Umul128(gLo, cp, &xHi);
+    const uint64_t yLo = Umul128(gHi, cp, &yHi);
+    const uint64_t zLo = yLo + xHi;
+    const uint64_t zHi = yHi + (zLo < yLo ? 1 : 0);
+    return zHi | (zLo > 1 ? 1 : 0);
 }
 
-inline int CountDecimalDigit32(uint32_t n) {
-    // Simple pure C++ implementation was faster than __builtin_clz version in this situation.
-    if (n < 10) return 1;
-    if (n < 100) return 2;
-    if (n < 1000) return 3;
-    if (n < 10000) return 4;
-    if (n < 100000) return 5;
-    if (n < 1000000) return 6;
-    if (n < 10000000) return 7;
-    if (n < 100000000) return 8;
-    // Will not reach 10 digits in DigitGen()
-    //if (n < 1000000000) return 9;
-    //return 10;
-    return 9;
-}
+//! Computes the shortest decimal digits of a positive finite double.
+/*! \param value positive, finite value.
+    \param buffer receives the digits, without leading or trailing zeros (at most 17).
+    \param length receives the number of digits.
+    \param K receives the decimal exponent, value ~= digits * 10^K.
+*/
+inline void Schubfach(double value, char* buffer, int* length, int* K) {
+    const Double d(value);
+    const uint64_t ieeeSignificand = d.Significand();
+    const int ieeeExponent = static_cast<int>(d.Uint64Value() >> 52);
 
-inline void DigitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int* len, int* K) {
-    static const uint32_t kPow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
-    const DiyFp one(uint64_t(1) << -Mp.e, Mp.e);
-    const DiyFp wp_w = Mp - W;
-    uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
-    uint64_t p2 = Mp.f & (one.f - 1);
-    int kappa = CountDecimalDigit32(p1); // kappa in [0, 9]
-    *len = 0;
-
-    while (kappa > 0) {
-        uint32_t d = 0;
-        switch (kappa) {
-            case  9: d = p1 /  100000000; p1 %=  100000000; break;
-            case  8: d = p1 /   10000000; p1 %=   10000000; break;
-            case  7: d = p1 /    1000000; p1 %=    1000000; break;
-            case  6: d = p1 /     100000; p1 %=     100000; break;
-            case  5: d = p1 /      10000; p1 %=      10000; break;
-            case  4: d = p1 /       1000; p1 %=       1000; break;
-            case  3: d = p1 /        100; p1 %=        100; break;
-            case  2: d = p1 /         10; p1 %=         10; break;
-            case  1: d = p1;              p1 =           0; break;
-            default:;
-        }
-        if (d || *len)
-            buffer[(*len)++] = static_cast<char>('0' + static_cast<char>(d));
-        kappa--;
-        uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e) + p2;
-        if (tmp <= delta) {
-            *K += kappa;
-            GrisuRound(buffer, *len, delta, tmp, static_cast<uint64_t>(kPow10[kappa]) << -one.e, wp_w.f);
+    uint64_t c;
+    int q;
+    if (ieeeExponent != 0) {
+        c = ieeeSignificand | RAPIDJSON_UINT64_C2(0x00100000, 0x00000000);
+        q = ieeeExponent - 1075;
+
+        // Small integers are printed as is
+        if (q <= 0 && -q < 53 && (c & ((static_cast<uint64_t>(1) << -q) - 1)) == 0) {
+            c >>= -q;
+            q = 0;
+            *K = 0;
+            while (c % 10 == 0) {
+                c /= 10;
+                ++*K;
+            }
+            *length = static_cast<int>(u64toa(c, buffer) - buffer);
             return;
         }
     }
+    else {
+        c = ieeeSignificand;
+        q = 1 - 1075;
+    }
 
-    // kappa = 0
-    for (;;) {
-        p2 *= 10;
-        delta *= 10;
-        char d = static_cast<char>(p2 >> -one.e);
-        if (d || *len)
-            buffer[(*len)++] = static_cast<char>('0' + d);
-        p2 &= one.f - 1;
-        kappa--;
-        if (p2 < delta) {
-            *K += kappa;
-            int index = -kappa;
-            GrisuRound(buffer, *len, delta, p2, one.f, wp_w.f * (index < 9 ? kPow10[index] : 0));
-            return;
+    const bool isEven = (c % 2 == 0);
+    const bool lowerBoundaryIsCloser = (ieeeSignificand == 0 && ieeeExponent > 1);
+
+    // Rounding interval [cbl, cbr] around cb, all scaled by 4
+    const uint64_t cbl = 4 * c - 2 + (lowerBoundaryIsCloser ? 1 : 0);
+    const uint64_t cb = 4 * c;
+    const uint64_t cbr = 4 * c + 2;
+
+    // (q * 1262611         ) >> 22 == floor(log10(    2^q))
+    // (q * 1262611 - 524031) >> 22 == floor(log10(3/4 2^q))
+    const int k = (q * 1262611 - (lowerBoundaryIsCloser ? 524031 : 0)) >> 22;
+    const int h = q + FloorLog2Pow10(-k) + 1;
+    RAPIDJSON_ASSERT(h >= 1 && h <= 4);
+
+    // g = ceil(10^-k * 2^(127 - floor(log2(10^-k))))
+    uint64_t gLo;
+    uint64_t gHi = Pow10Significand128(-k, &gLo);
+    if (-k < 0 || -k > 55) {
+        if (++gLo == 0)
+            ++gHi;
+    }
+
+    const uint64_t vbl = SchubfachRoundToOdd(gHi, gLo, cbl << h);
+    const uint64_t vb = SchubfachRoundToOdd(gHi, gLo, cb << h);
+    const uint64_t vbr = SchubfachRoundToOdd(gHi, gLo, cbr << h);
+
+    const uint64_t lower = vbl + (isEven ? 0 : 1);
+    const uint64_t upper = vbr - (isEven ? 0 : 1);
+
+    uint64_t s = vb / 4;
+    int exponent = k;
+    bool done = false;
+
+    // Try one digit less first: at most one of the two candidates is inside the interval
+    if (s >= 10) {
+        const uint64_t sp = s / 10;
+        const bool upInside = lower <= 40 * sp;
+        const bool wpInside = 40 * sp + 40 <= upper;
+        if (upInside != wpInside) {
+            s = sp + (wpInside ? 1 : 0);
+            exponent = k + 1;
+            done = true;
         }
     }
-}
 
-inline void Grisu2(double value, char* buffer, int* length, int* K) {
-    const DiyFp v(value);
-    DiyFp w_m, w_p;
-    v.NormalizedBoundaries(&w_m, &w_p);
-
-    const DiyFp c_mk = GetCachedPower(w_p.e, K);
-    const DiyFp W = v.Normalize() * c_mk;
-    DiyFp Wp = w_p * c_mk;
-    DiyFp Wm = w_m * c_mk;
-    Wm.f++;
-    Wp.f--;
-    DigitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+    if (!done) {
+        const bool uInside = lower <= 4 * s;
+        const bool wInside = 4 * s + 4 <= upper;
+        if (uInside != wInside)
+            s += (wInside ? 1 : 0);
+        else {
+            // Both or neither candidate inside: pick the closer one, ties to even
+            const uint64_t mid = 4 * s + 2;
+            const bool roundUp = vb > mid || (vb == mid && (s & 1) != 0);
+            s += (roundUp ? 1 : 0);
+        }
+    }
+
+    while (s % 10 == 0) {
+        s /= 10;
+        exponent++;
+    }
+
+    *K = exponent;
+    *length = static_cast<int>(u64toa(s, buffer) - buffer);
 }
 
 inline char* WriteExponent(int K, char* buffer) {
@@ -230,7 +253,7 @@ inline char* dtoa(double value, char* buffer, int maxDecimalPlaces = 324) {
             value = -value;
         }
         int length, K;
-        Grisu2(value, buffer, &length, &K);
+        Schubfach(value, buffer, &length, &K);
         return Prettify(buffer, length, K, maxDecimalPlaces);
     }
 }
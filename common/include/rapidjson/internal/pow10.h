@@ -49,6 +49,706 @@ inline double Pow10(int n) {
     return e[n];
 }
 
+//! Computes floor(log2(10^e)) without floating point arithmetic.
+/*! \param e exponent in [-1650, 1650].
+*/
+inline int FloorLog2Pow10(int e) {
+    RAPIDJSON_ASSERT(e >= -1650 && e <= 1650);
+    return (e * 1741647) >> 19;
+}
+
+static const int kPow10Significand128MinExponent = -342; //!< Smallest exponent supported by Pow10Significand128().
+static const int kPow10Significand128MaxExponent = 326;  //!< Largest exponent supported by Pow10Significand128().
+
+//! Computes the 128 most significant bits of 10^e.
+/*! The result is normalized so that its most significant bit is set, i.e. it is
+    floor(10^e * 2^(127 - floor(log2(10^e)))). The value is exact for e in [0, 55]
+    and truncated otherwise.
+
+    Used by the shortest double-to-string conversion (dtoa.h) and by the
+    Eisel-Lemire string-to-double conversion (strtod.h).
+    \param e exponent in [kPow10Significand128MinExponent, kPow10Significand128MaxExponent].
+    \param lo receives the lower 64 bits.
+    \return the upper 64 bits.
+*/
+inline uint64_t Pow10Significand128(int e, uint64_t* lo) {
+    static const uint64_t kSignificands[] = { // 10^-342...10^326: 669 * 16 bytes = 10704 bytes
+        RAPIDJSON_UINT64_C2(0xeef453d6, 0x923bd65a), RAPIDJSON_UINT64_C2(0x113faa29, 0x06a13b3f), // 10^-342
+        RAPIDJSON_UINT64_C2(0x9558b466, 0x1b6565f8), RAPIDJSON_UINT64_C2(0x4ac7ca59, 0xa424c507), // 10^-341
+        RAPIDJSON_UINT64_C2(0xbaaee17f, 0xa23ebf76), RAPIDJSON_UINT64_C2(0x5d79bcf0, 0x0d2df649), // 10^-340
+        RAPIDJSON_UINT64_C2(0xe95a99df, 0x8ace6f53), RAPIDJSON_UINT64_C2(0xf4d82c2c, 0x107973dc), // 10^-339
+        RAPIDJSON_UINT64_C2(0x91d8a02b, 0xb6c10594), RAPIDJSON_UINT64_C2(0x79071b9b, 0x8a4be869), // 10^-338
+        RAPIDJSON_UINT64_C2(0xb64ec836, 0xa47146f9), RAPIDJSON_UINT64_C2(0x9748e282, 0x6cdee284), // 10^-337
+        RAPIDJSON_UINT64_C2(0xe3e27a44, 0x4d8d98b7), RAPIDJSON_UINT64_C2(0xfd1b1b23, 0x08169b25), // 10^-336
+        RAPIDJSON_UINT64_C2(0x8e6d8c6a, 0xb0787f72), RAPIDJSON_UINT64_C2(0xfe30f0f5, 0xe50e20f7), // 10^-335
+        RAPIDJSON_UINT64_C2(0xb208ef85, 0x5c969f4f), RAPIDJSON_UINT64_C2(0xbdbd2d33, 0x5e51a935), // 10^-334
+        RAPIDJSON_UINT64_C2(0xde8b2b66, 0xb3bc4723), RAPIDJSON_UINT64_C2(0xad2c7880, 0x35e61382), // 10^-333
+        RAPIDJSON_UINT64_C2(0x8b16fb20, 0x3055ac76), RAPIDJSON_UINT64_C2(0x4c3bcb50, 0x21afcc31), // 10^-332
+        RAPIDJSON_UINT64_C2(0xaddcb9e8, 0x3c6b1793), RAPIDJSON_UINT64_C2(0xdf4abe24, 0x2a1bbf3d), // 10^-331
+        RAPIDJSON_UINT64_C2(0xd953e862, 0x4b85dd78), RAPIDJSON_UINT64_C2(0xd71d6dad, 0x34a2af0d), // 10^-330
+        RAPIDJSON_UINT64_C2(0x87d4713d, 0x6f33aa6b), RAPIDJSON_UINT64_C2(0x8672648c, 0x40e5ad68), // 10^-329
+        RAPIDJSON_UINT64_C2(0xa9c98d8c, 0xcb009506), RAPIDJSON_UINT64_C2(0x680efdaf, 0x511f18c2), // 10^-328
+        RAPIDJSON_UINT64_C2(0xd43bf0ef, 0xfdc0ba48), RAPIDJSON_UINT64_C2(0x0212bd1b, 0x2566def2), // 10^-327
+        RAPIDJSON_UINT64_C2(0x84a57695, 0xfe98746d), RAPIDJSON_UINT64_C2(0x014bb630, 0xf7604b57), // 10^-326
+        RAPIDJSON_UINT64_C2(0xa5ced43b, 0x7e3e9188), RAPIDJSON_UINT64_C2(0x419ea3bd, 0x35385e2d), // 10^-325
+        RAPIDJSON_UINT64_C2(0xcf42894a, 0x5dce35ea), RAPIDJSON_UINT64_C2(0x52064cac, 0x828675b9), // 10^-324
+        RAPIDJSON_UINT64_C2(0x818995ce, 0x7aa0e1b2), RAPIDJSON_UINT64_C2(0x7343efeb, 0xd1940993), // 10^-323
+        RAPIDJSON_UINT64_C2(0xa1ebfb42, 0x19491a1f), RAPIDJSON_UINT64_C2(0x1014ebe6, 0xc5f90bf8), // 10^-322
+        RAPIDJSON_UINT64_C2(0xca66fa12, 0x9f9b60a6), RAPIDJSON_UINT64_C2(0xd41a26e0, 0x77774ef6), // 10^-321
+        RAPIDJSON_UINT64_C2(0xfd00b897, 0x478238d0), RAPIDJSON_UINT64_C2(0x8920b098, 0x955522b4), // 10^-320
+        RAPIDJSON_UINT64_C2(0x9e20735e, 0x8cb16382), RAPIDJSON_UINT64_C2(0x55b46e5f, 0x5d5535b0), // 10^-319
+        RAPIDJSON_UINT64_C2(0xc5a89036, 0x2fddbc62), RAPIDJSON_UINT64_C2(0xeb2189f7, 0x34aa831d), // 10^-318
+        RAPIDJSON_UINT64_C2(0xf712b443, 0xbbd52b7b), RAPIDJSON_UINT64_C2(0xa5e9ec75, 0x01d523e4), // 10^-317
+        RAPIDJSON_UINT64_C2(0x9a6bb0aa, 0x55653b2d), RAPIDJSON_UINT64_C2(0x47b233c9, 0x2125366e), // 10^-316
+        RAPIDJSON_UINT64_C2(0xc1069cd4, 0xeabe89f8), RAPIDJSON_UINT64_C2(0x999ec0bb, 0x696e840a), // 10^-315
+        RAPIDJSON_UINT64_C2(0xf148440a, 0x256e2c76), RAPIDJSON_UINT64_C2(0xc00670ea, 0x43ca250d), // 10^-314
+        RAPIDJSON_UINT64_C2(0x96cd2a86, 0x5764dbca), RAPIDJSON_UINT64_C2(0x38040692, 0x6a5e5728), // 10^-313
+        RAPIDJSON_UINT64_C2(0xbc807527, 0xed3e12bc), RAPIDJSON_UINT64_C2(0xc6050837, 0x04f5ecf2), // 10^-312
+        RAPIDJSON_UINT64_C2(0xeba09271, 0xe88d976b), RAPIDJSON_UINT64_C2(0xf7864a44, 0xc633682e), // 10^-311
+        RAPIDJSON_UINT64_C2(0x93445b87, 0x31587ea3), RAPIDJSON_UINT64_C2(0x7ab3ee6a, 0xfbe0211d), // 10^-310
+        RAPIDJSON_UINT64_C2(0xb8157268, 0xfdae9e4c), RAPIDJSON_UINT64_C2(0x5960ea05, 0xbad82964), // 10^-309
+        RAPIDJSON_UINT64_C2(0xe61acf03, 0x3d1a45df), RAPIDJSON_UINT64_C2(0x6fb92487, 0x298e33bd), // 10^-308
+        RAPIDJSON_UINT64_C2(0x8fd0c162, 0x06306bab), RAPIDJSON_UINT64_C2(0xa5d3b6d4, 0x79f8e056), // 10^-307
+        RAPIDJSON_UINT64_C2(0xb3c4f1ba, 0x87bc8696), RAPIDJSON_UINT64_C2(0x8f48a489, 0x9877186c), // 10^-306
+        RAPIDJSON_UINT64_C2(0xe0b62e29, 0x29aba83c), RAPIDJSON_UINT64_C2(0x331acdab, 0xfe94de87), // 10^-305
+        RAPIDJSON_UINT64_C2(0x8c71dcd9, 0xba0b4925), RAPIDJSON_UINT64_C2(0x9ff0c08b, 0x7f1d0b14), // 10^-304
+        RAPIDJSON_UINT64_C2(0xaf8e5410, 0x288e1b6f), RAPIDJSON_UINT64_C2(0x07ecf0ae, 0x5ee44dd9), // 10^-303
+        RAPIDJSON_UINT64_C2(0xdb71e914, 0x32b1a24a), RAPIDJSON_UINT64_C2(0xc9e82cd9, 0xf69d6150), // 10^-302
+        RAPIDJSON_UINT64_C2(0x892731ac, 0x9faf056e), RAPIDJSON_UINT64_C2(0xbe311c08, 0x3a225cd2), // 10^-301
+        RAPIDJSON_UINT64_C2(0xab70fe17, 0xc79ac6ca), RAPIDJSON_UINT64_C2(0x6dbd630a, 0x48aaf406), // 10^-300
+        RAPIDJSON_UINT64_C2(0xd64d3d9d, 0xb981787d), RAPIDJSON_UINT64_C2(0x092cbbcc, 0xdad5b108), // 10^-299
+        RAPIDJSON_UINT64_C2(0x85f04682, 0x93f0eb4e), RAPIDJSON_UINT64_C2(0x25bbf560, 0x08c58ea5), // 10^-298
+        RAPIDJSON_UINT64_C2(0xa76c5823, 0x38ed2621), RAPIDJSON_UINT64_C2(0xaf2af2b8, 0x0af6f24e), // 10^-297
+        RAPIDJSON_UINT64_C2(0xd1476e2c, 0x07286faa), RAPIDJSON_UINT64_C2(0x1af5af66, 0x0db4aee1), // 10^-296
+        RAPIDJSON_UINT64_C2(0x82cca4db, 0x847945ca), RAPIDJSON_UINT64_C2(0x50d98d9f, 0xc890ed4d), // 10^-295
+        RAPIDJSON_UINT64_C2(0xa37fce12, 0x6597973c), RAPIDJSON_UINT64_C2(0xe50ff107, 0xbab528a0), // 10^-294
+        RAPIDJSON_UINT64_C2(0xcc5fc196, 0xfefd7d0c), RAPIDJSON_UINT64_C2(0x1e53ed49, 0xa96272c8), // 10^-293
+        RAPIDJSON_UINT64_C2(0xff77b1fc, 0xbebcdc4f), RAPIDJSON_UINT64_C2(0x25e8e89c, 0x13bb0f7a), // 10^-292
+        RAPIDJSON_UINT64_C2(0x9faacf3d, 0xf73609b1), RAPIDJSON_UINT64_C2(0x77b19161, 0x8c54e9ac), // 10^-291
+        RAPIDJSON_UINT64_C2(0xc795830d, 0x75038c1d), RAPIDJSON_UINT64_C2(0xd59df5b9, 0xef6a2417), // 10^-290
+        RAPIDJSON_UINT64_C2(0xf97ae3d0, 0xd2446f25), RAPIDJSON_UINT64_C2(0x4b057328, 0x6b44ad1d), // 10^-289
+        RAPIDJSON_UINT64_C2(0x9becce62, 0x836ac577), RAPIDJSON_UINT64_C2(0x4ee367f9, 0x430aec32), // 10^-288
+        RAPIDJSON_UINT64_C2(0xc2e801fb, 0x244576d5), RAPIDJSON_UINT64_C2(0x229c41f7, 0x93cda73f), // 10^-287
+        RAPIDJSON_UINT64_C2(0xf3a20279, 0xed56d48a), RAPIDJSON_UINT64_C2(0x6b435275, 0x78c1110f), // 10^-286
+        RAPIDJSON_UINT64_C2(0x9845418c, 0x345644d6), RAPIDJSON_UINT64_C2(0x830a1389, 0x6b78aaa9), // 10^-285
+        RAPIDJSON_UINT64_C2(0xbe5691ef, 0x416bd60c), RAPIDJSON_UINT64_C2(0x23cc986b, 0xc656d553), // 10^-284
+        RAPIDJSON_UINT64_C2(0xedec366b, 0x11c6cb8f), RAPIDJSON_UINT64_C2(0x2cbfbe86, 0xb7ec8aa8), // 10^-283
+        RAPIDJSON_UINT64_C2(0x94b3a202, 0xeb1c3f39), RAPIDJSON_UINT64_C2(0x7bf7d714, 0x32f3d6a9), // 10^-282
+        RAPIDJSON_UINT64_C2(0xb9e08a83, 0xa5e34f07), RAPIDJSON_UINT64_C2(0xdaf5ccd9, 0x3fb0cc53), // 10^-281
+        RAPIDJSON_UINT64_C2(0xe858ad24, 0x8f5c22c9), RAPIDJSON_UINT64_C2(0xd1b3400f, 0x8f9cff68), // 10^-280
+        RAPIDJSON_UINT64_C2(0x91376c36, 0xd99995be), RAPIDJSON_UINT64_C2(0x23100809, 0xb9c21fa1), // 10^-279
+        RAPIDJSON_UINT64_C2(0xb5854744, 0x8ffffb2d), RAPIDJSON_UINT64_C2(0xabd40a0c, 0x2832a78a), // 10^-278
+        RAPIDJSON_UINT64_C2(0xe2e69915, 0xb3fff9f9), RAPIDJSON_UINT64_C2(0x16c90c8f, 0x323f516c), // 10^-277
+        RAPIDJSON_UINT64_C2(0x8dd01fad, 0x907ffc3b), RAPIDJSON_UINT64_C2(0xae3da7d9, 0x7f6792e3), // 10^-276
+        RAPIDJSON_UINT64_C2(0xb1442798, 0xf49ffb4a), RAPIDJSON_UINT64_C2(0x99cd11cf, 0xdf41779c), // 10^-275
+        RAPIDJSON_UINT64_C2(0xdd95317f, 0x31c7fa1d), RAPIDJSON_UINT64_C2(0x40405643, 0xd711d583), // 10^-274
+        RAPIDJSON_UINT64_C2(0x8a7d3eef, 0x7f1cfc52), RAPIDJSON_UINT64_C2(0x482835ea, 0x666b2572), // 10^-273
+        RAPIDJSON_UINT64_C2(0xad1c8eab, 0x5ee43b66), RAPIDJSON_UINT64_C2(0xda324365, 0x0005eecf), // 10^-272
+        RAPIDJSON_UINT64_C2(0xd863b256, 0x369d4a40), RAPIDJSON_UINT64_C2(0x90bed43e, 0x40076a82), // 10^-271
+        RAPIDJSON_UINT64_C2(0x873e4f75, 0xe2224e68), RAPIDJSON_UINT64_C2(0x5a7744a6, 0xe804a291), // 10^-270
+        RAPIDJSON_UINT64_C2(0xa90de353, 0x5aaae202), RAPIDJSON_UINT64_C2(0x711515d0, 0xa205cb36), // 10^-269
+        RAPIDJSON_UINT64_C2(0xd3515c28, 0x31559a83), RAPIDJSON_UINT64_C2(0x0d5a5b44, 0xca873e03), // 10^-268
+        RAPIDJSON_UINT64_C2(0x8412d999, 0x1ed58091), RAPIDJSON_UINT64_C2(0xe858790a, 0xfe9486c2), // 10^-267
+        RAPIDJSON_UINT64_C2(0xa5178fff, 0x668ae0b6), RAPIDJSON_UINT64_C2(0x626e974d, 0xbe39a872), // 10^-266
+        RAPIDJSON_UINT64_C2(0xce5d73ff, 0x402d98e3), RAPIDJSON_UINT64_C2(0xfb0a3d21, 0x2dc8128f), // 10^-265
+        RAPIDJSON_UINT64_C2(0x80fa687f, 0x881c7f8e), RAPIDJSON_UINT64_C2(0x7ce66634, 0xbc9d0b99), // 10^-264
+        RAPIDJSON_UINT64_C2(0xa139029f, 0x6a239f72), RAPIDJSON_UINT64_C2(0x1c1fffc1, 0xebc44e80), // 10^-263
+        RAPIDJSON_UINT64_C2(0xc9874347, 0x44ac874e), RAPIDJSON_UINT64_C2(0xa327ffb2, 0x66b56220), // 10^-262
+        RAPIDJSON_UINT64_C2(0xfbe91419, 0x15d7a922), RAPIDJSON_UINT64_C2(0x4bf1ff9f, 0x0062baa8), // 10^-261
+        RAPIDJSON_UINT64_C2(0x9d71ac8f, 0xada6c9b5), RAPIDJSON_UINT64_C2(0x6f773fc3, 0x603db4a9), // 10^-260
+        RAPIDJSON_UINT64_C2(0xc4ce17b3, 0x99107c22), RAPIDJSON_UINT64_C2(0xcb550fb4, 0x384d21d3), // 10^-259
+        RAPIDJSON_UINT64_C2(0xf6019da0, 0x7f549b2b), RAPIDJSON_UINT64_C2(0x7e2a53a1, 0x46606a48), // 10^-258
+        RAPIDJSON_UINT64_C2(0x99c10284, 0x4f94e0fb), RAPIDJSON_UINT64_C2(0x2eda7444, 0xcbfc426d), // 10^-257
+        RAPIDJSON_UINT64_C2(0xc0314325, 0x637a1939), RAPIDJSON_UINT64_C2(0xfa911155, 0xfefb5308), // 10^-256
+        RAPIDJSON_UINT64_C2(0xf03d93ee, 0xbc589f88), RAPIDJSON_UINT64_C2(0x793555ab, 0x7eba27ca), // 10^-255
+        RAPIDJSON_UINT64_C2(0x96267c75, 0x35b763b5), RAPIDJSON_UINT64_C2(0x4bc1558b, 0x2f3458de), // 10^-254
+        RAPIDJSON_UINT64_C2(0xbbb01b92, 0x83253ca2), RAPIDJSON_UINT64_C2(0x9eb1aaed, 0xfb016f16), // 10^-253
+        RAPIDJSON_UINT64_C2(0xea9c2277, 0x23ee8bcb), RAPIDJSON_UINT64_C2(0x465e15a9, 0x79c1cadc), // 10^-252
+        RAPIDJSON_UINT64_C2(0x92a1958a, 0x7675175f), RAPIDJSON_UINT64_C2(0x0bfacd89, 0xec191ec9), // 10^-251
+        RAPIDJSON_UINT64_C2(0xb749faed, 0x14125d36), RAPIDJSON_UINT64_C2(0xcef980ec, 0x671f667b), // 10^-250
+        RAPIDJSON_UINT64_C2(0xe51c79a8, 0x5916f484), RAPIDJSON_UINT64_C2(0x82b7e127, 0x80e7401a), // 10^-249
+        RAPIDJSON_UINT64_C2(0x8f31cc09, 0x37ae58d2), RAPIDJSON_UINT64_C2(0xd1b2ecb8, 0xb0908810), // 10^-248
+        RAPIDJSON_UINT64_C2(0xb2fe3f0b, 0x8599ef07), RAPIDJSON_UINT64_C2(0x861fa7e6, 0xdcb4aa15), // 10^-247
+        RAPIDJSON_UINT64_C2(0xdfbdcece, 0x67006ac9), RAPIDJSON_UINT64_C2(0x67a791e0, 0x93e1d49a), // 10^-246
+        RAPIDJSON_UINT64_C2(0x8bd6a141, 0x006042bd), RAPIDJSON_UINT64_C2(0xe0c8bb2c, 0x5c6d24e0), // 10^-245
+        RAPIDJSON_UINT64_C2(0xaecc4991, 0x4078536d), RAPIDJSON_UINT64_C2(0x58fae9f7, 0x73886e18), // 10^-244
+        RAPIDJSON_UINT64_C2(0xda7f5bf5, 0x90966848), RAPIDJSON_UINT64_C2(0xaf39a475, 0x506a899e), // 10^-243
+        RAPIDJSON_UINT64_C2(0x888f9979, 0x7a5e012d), RAPIDJSON_UINT64_C2(0x6d8406c9, 0x52429603), // 10^-242
+        RAPIDJSON_UINT64_C2(0xaab37fd7, 0xd8f58178), RAPIDJSON_UINT64_C2(0xc8e5087b, 0xa6d33b83), // 10^-241
+        RAPIDJSON_UINT64_C2(0xd5605fcd, 0xcf32e1d6), RAPIDJSON_UINT64_C2(0xfb1e4a9a, 0x90880a64), // 10^-240
+        RAPIDJSON_UINT64_C2(0x855c3be0, 0xa17fcd26), RAPIDJSON_UINT64_C2(0x5cf2eea0, 0x9a55067f), // 10^-239
+        RAPIDJSON_UINT64_C2(0xa6b34ad8, 0xc9dfc06f), RAPIDJSON_UINT64_C2(0xf42faa48, 0xc0ea481e), // 10^-238
+        RAPIDJSON_UINT64_C2(0xd0601d8e, 0xfc57b08b), RAPIDJSON_UINT64_C2(0xf13b94da, 0xf124da26), // 10^-237
+        RAPIDJSON_UINT64_C2(0x823c1279, 0x5db6ce57), RAPIDJSON_UINT64_C2(0x76c53d08, 0xd6b70858), // 10^-236
+        RAPIDJSON_UINT64_C2(0xa2cb1717, 0xb52481ed), RAPIDJSON_UINT64_C2(0x54768c4b, 0x0c64ca6e), // 10^-235
+        RAPIDJSON_UINT64_C2(0xcb7ddcdd, 0xa26da268), RAPIDJSON_UINT64_C2(0xa9942f5d, 0xcf7dfd09), // 10^-234
+        RAPIDJSON_UINT64_C2(0xfe5d5415, 0x0b090b02), RAPIDJSON_UINT64_C2(0xd3f93b35, 0x435d7c4c), // 10^-233
+        RAPIDJSON_UINT64_C2(0x9efa548d, 0x26e5a6e1), RAPIDJSON_UINT64_C2(0xc47bc501, 0x4a1a6daf), // 10^-232
+        RAPIDJSON_UINT64_C2(0xc6b8e9b0, 0x709f109a), RAPIDJSON_UINT64_C2(0x359ab641, 0x9ca1091b), // 10^-231
+        RAPIDJSON_UINT64_C2(0xf867241c, 0x8cc6d4c0), RAPIDJSON_UINT64_C2(0xc30163d2, 0x03c94b62), // 10^-230
+        RAPIDJSON_UINT64_C2(0x9b407691, 0xd7fc44f8), RAPIDJSON_UINT64_C2(0x79e0de63, 0x425dcf1d), // 10^-229
+        RAPIDJSON_UINT64_C2(0xc2109436, 0x4dfb5636), RAPIDJSON_UINT64_C2(0x985915fc, 0x12f542e4), // 10^-228
+        RAPIDJSON_UINT64_C2(0xf294b943, 0xe17a2bc4), RAPIDJSON_UINT64_C2(0x3e6f5b7b, 0x17b2939d), // 10^-227
+        RAPIDJSON_UINT64_C2(0x979cf3ca, 0x6cec5b5a), RAPIDJSON_UINT64_C2(0xa705992c, 0xeecf9c42), // 10^-226
+        RAPIDJSON_UINT64_C2(0xbd8430bd, 0x08277231), RAPIDJSON_UINT64_C2(0x50c6ff78, 0x2a838353), // 10^-225
+        RAPIDJSON_UINT64_C2(0xece53cec, 0x4a314ebd), RAPIDJSON_UINT64_C2(0xa4f8bf56, 0x35246428), // 10^-224
+        RAPIDJSON_UINT64_C2(0x940f4613, 0xae5ed136), RAPIDJSON_UINT64_C2(0x871b7795, 0xe136be99), // 10^-223
+        RAPIDJSON_UINT64_C2(0xb9131798, 0x99f68584), RAPIDJSON_UINT64_C2(0x28e2557b, 0x59846e3f), // 10^-222
+        RAPIDJSON_UINT64_C2(0xe757dd7e, 0xc07426e5), RAPIDJSON_UINT64_C2(0x331aeada, 0x2fe589cf), // 10^-221
+        RAPIDJSON_UINT64_C2(0x9096ea6f, 0x3848984f), RAPIDJSON_UINT64_C2(0x3ff0d2c8, 0x5def7621), // 10^-220
+        RAPIDJSON_UINT64_C2(0xb4bca50b, 0x065abe63), RAPIDJSON_UINT64_C2(0x0fed077a, 0x756b53a9), // 10^-219
+        RAPIDJSON_UINT64_C2(0xe1ebce4d, 0xc7f16dfb), RAPIDJSON_UINT64_C2(0xd3e84959, 0x12c62894), // 10^-218
+        RAPIDJSON_UINT64_C2(0x8d3360f0, 0x9cf6e4bd), RAPIDJSON_UINT64_C2(0x64712dd7, 0xabbbd95c), // 10^-217
+        RAPIDJSON_UINT64_C2(0xb080392c, 0xc4349dec), RAPIDJSON_UINT64_C2(0xbd8d794d, 0x96aacfb3), // 10^-216
+        RAPIDJSON_UINT64_C2(0xdca04777, 0xf541c567), RAPIDJSON_UINT64_C2(0xecf0d7a0, 0xfc5583a0), // 10^-215
+        RAPIDJSON_UINT64_C2(0x89e42caa, 0xf9491b60), RAPIDJSON_UINT64_C2(0xf41686c4, 0x9db57244), // 10^-214
+        RAPIDJSON_UINT64_C2(0xac5d37d5, 0xb79b6239), RAPIDJSON_UINT64_C2(0x311c2875, 0xc522ced5), // 10^-213
+        RAPIDJSON_UINT64_C2(0xd77485cb, 0x25823ac7), RAPIDJSON_UINT64_C2(0x7d633293, 0x366b828b), // 10^-212
+        RAPIDJSON_UINT64_C2(0x86a8d39e, 0xf77164bc), RAPIDJSON_UINT64_C2(0xae5dff9c, 0x02033197), // 10^-211
+        RAPIDJSON_UINT64_C2(0xa8530886, 0xb54dbdeb), RAPIDJSON_UINT64_C2(0xd9f57f83, 0x0283fdfc), // 10^-210
+        RAPIDJSON_UINT64_C2(0xd267caa8, 0x62a12d66), RAPIDJSON_UINT64_C2(0xd072df63, 0xc324fd7b), // 10^-209
+        RAPIDJSON_UINT64_C2(0x8380dea9, 0x3da4bc60), RAPIDJSON_UINT64_C2(0x4247cb9e, 0x59f71e6d), // 10^-208
+        RAPIDJSON_UINT64_C2(0xa4611653, 0x8d0deb78), RAPIDJSON_UINT64_C2(0x52d9be85, 0xf074e608), // 10^-207
+        RAPIDJSON_UINT64_C2(0xcd795be8, 0x70516656), RAPIDJSON_UINT64_C2(0x67902e27, 0x6c921f8b), // 10^-206
+        RAPIDJSON_UINT64_C2(0x806bd971, 0x4632dff6), RAPIDJSON_UINT64_C2(0x00ba1cd8, 0xa3db53b6), // 10^-205
+        RAPIDJSON_UINT64_C2(0xa086cfcd, 0x97bf97f3), RAPIDJSON_UINT64_C2(0x80e8a40e, 0xccd228a4), // 10^-204
+        RAPIDJSON_UINT64_C2(0xc8a883c0, 0xfdaf7df0), RAPIDJSON_UINT64_C2(0x6122cd12, 0x8006b2cd), // 10^-203
+        RAPIDJSON_UINT64_C2(0xfad2a4b1, 0x3d1b5d6c), RAPIDJSON_UINT64_C2(0x796b8057, 0x20085f81), // 10^-202
+        RAPIDJSON_UINT64_C2(0x9cc3a6ee, 0xc6311a63), RAPIDJSON_UINT64_C2(0xcbe33036, 0x74053bb0), // 10^-201
+        RAPIDJSON_UINT64_C2(0xc3f490aa, 0x77bd60fc), RAPIDJSON_UINT64_C2(0xbedbfc44, 0x11068a9c), // 10^-200
+        RAPIDJSON_UINT64_C2(0xf4f1b4d5, 0x15acb93b), RAPIDJSON_UINT64_C2(0xee92fb55, 0x15482d44), // 10^-199
+        RAPIDJSON_UINT64_C2(0x99171105, 0x2d8bf3c5), RAPIDJSON_UINT64_C2(0x751bdd15, 0x2d4d1c4a), // 10^-198
+        RAPIDJSON_UINT64_C2(0xbf5cd546, 0x78eef0b6), RAPIDJSON_UINT64_C2(0xd262d45a, 0x78a0635d), // 10^-197
+        RAPIDJSON_UINT64_C2(0xef340a98, 0x172aace4), RAPIDJSON_UINT64_C2(0x86fb8971, 0x16c87c34), // 10^-196
+        RAPIDJSON_UINT64_C2(0x9580869f, 0x0e7aac0e), RAPIDJSON_UINT64_C2(0xd45d35e6, 0xae3d4da0), // 10^-195
+        RAPIDJSON_UINT64_C2(0xbae0a846, 0xd2195712), RAPIDJSON_UINT64_C2(0x89748360, 0x59cca109), // 10^-194
+        RAPIDJSON_UINT64_C2(0xe998d258, 0x869facd7), RAPIDJSON_UINT64_C2(0x2bd1a438, 0x703fc94b), // 10^-193
+        RAPIDJSON_UINT64_C2(0x91ff8377, 0x5423cc06), RAPIDJSON_UINT64_C2(0x7b6306a3, 0x4627ddcf), // 10^-192
+        RAPIDJSON_UINT64_C2(0xb67f6455, 0x292cbf08), RAPIDJSON_UINT64_C2(0x1a3bc84c, 0x17b1d542), // 10^-191
+        RAPIDJSON_UINT64_C2(0xe41f3d6a, 0x7377eeca), RAPIDJSON_UINT64_C2(0x20caba5f, 0x1d9e4a93), // 10^-190
+        RAPIDJSON_UINT64_C2(0x8e938662, 0x882af53e), RAPIDJSON_UINT64_C2(0x547eb47b, 0x7282ee9c), // 10^-189
+        RAPIDJSON_UINT64_C2(0xb23867fb, 0x2a35b28d), RAPIDJSON_UINT64_C2(0xe99e619a, 0x4f23aa43), // 10^-188
+        RAPIDJSON_UINT64_C2(0xdec681f9, 0xf4c31f31), RAPIDJSON_UINT64_C2(0x6405fa00, 0xe2ec94d4), // 10^-187
+        RAPIDJSON_UINT64_C2(0x8b3c113c, 0x38f9f37e), RAPIDJSON_UINT64_C2(0xde83bc40, 0x8dd3dd04), // 10^-186
+        RAPIDJSON_UINT64_C2(0xae0b158b, 0x4738705e), RAPIDJSON_UINT64_C2(0x9624ab50, 0xb148d445), // 10^-185
+        RAPIDJSON_UINT64_C2(0xd98ddaee, 0x19068c76), RAPIDJSON_UINT64_C2(0x3badd624, 0xdd9b0957), // 10^-184
+        RAPIDJSON_UINT64_C2(0x87f8a8d4, 0xcfa417c9), RAPIDJSON_UINT64_C2(0xe54ca5d7, 0x0a80e5d6), // 10^-183
+        RAPIDJSON_UINT64_C2(0xa9f6d30a, 0x038d1dbc), RAPIDJSON_UINT64_C2(0x5e9fcf4c, 0xcd211f4c), // 10^-182
+        RAPIDJSON_UINT64_C2(0xd47487cc, 0x8470652b), RAPIDJSON_UINT64_C2(0x7647c320, 0x0069671f), // 10^-181
+        RAPIDJSON_UINT64_C2(0x84c8d4df, 0xd2c63f3b), RAPIDJSON_UINT64_C2(0x29ecd9f4, 0x0041e073), // 10^-180
+        RAPIDJSON_UINT64_C2(0xa5fb0a17, 0xc777cf09), RAPIDJSON_UINT64_C2(0xf4681071, 0x00525890), // 10^-179
+        RAPIDJSON_UINT64_C2(0xcf79cc9d, 0xb955c2cc), RAPIDJSON_UINT64_C2(0x7182148d, 0x4066eeb4), // 10^-178
+        RAPIDJSON_UINT64_C2(0x81ac1fe2, 0x93d599bf), RAPIDJSON_UINT64_C2(0xc6f14cd8, 0x48405530), // 10^-177
+        RAPIDJSON_UINT64_C2(0xa21727db, 0x38cb002f), RAPIDJSON_UINT64_C2(0xb8ada00e, 0x5a506a7c), // 10^-176
+        RAPIDJSON_UINT64_C2(0xca9cf1d2, 0x06fdc03b), RAPIDJSON_UINT64_C2(0xa6d90811, 0xf0e4851c), // 10^-175
+        RAPIDJSON_UINT64_C2(0xfd442e46, 0x88bd304a), RAPIDJSON_UINT64_C2(0x908f4a16, 0x6d1da663), // 10^-174
+        RAPIDJSON_UINT64_C2(0x9e4a9cec, 0x15763e2e), RAPIDJSON_UINT64_C2(0x9a598e4e, 0x043287fe), // 10^-173
+        RAPIDJSON_UINT64_C2(0xc5dd4427, 0x1ad3cdba), RAPIDJSON_UINT64_C2(0x40eff1e1, 0x853f29fd), // 10^-172
+        RAPIDJSON_UINT64_C2(0xf7549530, 0xe188c128), RAPIDJSON_UINT64_C2(0xd12bee59, 0xe68ef47c), // 10^-171
+        RAPIDJSON_UINT64_C2(0x9a94dd3e, 0x8cf578b9), RAPIDJSON_UINT64_C2(0x82bb74f8, 0x301958ce), // 10^-170
+        RAPIDJSON_UINT64_C2(0xc13a148e, 0x3032d6e7), RAPIDJSON_UINT64_C2(0xe36a5236, 0x3c1faf01), // 10^-169
+        RAPIDJSON_UINT64_C2(0xf18899b1, 0xbc3f8ca1), RAPIDJSON_UINT64_C2(0xdc44e6c3, 0xcb279ac1), // 10^-168
+        RAPIDJSON_UINT64_C2(0x96f5600f, 0x15a7b7e5), RAPIDJSON_UINT64_C2(0x29ab103a, 0x5ef8c0b9), // 10^-167
+        RAPIDJSON_UINT64_C2(0xbcb2b812, 0xdb11a5de), RAPIDJSON_UINT64_C2(0x7415d448, 0xf6b6f0e7), // 10^-166
+        RAPIDJSON_UINT64_C2(0xebdf6617, 0x91d60f56), RAPIDJSON_UINT64_C2(0x111b495b, 0x3464ad21), // 10^-165
+        RAPIDJSON_UINT64_C2(0x936b9fce, 0xbb25c995), RAPIDJSON_UINT64_C2(0xcab10dd9, 0x00beec34), // 10^-164
+        RAPIDJSON_UINT64_C2(0xb84687c2, 0x69ef3bfb), RAPIDJSON_UINT64_C2(0x3d5d514f, 0x40eea742), // 10^-163
+        RAPIDJSON_UINT64_C2(0xe65829b3, 0x046b0afa), RAPIDJSON_UINT64_C2(0x0cb4a5a3, 0x112a5112), // 10^-162
+        RAPIDJSON_UINT64_C2(0x8ff71a0f, 0xe2c2e6dc), RAPIDJSON_UINT64_C2(0x47f0e785, 0xeaba72ab), // 10^-161
+        RAPIDJSON_UINT64_C2(0xb3f4e093, 0xdb73a093), RAPIDJSON_UINT64_C2(0x59ed2167, 0x65690f56), // 10^-160
+        RAPIDJSON_UINT64_C2(0xe0f218b8, 0xd25088b8), RAPIDJSON_UINT64_C2(0x306869c1, 0x3ec3532c), // 10^-159
+        RAPIDJSON_UINT64_C2(0x8c974f73, 0x83725573), RAPIDJSON_UINT64_C2(0x1e414218, 0xc73a13fb), // 10^-158
+        RAPIDJSON_UINT64_C2(0xafbd2350, 0x644eeacf), RAPIDJSON_UINT64_C2(0xe5d1929e, 0xf90898fa), // 10^-157
+        RAPIDJSON_UINT64_C2(0xdbac6c24, 0x7d62a583), RAPIDJSON_UINT64_C2(0xdf45f746, 0xb74abf39), // 10^-156
+        RAPIDJSON_UINT64_C2(0x894bc396, 0xce5da772), RAPIDJSON_UINT64_C2(0x6b8bba8c, 0x328eb783), // 10^-155
+        RAPIDJSON_UINT64_C2(0xab9eb47c, 0x81f5114f), RAPIDJSON_UINT64_C2(0x066ea92f, 0x3f326564), // 10^-154
+        RAPIDJSON_UINT64_C2(0xd686619b, 0xa27255a2), RAPIDJSON_UINT64_C2(0xc80a537b, 0x0efefebd), // 10^-153
+        RAPIDJSON_UINT64_C2(0x8613fd01, 0x45877585), RAPIDJSON_UINT64_C2(0xbd06742c, 0xe95f5f36), // 10^-152
+        RAPIDJSON_UINT64_C2(0xa798fc41, 0x96e952e7), RAPIDJSON_UINT64_C2(0x2c481138, 0x23b73704), // 10^-151
+        RAPIDJSON_UINT64_C2(0xd17f3b51, 0xfca3a7a0), RAPIDJSON_UINT64_C2(0xf75a1586, 0x2ca504c5), // 10^-150
+        RAPIDJSON_UINT64_C2(0x82ef8513, 0x3de648c4), RAPIDJSON_UINT64_C2(0x9a984d73, 0xdbe722fb), // 10^-149
+        RAPIDJSON_UINT64_C2(0xa3ab6658, 0x0d5fdaf5), RAPIDJSON_UINT64_C2(0xc13e60d0, 0xd2e0ebba), // 10^-148
+        RAPIDJSON_UINT64_C2(0xcc963fee, 0x10b7d1b3), RAPIDJSON_UINT64_C2(0x318df905, 0x079926a8), // 10^-147
+        RAPIDJSON_UINT64_C2(0xffbbcfe9, 0x94e5c61f), RAPIDJSON_UINT64_C2(0xfdf17746, 0x497f7052), // 10^-146
+        RAPIDJSON_UINT64_C2(0x9fd561f1, 0xfd0f9bd3), RAPIDJSON_UINT64_C2(0xfeb6ea8b, 0xedefa633), // 10^-145
+        RAPIDJSON_UINT64_C2(0xc7caba6e, 0x7c5382c8), RAPIDJSON_UINT64_C2(0xfe64a52e, 0xe96b8fc0), // 10^-144
+        RAPIDJSON_UINT64_C2(0xf9bd690a, 0x1b68637b), RAPIDJSON_UINT64_C2(0x3dfdce7a, 0xa3c673b0), // 10^-143
+        RAPIDJSON_UINT64_C2(0x9c1661a6, 0x51213e2d), RAPIDJSON_UINT64_C2(0x06bea10c, 0xa65c084e), // 10^-142
+        RAPIDJSON_UINT64_C2(0xc31bfa0f, 0xe5698db8), RAPIDJSON_UINT64_C2(0x486e494f, 0xcff30a62), // 10^-141
+        RAPIDJSON_UINT64_C2(0xf3e2f893, 0xdec3f126), RAPIDJSON_UINT64_C2(0x5a89dba3, 0xc3efccfa), // 10^-140
+        RAPIDJSON_UINT64_C2(0x986ddb5c, 0x6b3a76b7), RAPIDJSON_UINT64_C2(0xf8962946, 0x5a75e01c), // 10^-139
+        RAPIDJSON_UINT64_C2(0xbe895233, 0x86091465), RAPIDJSON_UINT64_C2(0xf6bbb397, 0xf1135823), // 10^-138
+        RAPIDJSON_UINT64_C2(0xee2ba6c0, 0x678b597f), RAPIDJSON_UINT64_C2(0x746aa07d, 0xed582e2c), // 10^-137
+        RAPIDJSON_UINT64_C2(0x94db4838, 0x40b717ef), RAPIDJSON_UINT64_C2(0xa8c2a44e, 0xb4571cdc), // 10^-136
+        RAPIDJSON_UINT64_C2(0xba121a46, 0x50e4ddeb), RAPIDJSON_UINT64_C2(0x92f34d62, 0x616ce413), // 10^-135
+        RAPIDJSON_UINT64_C2(0xe896a0d7, 0xe51e1566), RAPIDJSON_UINT64_C2(0x77b020ba, 0xf9c81d17), // 10^-134
+        RAPIDJSON_UINT64_C2(0x915e2486, 0xef32cd60), RAPIDJSON_UINT64_C2(0x0ace1474, 0xdc1d122e), // 10^-133
+        RAPIDJSON_UINT64_C2(0xb5b5ada8, 0xaaff80b8), RAPIDJSON_UINT64_C2(0x0d819992, 0x132456ba), // 10^-132
+        RAPIDJSON_UINT64_C2(0xe3231912, 0xd5bf60e6), RAPIDJSON_UINT64_C2(0x10e1fff6, 0x97ed6c69), // 10^-131
+        RAPIDJSON_UINT64_C2(0x8df5efab, 0xc5979c8f), RAPIDJSON_UINT64_C2(0xca8d3ffa, 0x1ef463c1), // 10^-130
+        RAPIDJSON_UINT64_C2(0xb1736b96, 0xb6fd83b3), RAPIDJSON_UINT64_C2(0xbd308ff8, 0xa6b17cb2), // 10^-129
+        RAPIDJSON_UINT64_C2(0xddd0467c, 0x64bce4a0), RAPIDJSON_UINT64_C2(0xac7cb3f6, 0xd05ddbde), // 10^-128
+        RAPIDJSON_UINT64_C2(0x8aa22c0d, 0xbef60ee4), RAPIDJSON_UINT64_C2(0x6bcdf07a, 0x423aa96b), // 10^-127
+        RAPIDJSON_UINT64_C2(0xad4ab711, 0x2eb3929d), RAPIDJSON_UINT64_C2(0x86c16c98, 0xd2c953c6), // 10^-126
+        RAPIDJSON_UINT64_C2(0xd89d64d5, 0x7a607744), RAPIDJSON_UINT64_C2(0xe871c7bf, 0x077ba8b7), // 10^-125
+        RAPIDJSON_UINT64_C2(0x87625f05, 0x6c7c4a8b), RAPIDJSON_UINT64_C2(0x11471cd7, 0x64ad4972), // 10^-124
+        RAPIDJSON_UINT64_C2(0xa93af6c6, 0xc79b5d2d), RAPIDJSON_UINT64_C2(0xd598e40d, 0x3dd89bcf), // 10^-123
+        RAPIDJSON_UINT64_C2(0xd389b478, 0x79823479), RAPIDJSON_UINT64_C2(0x4aff1d10, 0x8d4ec2c3), // 10^-122
+        RAPIDJSON_UINT64_C2(0x843610cb, 0x4bf160cb), RAPIDJSON_UINT64_C2(0xcedf722a, 0x585139ba), // 10^-121
+        RAPIDJSON_UINT64_C2(0xa54394fe, 0x1eedb8fe), RAPIDJSON_UINT64_C2(0xc2974eb4, 0xee658828), // 10^-120
+        RAPIDJSON_UINT64_C2(0xce947a3d, 0xa6a9273e), RAPIDJSON_UINT64_C2(0x733d2262, 0x29feea32), // 10^-119
+        RAPIDJSON_UINT64_C2(0x811ccc66, 0x8829b887), RAPIDJSON_UINT64_C2(0x0806357d, 0x5a3f525f), // 10^-118
+        RAPIDJSON_UINT64_C2(0xa163ff80, 0x2a3426a8), RAPIDJSON_UINT64_C2(0xca07c2dc, 0xb0cf26f7), // 10^-117
+        RAPIDJSON_UINT64_C2(0xc9bcff60, 0x34c13052), RAPIDJSON_UINT64_C2(0xfc89b393, 0xdd02f0b5), // 10^-116
+        RAPIDJSON_UINT64_C2(0xfc2c3f38, 0x41f17c67), RAPIDJSON_UINT64_C2(0xbbac2078, 0xd443ace2), // 10^-115
+        RAPIDJSON_UINT64_C2(0x9d9ba783, 0x2936edc0), RAPIDJSON_UINT64_C2(0xd54b944b, 0x84aa4c0d), // 10^-114
+        RAPIDJSON_UINT64_C2(0xc5029163, 0xf384a931), RAPIDJSON_UINT64_C2(0x0a9e795e, 0x65d4df11), // 10^-113
+        RAPIDJSON_UINT64_C2(0xf64335bc, 0xf065d37d), RAPIDJSON_UINT64_C2(0x4d4617b5, 0xff4a16d5), // 10^-112
+        RAPIDJSON_UINT64_C2(0x99ea0196, 0x163fa42e), RAPIDJSON_UINT64_C2(0x504bced1, 0xbf8e4e45), // 10^-111
+        RAPIDJSON_UINT64_C2(0xc06481fb, 0x9bcf8d39), RAPIDJSON_UINT64_C2(0xe45ec286, 0x2f71e1d6), // 10^-110
+        RAPIDJSON_UINT64_C2(0xf07da27a, 0x82c37088), RAPIDJSON_UINT64_C2(0x5d767327, 0xbb4e5a4c), // 10^-109
+        RAPIDJSON_UINT64_C2(0x964e858c, 0x91ba2655), RAPIDJSON_UINT64_C2(0x3a6a07f8, 0xd510f86f), // 10^-108
+        RAPIDJSON_UINT64_C2(0xbbe226ef, 0xb628afea), RAPIDJSON_UINT64_C2(0x890489f7, 0x0a55368b), // 10^-107
+        RAPIDJSON_UINT64_C2(0xeadab0ab, 0xa3b2dbe5), RAPIDJSON_UINT64_C2(0x2b45ac74, 0xccea842e), // 10^-106
+        RAPIDJSON_UINT64_C2(0x92c8ae6b, 0x464fc96f), RAPIDJSON_UINT64_C2(0x3b0b8bc9, 0x0012929d), // 10^-105
+        RAPIDJSON_UINT64_C2(0xb77ada06, 0x17e3bbcb), RAPIDJSON_UINT64_C2(0x09ce6ebb, 0x40173744), // 10^-104
+        RAPIDJSON_UINT64_C2(0xe5599087, 0x9ddcaabd), RAPIDJSON_UINT64_C2(0xcc420a6a, 0x101d0515), // 10^-103
+        RAPIDJSON_UINT64_C2(0x8f57fa54, 0xc2a9eab6), RAPIDJSON_UINT64_C2(0x9fa94682, 0x4a12232d), // 10^-102
+        RAPIDJSON_UINT64_C2(0xb32df8e9, 0xf3546564), RAPIDJSON_UINT64_C2(0x47939822, 0xdc96abf9), // 10^-101
+        RAPIDJSON_UINT64_C2(0xdff97724, 0x70297ebd), RAPIDJSON_UINT64_C2(0x59787e2b, 0x93bc56f7), // 10^-100
+        RAPIDJSON_UINT64_C2(0x8bfbea76, 0xc619ef36), RAPIDJSON_UINT64_C2(0x57eb4edb, 0x3c55b65a), // 10^-99
+        RAPIDJSON_UINT64_C2(0xaefae514, 0x77a06b03), RAPIDJSON_UINT64_C2(0xede62292, 0x0b6b23f1), // 10^-98
+        RAPIDJSON_UINT64_C2(0xdab99e59, 0x958885c4), RAPIDJSON_UINT64_C2(0xe95fab36, 0x8e45eced), // 10^-97
+        RAPIDJSON_UINT64_C2(0x88b402f7, 0xfd75539b), RAPIDJSON_UINT64_C2(0x11dbcb02, 0x18ebb414), // 10^-96
+        RAPIDJSON_UINT64_C2(0xaae103b5, 0xfcd2a881), RAPIDJSON_UINT64_C2(0xd652bdc2, 0x9f26a119), // 10^-95
+        RAPIDJSON_UINT64_C2(0xd59944a3, 0x7c0752a2), RAPIDJSON_UINT64_C2(0x4be76d33, 0x46f0495f), // 10^-94
+        RAPIDJSON_UINT64_C2(0x857fcae6, 0x2d8493a5), RAPIDJSON_UINT64_C2(0x6f70a440, 0x0c562ddb), // 10^-93
+        RAPIDJSON_UINT64_C2(0xa6dfbd9f, 0xb8e5b88e), RAPIDJSON_UINT64_C2(0xcb4ccd50, 0x0f6bb952), // 10^-92
+        RAPIDJSON_UINT64_C2(0xd097ad07, 0xa71f26b2), RAPIDJSON_UINT64_C2(0x7e2000a4, 0x1346a7a7), // 10^-91
+        RAPIDJSON_UINT64_C2(0x825ecc24, 0xc873782f), RAPIDJSON_UINT64_C2(0x8ed40066, 0x8c0c28c8), // 10^-90
+        RAPIDJSON_UINT64_C2(0xa2f67f2d, 0xfa90563b), RAPIDJSON_UINT64_C2(0x72890080, 0x2f0f32fa), // 10^-89
+        RAPIDJSON_UINT64_C2(0xcbb41ef9, 0x79346bca), RAPIDJSON_UINT64_C2(0x4f2b40a0, 0x3ad2ffb9), // 10^-88
+        RAPIDJSON_UINT64_C2(0xfea126b7, 0xd78186bc), RAPIDJSON_UINT64_C2(0xe2f610c8, 0x4987bfa8), // 10^-87
+        RAPIDJSON_UINT64_C2(0x9f24b832, 0xe6b0f436), RAPIDJSON_UINT64_C2(0x0dd9ca7d, 0x2df4d7c9), // 10^-86
+        RAPIDJSON_UINT64_C2(0xc6ede63f, 0xa05d3143), RAPIDJSON_UINT64_C2(0x91503d1c, 0x79720dbb), // 10^-85
+        RAPIDJSON_UINT64_C2(0xf8a95fcf, 0x88747d94), RAPIDJSON_UINT64_C2(0x75a44c63, 0x97ce912a), // 10^-84
+        RAPIDJSON_UINT64_C2(0x9b69dbe1, 0xb548ce7c), RAPIDJSON_UINT64_C2(0xc986afbe, 0x3ee11aba), // 10^-83
+        RAPIDJSON_UINT64_C2(0xc24452da, 0x229b021b), RAPIDJSON_UINT64_C2(0xfbe85bad, 0xce996168), // 10^-82
+        RAPIDJSON_UINT64_C2(0xf2d56790, 0xab41c2a2), RAPIDJSON_UINT64_C2(0xfae27299, 0x423fb9c3), // 10^-81
+        RAPIDJSON_UINT64_C2(0x97c560ba, 0x6b0919a5), RAPIDJSON_UINT64_C2(0xdccd879f, 0xc967d41a), // 10^-80
+        RAPIDJSON_UINT64_C2(0xbdb6b8e9, 0x05cb600f), RAPIDJSON_UINT64_C2(0x5400e987, 0xbbc1c920), // 10^-79
+        RAPIDJSON_UINT64_C2(0xed246723, 0x473e3813), RAPIDJSON_UINT64_C2(0x290123e9, 0xaab23b68), // 10^-78
+        RAPIDJSON_UINT64_C2(0x9436c076, 0x0c86e30b), RAPIDJSON_UINT64_C2(0xf9a0b672, 0x0aaf6521), // 10^-77
+        RAPIDJSON_UINT64_C2(0xb9447093, 0x8fa89bce), RAPIDJSON_UINT64_C2(0xf808e40e, 0x8d5b3e69), // 10^-76
+        RAPIDJSON_UINT64_C2(0xe7958cb8, 0x7392c2c2), RAPIDJSON_UINT64_C2(0xb60b1d12, 0x30b20e04), // 10^-75
+        RAPIDJSON_UINT64_C2(0x90bd77f3, 0x483bb9b9), RAPIDJSON_UINT64_C2(0xb1c6f22b, 0x5e6f48c2), // 10^-74
+        RAPIDJSON_UINT64_C2(0xb4ecd5f0, 0x1a4aa828), RAPIDJSON_UINT64_C2(0x1e38aeb6, 0x360b1af3), // 10^-73
+        RAPIDJSON_UINT64_C2(0xe2280b6c, 0x20dd5232), RAPIDJSON_UINT64_C2(0x25c6da63, 0xc38de1b0), // 10^-72
+        RAPIDJSON_UINT64_C2(0x8d590723, 0x948a535f), RAPIDJSON_UINT64_C2(0x579c487e, 0x5a38ad0e), // 10^-71
+        RAPIDJSON_UINT64_C2(0xb0af48ec, 0x79ace837), RAPIDJSON_UINT64_C2(0x2d835a9d, 0xf0c6d851), // 10^-70
+        RAPIDJSON_UINT64_C2(0xdcdb1b27, 0x98182244), RAPIDJSON_UINT64_C2(0xf8e43145, 0x6cf88e65), // 10^-69
+        RAPIDJSON_UINT64_C2(0x8a08f0f8, 0xbf0f156b), RAPIDJSON_UINT64_C2(0x1b8e9ecb, 0x641b58ff), // 10^-68
+        RAPIDJSON_UINT64_C2(0xac8b2d36, 0xeed2dac5), RAPIDJSON_UINT64_C2(0xe272467e, 0x3d222f3f), // 10^-67
+        RAPIDJSON_UINT64_C2(0xd7adf884, 0xaa879177), RAPIDJSON_UINT64_C2(0x5b0ed81d, 0xcc6abb0f), // 10^-66
+        RAPIDJSON_UINT64_C2(0x86ccbb52, 0xea94baea), RAPIDJSON_UINT64_C2(0x98e94712, 0x9fc2b4e9), // 10^-65
+        RAPIDJSON_UINT64_C2(0xa87fea27, 0xa539e9a5), RAPIDJSON_UINT64_C2(0x3f2398d7, 0x47b36224), // 10^-64
+        RAPIDJSON_UINT64_C2(0xd29fe4b1, 0x8e88640e), RAPIDJSON_UINT64_C2(0x8eec7f0d, 0x19a03aad), // 10^-63
+        RAPIDJSON_UINT64_C2(0x83a3eeee, 0xf9153e89), RAPIDJSON_UINT64_C2(0x1953cf68, 0x300424ac), // 10^-62
+        RAPIDJSON_UINT64_C2(0xa48ceaaa, 0xb75a8e2b), RAPIDJSON_UINT64_C2(0x5fa8c342, 0x3c052dd7), // 10^-61
+        RAPIDJSON_UINT64_C2(0xcdb02555, 0x653131b6), RAPIDJSON_UINT64_C2(0x3792f412, 0xcb06794d), // 10^-60
+        RAPIDJSON_UINT64_C2(0x808e1755, 0x5f3ebf11), RAPIDJSON_UINT64_C2(0xe2bbd88b, 0xbee40bd0), // 10^-59
+        RAPIDJSON_UINT64_C2(0xa0b19d2a, 0xb70e6ed6), RAPIDJSON_UINT64_C2(0x5b6aceae, 0xae9d0ec4), // 10^-58
+        RAPIDJSON_UINT64_C2(0xc8de0475, 0x64d20a8b), RAPIDJSON_UINT64_C2(0xf245825a, 0x5a445275), // 10^-57
+        RAPIDJSON_UINT64_C2(0xfb158592, 0xbe068d2e), RAPIDJSON_UINT64_C2(0xeed6e2f0, 0xf0d56712), // 10^-56
+        RAPIDJSON_UINT64_C2(0x9ced737b, 0xb6c4183d), RAPIDJSON_UINT64_C2(0x55464dd6, 0x9685606b), // 10^-55
+        RAPIDJSON_UINT64_C2(0xc428d05a, 0xa4751e4c), RAPIDJSON_UINT64_C2(0xaa97e14c, 0x3c26b886), // 10^-54
+        RAPIDJSON_UINT64_C2(0xf5330471, 0x4d9265df), RAPIDJSON_UINT64_C2(0xd53dd99f, 0x4b3066a8), // 10^-53
+        RAPIDJSON_UINT64_C2(0x993fe2c6, 0xd07b7fab), RAPIDJSON_UINT64_C2(0xe546a803, 0x8efe4029), // 10^-52
+        RAPIDJSON_UINT64_C2(0xbf8fdb78, 0x849a5f96), RAPIDJSON_UINT64_C2(0xde985204, 0x72bdd033), // 10^-51
+        RAPIDJSON_UINT64_C2(0xef73d256, 0xa5c0f77c), RAPIDJSON_UINT64_C2(0x963e6685, 0x8f6d4440), // 10^-50
+        RAPIDJSON_UINT64_C2(0x95a86376, 0x27989aad), RAPIDJSON_UINT64_C2(0xdde70013, 0x79a44aa8), // 10^-49
+        RAPIDJSON_UINT64_C2(0xbb127c53, 0xb17ec159), RAPIDJSON_UINT64_C2(0x5560c018, 0x580d5d52), // 10^-48
+        RAPIDJSON_UINT64_C2(0xe9d71b68, 0x9dde71af), RAPIDJSON_UINT64_C2(0xaab8f01e, 0x6e10b4a6), // 10^-47
+        RAPIDJSON_UINT64_C2(0x92267121, 0x62ab070d), RAPIDJSON_UINT64_C2(0xcab39613, 0x04ca70e8), // 10^-46
+        RAPIDJSON_UINT64_C2(0xb6b00d69, 0xbb55c8d1), RAPIDJSON_UINT64_C2(0x3d607b97, 0xc5fd0d22), // 10^-45
+        RAPIDJSON_UINT64_C2(0xe45c10c4, 0x2a2b3b05), RAPIDJSON_UINT64_C2(0x8cb89a7d, 0xb77c506a), // 10^-44
+        RAPIDJSON_UINT64_C2(0x8eb98a7a, 0x9a5b04e3), RAPIDJSON_UINT64_C2(0x77f3608e, 0x92adb242), // 10^-43
+        RAPIDJSON_UINT64_C2(0xb267ed19, 0x40f1c61c), RAPIDJSON_UINT64_C2(0x55f038b2, 0x37591ed3), // 10^-42
+        RAPIDJSON_UINT64_C2(0xdf01e85f, 0x912e37a3), RAPIDJSON_UINT64_C2(0x6b6c46de, 0xc52f6688), // 10^-41
+        RAPIDJSON_UINT64_C2(0x8b61313b, 0xbabce2c6), RAPIDJSON_UINT64_C2(0x2323ac4b, 0x3b3da015), // 10^-40
+        RAPIDJSON_UINT64_C2(0xae397d8a, 0xa96c1b77), RAPIDJSON_UINT64_C2(0xabec975e, 0x0a0d081a), // 10^-39
+        RAPIDJSON_UINT64_C2(0xd9c7dced, 0x53c72255), RAPIDJSON_UINT64_C2(0x96e7bd35, 0x8c904a21), // 10^-38
+        RAPIDJSON_UINT64_C2(0x881cea14, 0x545c7575), RAPIDJSON_UINT64_C2(0x7e50d641, 0x77da2e54), // 10^-37
+        RAPIDJSON_UINT64_C2(0xaa242499, 0x697392d2), RAPIDJSON_UINT64_C2(0xdde50bd1, 0xd5d0b9e9), // 10^-36
+        RAPIDJSON_UINT64_C2(0xd4ad2dbf, 0xc3d07787), RAPIDJSON_UINT64_C2(0x955e4ec6, 0x4b44e864), // 10^-35
+        RAPIDJSON_UINT64_C2(0x84ec3c97, 0xda624ab4), RAPIDJSON_UINT64_C2(0xbd5af13b, 0xef0b113e), // 10^-34
+        RAPIDJSON_UINT64_C2(0xa6274bbd, 0xd0fadd61), RAPIDJSON_UINT64_C2(0xecb1ad8a, 0xeacdd58e), // 10^-33
+        RAPIDJSON_UINT64_C2(0xcfb11ead, 0x453994ba), RAPIDJSON_UINT64_C2(0x67de18ed, 0xa5814af2), // 10^-32
+        RAPIDJSON_UINT64_C2(0x81ceb32c, 0x4b43fcf4), RAPIDJSON_UINT64_C2(0x80eacf94, 0x8770ced7), // 10^-31
+        RAPIDJSON_UINT64_C2(0xa2425ff7, 0x5e14fc31), RAPIDJSON_UINT64_C2(0xa1258379, 0xa94d028d), // 10^-30
+        RAPIDJSON_UINT64_C2(0xcad2f7f5, 0x359a3b3e), RAPIDJSON_UINT64_C2(0x096ee458, 0x13a04330), // 10^-29
+        RAPIDJSON_UINT64_C2(0xfd87b5f2, 0x8300ca0d), RAPIDJSON_UINT64_C2(0x8bca9d6e, 0x188853fc), // 10^-28
+        RAPIDJSON_UINT64_C2(0x9e74d1b7, 0x91e07e48), RAPIDJSON_UINT64_C2(0x775ea264, 0xcf55347d), // 10^-27
+        RAPIDJSON_UINT64_C2(0xc6120625, 0x76589dda), RAPIDJSON_UINT64_C2(0x95364afe, 0x032a819d), // 10^-26
+        RAPIDJSON_UINT64_C2(0xf79687ae, 0xd3eec551), RAPIDJSON_UINT64_C2(0x3a83ddbd, 0x83f52204), // 10^-25
+        RAPIDJSON_UINT64_C2(0x9abe14cd, 0x44753b52), RAPIDJSON_UINT64_C2(0xc4926a96, 0x72793542), // 10^-24
+        RAPIDJSON_UINT64_C2(0xc16d9a00, 0x95928a27), RAPIDJSON_UINT64_C2(0x75b7053c, 0x0f178293), // 10^-23
+        RAPIDJSON_UINT64_C2(0xf1c90080, 0xbaf72cb1), RAPIDJSON_UINT64_C2(0x5324c68b, 0x12dd6338), // 10^-22
+        RAPIDJSON_UINT64_C2(0x971da050, 0x74da7bee), RAPIDJSON_UINT64_C2(0xd3f6fc16, 0xebca5e03), // 10^-21
+        RAPIDJSON_UINT64_C2(0xbce50864, 0x92111aea), RAPIDJSON_UINT64_C2(0x88f4bb1c, 0xa6bcf584), // 10^-20
+        RAPIDJSON_UINT64_C2(0xec1e4a7d, 0xb69561a5), RAPIDJSON_UINT64_C2(0x2b31e9e3, 0xd06c32e5), // 10^-19
+        RAPIDJSON_UINT64_C2(0x9392ee8e, 0x921d5d07), RAPIDJSON_UINT64_C2(0x3aff322e, 0x62439fcf), // 10^-18
+        RAPIDJSON_UINT64_C2(0xb877aa32, 0x36a4b449), RAPIDJSON_UINT64_C2(0x09befeb9, 0xfad487c2), // 10^-17
+        RAPIDJSON_UINT64_C2(0xe69594be, 0xc44de15b), RAPIDJSON_UINT64_C2(0x4c2ebe68, 0x7989a9b3), // 10^-16
+        RAPIDJSON_UINT64_C2(0x901d7cf7, 0x3ab0acd9), RAPIDJSON_UINT64_C2(0x0f9d3701, 0x4bf60a10), // 10^-15
+        RAPIDJSON_UINT64_C2(0xb424dc35, 0x095cd80f), RAPIDJSON_UINT64_C2(0x538484c1, 0x9ef38c94), // 10^-14
+        RAPIDJSON_UINT64_C2(0xe12e1342, 0x4bb40e13), RAPIDJSON_UINT64_C2(0x2865a5f2, 0x06b06fb9), // 10^-13
+        RAPIDJSON_UINT64_C2(0x8cbccc09, 0x6f5088cb), RAPIDJSON_UINT64_C2(0xf93f87b7, 0x442e45d3), // 10^-12
+        RAPIDJSON_UINT64_C2(0xafebff0b, 0xcb24aafe), RAPIDJSON_UINT64_C2(0xf78f69a5, 0x1539d748), // 10^-11
+        RAPIDJSON_UINT64_C2(0xdbe6fece, 0xbdedd5be), RAPIDJSON_UINT64_C2(0xb573440e, 0x5a884d1b), // 10^-10
+        RAPIDJSON_UINT64_C2(0x89705f41, 0x36b4a597), RAPIDJSON_UINT64_C2(0x31680a88, 0xf8953030), // 10^-9
+        RAPIDJSON_UINT64_C2(0xabcc7711, 0x8461cefc), RAPIDJSON_UINT64_C2(0xfdc20d2b, 0x36ba7c3d), // 10^-8
+        RAPIDJSON_UINT64_C2(0xd6bf94d5, 0xe57a42bc), RAPIDJSON_UINT64_C2(0x3d329076, 0x04691b4c), // 10^-7
+        RAPIDJSON_UINT64_C2(0x8637bd05, 0xaf6c69b5), RAPIDJSON_UINT64_C2(0xa63f9a49, 0xc2c1b10f), // 10^-6
+        RAPIDJSON_UINT64_C2(0xa7c5ac47, 0x1b478423), RAPIDJSON_UINT64_C2(0x0fcf80dc, 0x33721d53), // 10^-5
+        RAPIDJSON_UINT64_C2(0xd1b71758, 0xe219652b), RAPIDJSON_UINT64_C2(0xd3c36113, 0x404ea4a8), // 10^-4
+        RAPIDJSON_UINT64_C2(0x83126e97, 0x8d4fdf3b), RAPIDJSON_UINT64_C2(0x645a1cac, 0x083126e9), // 10^-3
+        RAPIDJSON_UINT64_C2(0xa3d70a3d, 0x70a3d70a), RAPIDJSON_UINT64_C2(0x3d70a3d7, 0x0a3d70a3), // 10^-2
+        RAPIDJSON_UINT64_C2(0xcccccccc, 0xcccccccc), RAPIDJSON_UINT64_C2(0xcccccccc, 0xcccccccc), // 10^-1
+        RAPIDJSON_UINT64_C2(0x80000000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^0
+        RAPIDJSON_UINT64_C2(0xa0000000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^1
+        RAPIDJSON_UINT64_C2(0xc8000000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^2
+        RAPIDJSON_UINT64_C2(0xfa000000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^3
+        RAPIDJSON_UINT64_C2(0x9c400000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^4
+        RAPIDJSON_UINT64_C2(0xc3500000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^5
+        RAPIDJSON_UINT64_C2(0xf4240000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^6
+        RAPIDJSON_UINT64_C2(0x98968000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^7
+        RAPIDJSON_UINT64_C2(0xbebc2000, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^8
+        RAPIDJSON_UINT64_C2(0xee6b2800, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^9
+        RAPIDJSON_UINT64_C2(0x9502f900, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^10
+        RAPIDJSON_UINT64_C2(0xba43b740, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^11
+        RAPIDJSON_UINT64_C2(0xe8d4a510, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^12
+        RAPIDJSON_UINT64_C2(0x9184e72a, 0x00000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^13
+        RAPIDJSON_UINT64_C2(0xb5e620f4, 0x80000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^14
+        RAPIDJSON_UINT64_C2(0xe35fa931, 0xa0000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^15
+        RAPIDJSON_UINT64_C2(0x8e1bc9bf, 0x04000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^16
+        RAPIDJSON_UINT64_C2(0xb1a2bc2e, 0xc5000000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^17
+        RAPIDJSON_UINT64_C2(0xde0b6b3a, 0x76400000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^18
+        RAPIDJSON_UINT64_C2(0x8ac72304, 0x89e80000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^19
+        RAPIDJSON_UINT64_C2(0xad78ebc5, 0xac620000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^20
+        RAPIDJSON_UINT64_C2(0xd8d726b7, 0x177a8000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^21
+        RAPIDJSON_UINT64_C2(0x87867832, 0x6eac9000), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^22
+        RAPIDJSON_UINT64_C2(0xa968163f, 0x0a57b400), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^23
+        RAPIDJSON_UINT64_C2(0xd3c21bce, 0xcceda100), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^24
+        RAPIDJSON_UINT64_C2(0x84595161, 0x401484a0), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^25
+        RAPIDJSON_UINT64_C2(0xa56fa5b9, 0x9019a5c8), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^26
+        RAPIDJSON_UINT64_C2(0xcecb8f27, 0xf4200f3a), RAPIDJSON_UINT64_C2(0x00000000, 0x00000000), // 10^27
+        RAPIDJSON_UINT64_C2(0x813f3978, 0xf8940984), RAPIDJSON_UINT64_C2(0x40000000, 0x00000000), // 10^28
+        RAPIDJSON_UINT64_C2(0xa18f07d7, 0x36b90be5), RAPIDJSON_UINT64_C2(0x50000000, 0x00000000), // 10^29
+        RAPIDJSON_UINT64_C2(0xc9f2c9cd, 0x04674ede), RAPIDJSON_UINT64_C2(0xa4000000, 0x00000000), // 10^30
+        RAPIDJSON_UINT64_C2(0xfc6f7c40, 0x45812296), RAPIDJSON_UINT64_C2(0x4d000000, 0x00000000), // 10^31
+        RAPIDJSON_UINT64_C2(0x9dc5ada8, 0x2b70b59d), RAPIDJSON_UINT64_C2(0xf0200000, 0x00000000), // 10^32
+        RAPIDJSON_UINT64_C2(0xc5371912, 0x364ce305), RAPIDJSON_UINT64_C2(0x6c280000, 0x00000000), // 10^33
+        RAPIDJSON_UINT64_C2(0xf684df56, 0xc3e01bc6), RAPIDJSON_UINT64_C2(0xc7320000, 0x00000000), // 10^34
+        RAPIDJSON_UINT64_C2(0x9a130b96, 0x3a6c115c), RAPIDJSON_UINT64_C2(0x3c7f4000, 0x00000000), // 10^35
+        RAPIDJSON_UINT64_C2(0xc097ce7b, 0xc90715b3), RAPIDJSON_UINT64_C2(0x4b9f1000, 0x00000000), // 10^36
+        RAPIDJSON_UINT64_C2(0xf0bdc21a, 0xbb48db20), RAPIDJSON_UINT64_C2(0x1e86d400, 0x00000000), // 10^37
+        RAPIDJSON_UINT64_C2(0x96769950, 0xb50d88f4), RAPIDJSON_UINT64_C2(0x13144480, 0x00000000), // 10^38
+        RAPIDJSON_UINT64_C2(0xbc143fa4, 0xe250eb31), RAPIDJSON_UINT64_C2(0x17d955a0, 0x00000000), // 10^39
+        RAPIDJSON_UINT64_C2(0xeb194f8e, 0x1ae525fd), RAPIDJSON_UINT64_C2(0x5dcfab08, 0x00000000), // 10^40
+        RAPIDJSON_UINT64_C2(0x92efd1b8, 0xd0cf37be), RAPIDJSON_UINT64_C2(0x5aa1cae5, 0x00000000), // 10^41
+        RAPIDJSON_UINT64_C2(0xb7abc627, 0x050305ad), RAPIDJSON_UINT64_C2(0xf14a3d9e, 0x40000000), // 10^42
+        RAPIDJSON_UINT64_C2(0xe596b7b0, 0xc643c719), RAPIDJSON_UINT64_C2(0x6d9ccd05, 0xd0000000), // 10^43
+        RAPIDJSON_UINT64_C2(0x8f7e32ce, 0x7bea5c6f), RAPIDJSON_UINT64_C2(0xe4820023, 0xa2000000), // 10^44
+        RAPIDJSON_UINT64_C2(0xb35dbf82, 0x1ae4f38b), RAPIDJSON_UINT64_C2(0xdda2802c, 0x8a800000), // 10^45
+        RAPIDJSON_UINT64_C2(0xe0352f62, 0xa19e306e), RAPIDJSON_UINT64_C2(0xd50b2037, 0xad200000), // 10^46
+        RAPIDJSON_UINT64_C2(0x8c213d9d, 0xa502de45), RAPIDJSON_UINT64_C2(0x4526f422, 0xcc340000), // 10^47
+        RAPIDJSON_UINT64_C2(0xaf298d05, 0x0e4395d6), RAPIDJSON_UINT64_C2(0x9670b12b, 0x7f410000), // 10^48
+        RAPIDJSON_UINT64_C2(0xdaf3f046, 0x51d47b4c), RAPIDJSON_UINT64_C2(0x3c0cdd76, 0x5f114000), // 10^49
+        RAPIDJSON_UINT64_C2(0x88d8762b, 0xf324cd0f), RAPIDJSON_UINT64_C2(0xa5880a69, 0xfb6ac800), // 10^50
+        RAPIDJSON_UINT64_C2(0xab0e93b6, 0xefee0053), RAPIDJSON_UINT64_C2(0x8eea0d04, 0x7a457a00), // 10^51
+        RAPIDJSON_UINT64_C2(0xd5d238a4, 0xabe98068), RAPIDJSON_UINT64_C2(0x72a49045, 0x98d6d880), // 10^52
+        RAPIDJSON_UINT64_C2(0x85a36366, 0xeb71f041), RAPIDJSON_UINT64_C2(0x47a6da2b, 0x7f864750), // 10^53
+        RAPIDJSON_UINT64_C2(0xa70c3c40, 0xa64e6c51), RAPIDJSON_UINT64_C2(0x999090b6, 0x5f67d924), // 10^54
+        RAPIDJSON_UINT64_C2(0xd0cf4b50, 0xcfe20765), RAPIDJSON_UINT64_C2(0xfff4b4e3, 0xf741cf6d), // 10^55
+        RAPIDJSON_UINT64_C2(0x82818f12, 0x81ed449f), RAPIDJSON_UINT64_C2(0xbff8f10e, 0x7a8921a4), // 10^56
+        RAPIDJSON_UINT64_C2(0xa321f2d7, 0x226895c7), RAPIDJSON_UINT64_C2(0xaff72d52, 0x192b6a0d), // 10^57
+        RAPIDJSON_UINT64_C2(0xcbea6f8c, 0xeb02bb39), RAPIDJSON_UINT64_C2(0x9bf4f8a6, 0x9f764490), // 10^58
+        RAPIDJSON_UINT64_C2(0xfee50b70, 0x25c36a08), RAPIDJSON_UINT64_C2(0x02f236d0, 0x4753d5b4), // 10^59
+        RAPIDJSON_UINT64_C2(0x9f4f2726, 0x179a2245), RAPIDJSON_UINT64_C2(0x01d76242, 0x2c946590), // 10^60
+        RAPIDJSON_UINT64_C2(0xc722f0ef, 0x9d80aad6), RAPIDJSON_UINT64_C2(0x424d3ad2, 0xb7b97ef5), // 10^61
+        RAPIDJSON_UINT64_C2(0xf8ebad2b, 0x84e0d58b), RAPIDJSON_UINT64_C2(0xd2e08987, 0x65a7deb2), // 10^62
+        RAPIDJSON_UINT64_C2(0x9b934c3b, 0x330c8577), RAPIDJSON_UINT64_C2(0x63cc55f4, 0x9f88eb2f), // 10^63
+        RAPIDJSON_UINT64_C2(0xc2781f49, 0xffcfa6d5), RAPIDJSON_UINT64_C2(0x3cbf6b71, 0xc76b25fb), // 10^64
+        RAPIDJSON_UINT64_C2(0xf316271c, 0x7fc3908a), RAPIDJSON_UINT64_C2(0x8bef464e, 0x3945ef7a), // 10^65
+        RAPIDJSON_UINT64_C2(0x97edd871, 0xcfda3a56), RAPIDJSON_UINT64_C2(0x97758bf0, 0xe3cbb5ac), // 10^66
+        RAPIDJSON_UINT64_C2(0xbde94e8e, 0x43d0c8ec), RAPIDJSON_UINT64_C2(0x3d52eeed, 0x1cbea317), // 10^67
+        RAPIDJSON_UINT64_C2(0xed63a231, 0xd4c4fb27), RAPIDJSON_UINT64_C2(0x4ca7aaa8, 0x63ee4bdd), // 10^68
+        RAPIDJSON_UINT64_C2(0x945e455f, 0x24fb1cf8), RAPIDJSON_UINT64_C2(0x8fe8caa9, 0x3e74ef6a), // 10^69
+        RAPIDJSON_UINT64_C2(0xb975d6b6, 0xee39e436), RAPIDJSON_UINT64_C2(0xb3e2fd53, 0x8e122b44), // 10^70
+        RAPIDJSON_UINT64_C2(0xe7d34c64, 0xa9c85d44), RAPIDJSON_UINT64_C2(0x60dbbca8, 0x7196b616), // 10^71
+        RAPIDJSON_UINT64_C2(0x90e40fbe, 0xea1d3a4a), RAPIDJSON_UINT64_C2(0xbc8955e9, 0x46fe31cd), // 10^72
+        RAPIDJSON_UINT64_C2(0xb51d13ae, 0xa4a488dd), RAPIDJSON_UINT64_C2(0x6babab63, 0x98bdbe41), // 10^73
+        RAPIDJSON_UINT64_C2(0xe264589a, 0x4dcdab14), RAPIDJSON_UINT64_C2(0xc696963c, 0x7eed2dd1), // 10^74
+        RAPIDJSON_UINT64_C2(0x8d7eb760, 0x70a08aec), RAPIDJSON_UINT64_C2(0xfc1e1de5, 0xcf543ca2), // 10^75
+        RAPIDJSON_UINT64_C2(0xb0de6538, 0x8cc8ada8), RAPIDJSON_UINT64_C2(0x3b25a55f, 0x43294bcb), // 10^76
+        RAPIDJSON_UINT64_C2(0xdd15fe86, 0xaffad912), RAPIDJSON_UINT64_C2(0x49ef0eb7, 0x13f39ebe), // 10^77
+        RAPIDJSON_UINT64_C2(0x8a2dbf14, 0x2dfcc7ab), RAPIDJSON_UINT64_C2(0x6e356932, 0x6c784337), // 10^78
+        RAPIDJSON_UINT64_C2(0xacb92ed9, 0x397bf996), RAPIDJSON_UINT64_C2(0x49c2c37f, 0x07965404), // 10^79
+        RAPIDJSON_UINT64_C2(0xd7e77a8f, 0x87daf7fb), RAPIDJSON_UINT64_C2(0xdc33745e, 0xc97be906), // 10^80
+        RAPIDJSON_UINT64_C2(0x86f0ac99, 0xb4e8dafd), RAPIDJSON_UINT64_C2(0x69a028bb, 0x3ded71a3), // 10^81
+        RAPIDJSON_UINT64_C2(0xa8acd7c0, 0x222311bc), RAPIDJSON_UINT64_C2(0xc40832ea, 0x0d68ce0c), // 10^82
+        RAPIDJSON_UINT64_C2(0xd2d80db0, 0x2aabd62b), RAPIDJSON_UINT64_C2(0xf50a3fa4, 0x90c30190), // 10^83
+        RAPIDJSON_UINT64_C2(0x83c7088e, 0x1aab65db), RAPIDJSON_UINT64_C2(0x792667c6, 0xda79e0fa), // 10^84
+        RAPIDJSON_UINT64_C2(0xa4b8cab1, 0xa1563f52), RAPIDJSON_UINT64_C2(0x577001b8, 0x91185938), // 10^85
+        RAPIDJSON_UINT64_C2(0xcde6fd5e, 0x09abcf26), RAPIDJSON_UINT64_C2(0xed4c0226, 0xb55e6f86), // 10^86
+        RAPIDJSON_UINT64_C2(0x80b05e5a, 0xc60b6178), RAPIDJSON_UINT64_C2(0x544f8158, 0x315b05b4), // 10^87
+        RAPIDJSON_UINT64_C2(0xa0dc75f1, 0x778e39d6), RAPIDJSON_UINT64_C2(0x696361ae, 0x3db1c721), // 10^88
+        RAPIDJSON_UINT64_C2(0xc913936d, 0xd571c84c), RAPIDJSON_UINT64_C2(0x03bc3a19, 0xcd1e38e9), // 10^89
+        RAPIDJSON_UINT64_C2(0xfb587849, 0x4ace3a5f), RAPIDJSON_UINT64_C2(0x04ab48a0, 0x4065c723), // 10^90
+        RAPIDJSON_UINT64_C2(0x9d174b2d, 0xcec0e47b), RAPIDJSON_UINT64_C2(0x62eb0d64, 0x283f9c76), // 10^91
+        RAPIDJSON_UINT64_C2(0xc45d1df9, 0x42711d9a), RAPIDJSON_UINT64_C2(0x3ba5d0bd, 0x324f8394), // 10^92
+        RAPIDJSON_UINT64_C2(0xf5746577, 0x930d6500), RAPIDJSON_UINT64_C2(0xca8f44ec, 0x7ee36479), // 10^93
+        RAPIDJSON_UINT64_C2(0x9968bf6a, 0xbbe85f20), RAPIDJSON_UINT64_C2(0x7e998b13, 0xcf4e1ecb), // 10^94
+        RAPIDJSON_UINT64_C2(0xbfc2ef45, 0x6ae276e8), RAPIDJSON_UINT64_C2(0x9e3fedd8, 0xc321a67e), // 10^95
+        RAPIDJSON_UINT64_C2(0xefb3ab16, 0xc59b14a2), RAPIDJSON_UINT64_C2(0xc5cfe94e, 0xf3ea101e), // 10^96
+        RAPIDJSON_UINT64_C2(0x95d04aee, 0x3b80ece5), RAPIDJSON_UINT64_C2(0xbba1f1d1, 0x58724a12), // 10^97
+        RAPIDJSON_UINT64_C2(0xbb445da9, 0xca61281f), RAPIDJSON_UINT64_C2(0x2a8a6e45, 0xae8edc97), // 10^98
+        RAPIDJSON_UINT64_C2(0xea157514, 0x3cf97226), RAPIDJSON_UINT64_C2(0xf52d09d7, 0x1a3293bd), // 10^99
+        RAPIDJSON_UINT64_C2(0x924d692c, 0xa61be758), RAPIDJSON_UINT64_C2(0x593c2626, 0x705f9c56), // 10^100
+        RAPIDJSON_UINT64_C2(0xb6e0c377, 0xcfa2e12e), RAPIDJSON_UINT64_C2(0x6f8b2fb0, 0x0c77836c), // 10^101
+        RAPIDJSON_UINT64_C2(0xe498f455, 0xc38b997a), RAPIDJSON_UINT64_C2(0x0b6dfb9c, 0x0f956447), // 10^102
+        RAPIDJSON_UINT64_C2(0x8edf98b5, 0x9a373fec), RAPIDJSON_UINT64_C2(0x4724bd41, 0x89bd5eac), // 10^103
+        RAPIDJSON_UINT64_C2(0xb2977ee3, 0x00c50fe7), RAPIDJSON_UINT64_C2(0x58edec91, 0xec2cb657), // 10^104
+        RAPIDJSON_UINT64_C2(0xdf3d5e9b, 0xc0f653e1), RAPIDJSON_UINT64_C2(0x2f2967b6, 0x6737e3ed), // 10^105
+        RAPIDJSON_UINT64_C2(0x8b865b21, 0x5899f46c), RAPIDJSON_UINT64_C2(0xbd79e0d2, 0x0082ee74), // 10^106
+        RAPIDJSON_UINT64_C2(0xae67f1e9, 0xaec07187), RAPIDJSON_UINT64_C2(0xecd85906, 0x80a3aa11), // 10^107
+        RAPIDJSON_UINT64_C2(0xda01ee64, 0x1a708de9), RAPIDJSON_UINT64_C2(0xe80e6f48, 0x20cc9495), // 10^108
+        RAPIDJSON_UINT64_C2(0x884134fe, 0x908658b2), RAPIDJSON_UINT64_C2(0x3109058d, 0x147fdcdd), // 10^109
+        RAPIDJSON_UINT64_C2(0xaa51823e, 0x34a7eede), RAPIDJSON_UINT64_C2(0xbd4b46f0, 0x599fd415), // 10^110
+        RAPIDJSON_UINT64_C2(0xd4e5e2cd, 0xc1d1ea96), RAPIDJSON_UINT64_C2(0x6c9e18ac, 0x7007c91a), // 10^111
+        RAPIDJSON_UINT64_C2(0x850fadc0, 0x9923329e), RAPIDJSON_UINT64_C2(0x03e2cf6b, 0xc604ddb0), // 10^112
+        RAPIDJSON_UINT64_C2(0xa6539930, 0xbf6bff45), RAPIDJSON_UINT64_C2(0x84db8346, 0xb786151c), // 10^113
+        RAPIDJSON_UINT64_C2(0xcfe87f7c, 0xef46ff16), RAPIDJSON_UINT64_C2(0xe6126418, 0x65679a63), // 10^114
+        RAPIDJSON_UINT64_C2(0x81f14fae, 0x158c5f6e), RAPIDJSON_UINT64_C2(0x4fcb7e8f, 0x3f60c07e), // 10^115
+        RAPIDJSON_UINT64_C2(0xa26da399, 0x9aef7749), RAPIDJSON_UINT64_C2(0xe3be5e33, 0x0f38f09d), // 10^116
+        RAPIDJSON_UINT64_C2(0xcb090c80, 0x01ab551c), RAPIDJSON_UINT64_C2(0x5cadf5bf, 0xd3072cc5), // 10^117
+        RAPIDJSON_UINT64_C2(0xfdcb4fa0, 0x02162a63), RAPIDJSON_UINT64_C2(0x73d9732f, 0xc7c8f7f6), // 10^118
+        RAPIDJSON_UINT64_C2(0x9e9f11c4, 0x014dda7e), RAPIDJSON_UINT64_C2(0x2867e7fd, 0xdcdd9afa), // 10^119
+        RAPIDJSON_UINT64_C2(0xc646d635, 0x01a1511d), RAPIDJSON_UINT64_C2(0xb281e1fd, 0x541501b8), // 10^120
+        RAPIDJSON_UINT64_C2(0xf7d88bc2, 0x4209a565), RAPIDJSON_UINT64_C2(0x1f225a7c, 0xa91a4226), // 10^121
+        RAPIDJSON_UINT64_C2(0x9ae75759, 0x6946075f), RAPIDJSON_UINT64_C2(0x3375788d, 0xe9b06958), // 10^122
+        RAPIDJSON_UINT64_C2(0xc1a12d2f, 0xc3978937), RAPIDJSON_UINT64_C2(0x0052d6b1, 0x641c83ae), // 10^123
+        RAPIDJSON_UINT64_C2(0xf209787b, 0xb47d6b84), RAPIDJSON_UINT64_C2(0xc0678c5d, 0xbd23a49a), // 10^124
+        RAPIDJSON_UINT64_C2(0x9745eb4d, 0x50ce6332), RAPIDJSON_UINT64_C2(0xf840b7ba, 0x963646e0), // 10^125
+        RAPIDJSON_UINT64_C2(0xbd176620, 0xa501fbff), RAPIDJSON_UINT64_C2(0xb650e5a9, 0x3bc3d898), // 10^126
+        RAPIDJSON_UINT64_C2(0xec5d3fa8, 0xce427aff), RAPIDJSON_UINT64_C2(0xa3e51f13, 0x8ab4cebe), // 10^127
+        RAPIDJSON_UINT64_C2(0x93ba47c9, 0x80e98cdf), RAPIDJSON_UINT64_C2(0xc66f336c, 0x36b10137), // 10^128
+        RAPIDJSON_UINT64_C2(0xb8a8d9bb, 0xe123f017), RAPIDJSON_UINT64_C2(0xb80b0047, 0x445d4184), // 10^129
+        RAPIDJSON_UINT64_C2(0xe6d3102a, 0xd96cec1d), RAPIDJSON_UINT64_C2(0xa60dc059, 0x157491e5), // 10^130
+        RAPIDJSON_UINT64_C2(0x9043ea1a, 0xc7e41392), RAPIDJSON_UINT64_C2(0x87c89837, 0xad68db2f), // 10^131
+        RAPIDJSON_UINT64_C2(0xb454e4a1, 0x79dd1877), RAPIDJSON_UINT64_C2(0x29babe45, 0x98c311fb), // 10^132
+        RAPIDJSON_UINT64_C2(0xe16a1dc9, 0xd8545e94), RAPIDJSON_UINT64_C2(0xf4296dd6, 0xfef3d67a), // 10^133
+        RAPIDJSON_UINT64_C2(0x8ce2529e, 0x2734bb1d), RAPIDJSON_UINT64_C2(0x1899e4a6, 0x5f58660c), // 10^134
+        RAPIDJSON_UINT64_C2(0xb01ae745, 0xb101e9e4), RAPIDJSON_UINT64_C2(0x5ec05dcf, 0xf72e7f8f), // 10^135
+        RAPIDJSON_UINT64_C2(0xdc21a117, 0x1d42645d), RAPIDJSON_UINT64_C2(0x76707543, 0xf4fa1f73), // 10^136
+        RAPIDJSON_UINT64_C2(0x899504ae, 0x72497eba), RAPIDJSON_UINT64_C2(0x6a06494a, 0x791c53a8), // 10^137
+        RAPIDJSON_UINT64_C2(0xabfa45da, 0x0edbde69), RAPIDJSON_UINT64_C2(0x0487db9d, 0x17636892), // 10^138
+        RAPIDJSON_UINT64_C2(0xd6f8d750, 0x9292d603), RAPIDJSON_UINT64_C2(0x45a9d284, 0x5d3c42b6), // 10^139
+        RAPIDJSON_UINT64_C2(0x865b8692, 0x5b9bc5c2), RAPIDJSON_UINT64_C2(0x0b8a2392, 0xba45a9b2), // 10^140
+        RAPIDJSON_UINT64_C2(0xa7f26836, 0xf282b732), RAPIDJSON_UINT64_C2(0x8e6cac77, 0x68d7141e), // 10^141
+        RAPIDJSON_UINT64_C2(0xd1ef0244, 0xaf2364ff), RAPIDJSON_UINT64_C2(0x3207d795, 0x430cd926), // 10^142
+        RAPIDJSON_UINT64_C2(0x8335616a, 0xed761f1f), RAPIDJSON_UINT64_C2(0x7f44e6bd, 0x49e807b8), // 10^143
+        RAPIDJSON_UINT64_C2(0xa402b9c5, 0xa8d3a6e7), RAPIDJSON_UINT64_C2(0x5f16206c, 0x9c6209a6), // 10^144
+        RAPIDJSON_UINT64_C2(0xcd036837, 0x130890a1), RAPIDJSON_UINT64_C2(0x36dba887, 0xc37a8c0f), // 10^145
+        RAPIDJSON_UINT64_C2(0x80222122, 0x6be55a64), RAPIDJSON_UINT64_C2(0xc2494954, 0xda2c9789), // 10^146
+        RAPIDJSON_UINT64_C2(0xa02aa96b, 0x06deb0fd), RAPIDJSON_UINT64_C2(0xf2db9baa, 0x10b7bd6c), // 10^147
+        RAPIDJSON_UINT64_C2(0xc83553c5, 0xc8965d3d), RAPIDJSON_UINT64_C2(0x6f928294, 0x94e5acc7), // 10^148
+        RAPIDJSON_UINT64_C2(0xfa42a8b7, 0x3abbf48c), RAPIDJSON_UINT64_C2(0xcb772339, 0xba1f17f9), // 10^149
+        RAPIDJSON_UINT64_C2(0x9c69a972, 0x84b578d7), RAPIDJSON_UINT64_C2(0xff2a7604, 0x14536efb), // 10^150
+        RAPIDJSON_UINT64_C2(0xc38413cf, 0x25e2d70d), RAPIDJSON_UINT64_C2(0xfef51385, 0x19684aba), // 10^151
+        RAPIDJSON_UINT64_C2(0xf46518c2, 0xef5b8cd1), RAPIDJSON_UINT64_C2(0x7eb25866, 0x5fc25d69), // 10^152
+        RAPIDJSON_UINT64_C2(0x98bf2f79, 0xd5993802), RAPIDJSON_UINT64_C2(0xef2f773f, 0xfbd97a61), // 10^153
+        RAPIDJSON_UINT64_C2(0xbeeefb58, 0x4aff8603), RAPIDJSON_UINT64_C2(0xaafb550f, 0xfacfd8fa), // 10^154
+        RAPIDJSON_UINT64_C2(0xeeaaba2e, 0x5dbf6784), RAPIDJSON_UINT64_C2(0x95ba2a53, 0xf983cf38), // 10^155
+        RAPIDJSON_UINT64_C2(0x952ab45c, 0xfa97a0b2), RAPIDJSON_UINT64_C2(0xdd945a74, 0x7bf26183), // 10^156
+        RAPIDJSON_UINT64_C2(0xba756174, 0x393d88df), RAPIDJSON_UINT64_C2(0x94f97111, 0x9aeef9e4), // 10^157
+        RAPIDJSON_UINT64_C2(0xe912b9d1, 0x478ceb17), RAPIDJSON_UINT64_C2(0x7a37cd56, 0x01aab85d), // 10^158
+        RAPIDJSON_UINT64_C2(0x91abb422, 0xccb812ee), RAPIDJSON_UINT64_C2(0xac62e055, 0xc10ab33a), // 10^159
+        RAPIDJSON_UINT64_C2(0xb616a12b, 0x7fe617aa), RAPIDJSON_UINT64_C2(0x577b986b, 0x314d6009), // 10^160
+        RAPIDJSON_UINT64_C2(0xe39c4976, 0x5fdf9d94), RAPIDJSON_UINT64_C2(0xed5a7e85, 0xfda0b80b), // 10^161
+        RAPIDJSON_UINT64_C2(0x8e41ade9, 0xfbebc27d), RAPIDJSON_UINT64_C2(0x14588f13, 0xbe847307), // 10^162
+        RAPIDJSON_UINT64_C2(0xb1d21964, 0x7ae6b31c), RAPIDJSON_UINT64_C2(0x596eb2d8, 0xae258fc8), // 10^163
+        RAPIDJSON_UINT64_C2(0xde469fbd, 0x99a05fe3), RAPIDJSON_UINT64_C2(0x6fca5f8e, 0xd9aef3bb), // 10^164
+        RAPIDJSON_UINT64_C2(0x8aec23d6, 0x80043bee), RAPIDJSON_UINT64_C2(0x25de7bb9, 0x480d5854), // 10^165
+        RAPIDJSON_UINT64_C2(0xada72ccc, 0x20054ae9), RAPIDJSON_UINT64_C2(0xaf561aa7, 0x9a10ae6a), // 10^166
+        RAPIDJSON_UINT64_C2(0xd910f7ff, 0x28069da4), RAPIDJSON_UINT64_C2(0x1b2ba151, 0x8094da04), // 10^167
+        RAPIDJSON_UINT64_C2(0x87aa9aff, 0x79042286), RAPIDJSON_UINT64_C2(0x90fb44d2, 0xf05d0842), // 10^168
+        RAPIDJSON_UINT64_C2(0xa99541bf, 0x57452b28), RAPIDJSON_UINT64_C2(0x353a1607, 0xac744a53), // 10^169
+        RAPIDJSON_UINT64_C2(0xd3fa922f, 0x2d1675f2), RAPIDJSON_UINT64_C2(0x42889b89, 0x97915ce8), // 10^170
+        RAPIDJSON_UINT64_C2(0x847c9b5d, 0x7c2e09b7), RAPIDJSON_UINT64_C2(0x69956135, 0xfebada11), // 10^171
+        RAPIDJSON_UINT64_C2(0xa59bc234, 0xdb398c25), RAPIDJSON_UINT64_C2(0x43fab983, 0x7e699095), // 10^172
+        RAPIDJSON_UINT64_C2(0xcf02b2c2, 0x1207ef2e), RAPIDJSON_UINT64_C2(0x94f967e4, 0x5e03f4bb), // 10^173
+        RAPIDJSON_UINT64_C2(0x8161afb9, 0x4b44f57d), RAPIDJSON_UINT64_C2(0x1d1be0ee, 0xbac278f5), // 10^174
+        RAPIDJSON_UINT64_C2(0xa1ba1ba7, 0x9e1632dc), RAPIDJSON_UINT64_C2(0x6462d92a, 0x69731732), // 10^175
+        RAPIDJSON_UINT64_C2(0xca28a291, 0x859bbf93), RAPIDJSON_UINT64_C2(0x7d7b8f75, 0x03cfdcfe), // 10^176
+        RAPIDJSON_UINT64_C2(0xfcb2cb35, 0xe702af78), RAPIDJSON_UINT64_C2(0x5cda7352, 0x44c3d43e), // 10^177
+        RAPIDJSON_UINT64_C2(0x9defbf01, 0xb061adab), RAPIDJSON_UINT64_C2(0x3a088813, 0x6afa64a7), // 10^178
+        RAPIDJSON_UINT64_C2(0xc56baec2, 0x1c7a1916), RAPIDJSON_UINT64_C2(0x088aaa18, 0x45b8fdd0), // 10^179
+        RAPIDJSON_UINT64_C2(0xf6c69a72, 0xa3989f5b), RAPIDJSON_UINT64_C2(0x8aad549e, 0x57273d45), // 10^180
+        RAPIDJSON_UINT64_C2(0x9a3c2087, 0xa63f6399), RAPIDJSON_UINT64_C2(0x36ac54e2, 0xf678864b), // 10^181
+        RAPIDJSON_UINT64_C2(0xc0cb28a9, 0x8fcf3c7f), RAPIDJSON_UINT64_C2(0x84576a1b, 0xb416a7dd), // 10^182
+        RAPIDJSON_UINT64_C2(0xf0fdf2d3, 0xf3c30b9f), RAPIDJSON_UINT64_C2(0x656d44a2, 0xa11c51d5), // 10^183
+        RAPIDJSON_UINT64_C2(0x969eb7c4, 0x7859e743), RAPIDJSON_UINT64_C2(0x9f644ae5, 0xa4b1b325), // 10^184
+        RAPIDJSON_UINT64_C2(0xbc4665b5, 0x96706114), RAPIDJSON_UINT64_C2(0x873d5d9f, 0x0dde1fee), // 10^185
+        RAPIDJSON_UINT64_C2(0xeb57ff22, 0xfc0c7959), RAPIDJSON_UINT64_C2(0xa90cb506, 0xd155a7ea), // 10^186
+        RAPIDJSON_UINT64_C2(0x9316ff75, 0xdd87cbd8), RAPIDJSON_UINT64_C2(0x09a7f124, 0x42d588f2), // 10^187
+        RAPIDJSON_UINT64_C2(0xb7dcbf53, 0x54e9bece), RAPIDJSON_UINT64_C2(0x0c11ed6d, 0x538aeb2f), // 10^188
+        RAPIDJSON_UINT64_C2(0xe5d3ef28, 0x2a242e81), RAPIDJSON_UINT64_C2(0x8f1668c8, 0xa86da5fa), // 10^189
+        RAPIDJSON_UINT64_C2(0x8fa47579, 0x1a569d10), RAPIDJSON_UINT64_C2(0xf96e017d, 0x694487bc), // 10^190
+        RAPIDJSON_UINT64_C2(0xb38d92d7, 0x60ec4455), RAPIDJSON_UINT64_C2(0x37c981dc, 0xc395a9ac), // 10^191
+        RAPIDJSON_UINT64_C2(0xe070f78d, 0x3927556a), RAPIDJSON_UINT64_C2(0x85bbe253, 0xf47b1417), // 10^192
+        RAPIDJSON_UINT64_C2(0x8c469ab8, 0x43b89562), RAPIDJSON_UINT64_C2(0x93956d74, 0x78ccec8e), // 10^193
+        RAPIDJSON_UINT64_C2(0xaf584166, 0x54a6babb), RAPIDJSON_UINT64_C2(0x387ac8d1, 0x970027b2), // 10^194
+        RAPIDJSON_UINT64_C2(0xdb2e51bf, 0xe9d0696a), RAPIDJSON_UINT64_C2(0x06997b05, 0xfcc0319e), // 10^195
+        RAPIDJSON_UINT64_C2(0x88fcf317, 0xf22241e2), RAPIDJSON_UINT64_C2(0x441fece3, 0xbdf81f03), // 10^196
+        RAPIDJSON_UINT64_C2(0xab3c2fdd, 0xeeaad25a), RAPIDJSON_UINT64_C2(0xd527e81c, 0xad7626c3), // 10^197
+        RAPIDJSON_UINT64_C2(0xd60b3bd5, 0x6a5586f1), RAPIDJSON_UINT64_C2(0x8a71e223, 0xd8d3b074), // 10^198
+        RAPIDJSON_UINT64_C2(0x85c70565, 0x62757456), RAPIDJSON_UINT64_C2(0xf6872d56, 0x67844e49), // 10^199
+        RAPIDJSON_UINT64_C2(0xa738c6be, 0xbb12d16c), RAPIDJSON_UINT64_C2(0xb428f8ac, 0x016561db), // 10^200
+        RAPIDJSON_UINT64_C2(0xd106f86e, 0x69d785c7), RAPIDJSON_UINT64_C2(0xe13336d7, 0x01beba52), // 10^201
+        RAPIDJSON_UINT64_C2(0x82a45b45, 0x0226b39c), RAPIDJSON_UINT64_C2(0xecc00246, 0x61173473), // 10^202
+        RAPIDJSON_UINT64_C2(0xa34d7216, 0x42b06084), RAPIDJSON_UINT64_C2(0x27f002d7, 0xf95d0190), // 10^203
+        RAPIDJSON_UINT64_C2(0xcc20ce9b, 0xd35c78a5), RAPIDJSON_UINT64_C2(0x31ec038d, 0xf7b441f4), // 10^204
+        RAPIDJSON_UINT64_C2(0xff290242, 0xc83396ce), RAPIDJSON_UINT64_C2(0x7e670471, 0x75a15271), // 10^205
+        RAPIDJSON_UINT64_C2(0x9f79a169, 0xbd203e41), RAPIDJSON_UINT64_C2(0x0f0062c6, 0xe984d386), // 10^206
+        RAPIDJSON_UINT64_C2(0xc75809c4, 0x2c684dd1), RAPIDJSON_UINT64_C2(0x52c07b78, 0xa3e60868), // 10^207
+        RAPIDJSON_UINT64_C2(0xf92e0c35, 0x37826145), RAPIDJSON_UINT64_C2(0xa7709a56, 0xccdf8a82), // 10^208
+        RAPIDJSON_UINT64_C2(0x9bbcc7a1, 0x42b17ccb), RAPIDJSON_UINT64_C2(0x88a66076, 0x400bb691), // 10^209
+        RAPIDJSON_UINT64_C2(0xc2abf989, 0x935ddbfe), RAPIDJSON_UINT64_C2(0x6acff893, 0xd00ea435), // 10^210
+        RAPIDJSON_UINT64_C2(0xf356f7eb, 0xf83552fe), RAPIDJSON_UINT64_C2(0x0583f6b8, 0xc4124d43), // 10^211
+        RAPIDJSON_UINT64_C2(0x98165af3, 0x7b2153de), RAPIDJSON_UINT64_C2(0xc3727a33, 0x7a8b704a), // 10^212
+        RAPIDJSON_UINT64_C2(0xbe1bf1b0, 0x59e9a8d6), RAPIDJSON_UINT64_C2(0x744f18c0, 0x592e4c5c), // 10^213
+        RAPIDJSON_UINT64_C2(0xeda2ee1c, 0x7064130c), RAPIDJSON_UINT64_C2(0x1162def0, 0x6f79df73), // 10^214
+        RAPIDJSON_UINT64_C2(0x9485d4d1, 0xc63e8be7), RAPIDJSON_UINT64_C2(0x8addcb56, 0x45ac2ba8), // 10^215
+        RAPIDJSON_UINT64_C2(0xb9a74a06, 0x37ce2ee1), RAPIDJSON_UINT64_C2(0x6d953e2b, 0xd7173692), // 10^216
+        RAPIDJSON_UINT64_C2(0xe8111c87, 0xc5c1ba99), RAPIDJSON_UINT64_C2(0xc8fa8db6, 0xccdd0437), // 10^217
+        RAPIDJSON_UINT64_C2(0x910ab1d4, 0xdb9914a0), RAPIDJSON_UINT64_C2(0x1d9c9892, 0x400a22a2), // 10^218
+        RAPIDJSON_UINT64_C2(0xb54d5e4a, 0x127f59c8), RAPIDJSON_UINT64_C2(0x2503beb6, 0xd00cab4b), // 10^219
+        RAPIDJSON_UINT64_C2(0xe2a0b5dc, 0x971f303a), RAPIDJSON_UINT64_C2(0x2e44ae64, 0x840fd61d), // 10^220
+        RAPIDJSON_UINT64_C2(0x8da471a9, 0xde737e24), RAPIDJSON_UINT64_C2(0x5ceaecfe, 0xd289e5d2), // 10^221
+        RAPIDJSON_UINT64_C2(0xb10d8e14, 0x56105dad), RAPIDJSON_UINT64_C2(0x7425a83e, 0x872c5f47), // 10^222
+        RAPIDJSON_UINT64_C2(0xdd50f199, 0x6b947518), RAPIDJSON_UINT64_C2(0xd12f124e, 0x28f77719), // 10^223
+        RAPIDJSON_UINT64_C2(0x8a5296ff, 0xe33cc92f), RAPIDJSON_UINT64_C2(0x82bd6b70, 0xd99aaa6f), // 10^224
+        RAPIDJSON_UINT64_C2(0xace73cbf, 0xdc0bfb7b), RAPIDJSON_UINT64_C2(0x636cc64d, 0x1001550b), // 10^225
+        RAPIDJSON_UINT64_C2(0xd8210bef, 0xd30efa5a), RAPIDJSON_UINT64_C2(0x3c47f7e0, 0x5401aa4e), // 10^226
+        RAPIDJSON_UINT64_C2(0x8714a775, 0xe3e95c78), RAPIDJSON_UINT64_C2(0x65acfaec, 0x34810a71), // 10^227
+        RAPIDJSON_UINT64_C2(0xa8d9d153, 0x5ce3b396), RAPIDJSON_UINT64_C2(0x7f1839a7, 0x41a14d0d), // 10^228
+        RAPIDJSON_UINT64_C2(0xd31045a8, 0x341ca07c), RAPIDJSON_UINT64_C2(0x1ede4811, 0x1209a050), // 10^229
+        RAPIDJSON_UINT64_C2(0x83ea2b89, 0x2091e44d), RAPIDJSON_UINT64_C2(0x934aed0a, 0xab460432), // 10^230
+        RAPIDJSON_UINT64_C2(0xa4e4b66b, 0x68b65d60), RAPIDJSON_UINT64_C2(0xf81da84d, 0x5617853f), // 10^231
+        RAPIDJSON_UINT64_C2(0xce1de406, 0x42e3f4b9), RAPIDJSON_UINT64_C2(0x36251260, 0xab9d668e), // 10^232
+        RAPIDJSON_UINT64_C2(0x80d2ae83, 0xe9ce78f3), RAPIDJSON_UINT64_C2(0xc1d72b7c, 0x6b426019), // 10^233
+        RAPIDJSON_UINT64_C2(0xa1075a24, 0xe4421730), RAPIDJSON_UINT64_C2(0xb24cf65b, 0x8612f81f), // 10^234
+        RAPIDJSON_UINT64_C2(0xc94930ae, 0x1d529cfc), RAPIDJSON_UINT64_C2(0xdee033f2, 0x6797b627), // 10^235
+        RAPIDJSON_UINT64_C2(0xfb9b7cd9, 0xa4a7443c), RAPIDJSON_UINT64_C2(0x169840ef, 0x017da3b1), // 10^236
+        RAPIDJSON_UINT64_C2(0x9d412e08, 0x06e88aa5), RAPIDJSON_UINT64_C2(0x8e1f2895, 0x60ee864e), // 10^237
+        RAPIDJSON_UINT64_C2(0xc491798a, 0x08a2ad4e), RAPIDJSON_UINT64_C2(0xf1a6f2ba, 0xb92a27e2), // 10^238
+        RAPIDJSON_UINT64_C2(0xf5b5d7ec, 0x8acb58a2), RAPIDJSON_UINT64_C2(0xae10af69, 0x6774b1db), // 10^239
+        RAPIDJSON_UINT64_C2(0x9991a6f3, 0xd6bf1765), RAPIDJSON_UINT64_C2(0xacca6da1, 0xe0a8ef29), // 10^240
+        RAPIDJSON_UINT64_C2(0xbff610b0, 0xcc6edd3f), RAPIDJSON_UINT64_C2(0x17fd090a, 0x58d32af3), // 10^241
+        RAPIDJSON_UINT64_C2(0xeff394dc, 0xff8a948e), RAPIDJSON_UINT64_C2(0xddfc4b4c, 0xef07f5b0), // 10^242
+        RAPIDJSON_UINT64_C2(0x95f83d0a, 0x1fb69cd9), RAPIDJSON_UINT64_C2(0x4abdaf10, 0x1564f98e), // 10^243
+        RAPIDJSON_UINT64_C2(0xbb764c4c, 0xa7a4440f), RAPIDJSON_UINT64_C2(0x9d6d1ad4, 0x1abe37f1), // 10^244
+        RAPIDJSON_UINT64_C2(0xea53df5f, 0xd18d5513), RAPIDJSON_UINT64_C2(0x84c86189, 0x216dc5ed), // 10^245
+        RAPIDJSON_UINT64_C2(0x92746b9b, 0xe2f8552c), RAPIDJSON_UINT64_C2(0x32fd3cf5, 0xb4e49bb4), // 10^246
+        RAPIDJSON_UINT64_C2(0xb7118682, 0xdbb66a77), RAPIDJSON_UINT64_C2(0x3fbc8c33, 0x221dc2a1), // 10^247
+        RAPIDJSON_UINT64_C2(0xe4d5e823, 0x92a40515), RAPIDJSON_UINT64_C2(0x0fabaf3f, 0xeaa5334a), // 10^248
+        RAPIDJSON_UINT64_C2(0x8f05b116, 0x3ba6832d), RAPIDJSON_UINT64_C2(0x29cb4d87, 0xf2a7400e), // 10^249
+        RAPIDJSON_UINT64_C2(0xb2c71d5b, 0xca9023f8), RAPIDJSON_UINT64_C2(0x743e20e9, 0xef511012), // 10^250
+        RAPIDJSON_UINT64_C2(0xdf78e4b2, 0xbd342cf6), RAPIDJSON_UINT64_C2(0x914da924, 0x6b255416), // 10^251
+        RAPIDJSON_UINT64_C2(0x8bab8eef, 0xb6409c1a), RAPIDJSON_UINT64_C2(0x1ad089b6, 0xc2f7548e), // 10^252
+        RAPIDJSON_UINT64_C2(0xae9672ab, 0xa3d0c320), RAPIDJSON_UINT64_C2(0xa184ac24, 0x73b529b1), // 10^253
+        RAPIDJSON_UINT64_C2(0xda3c0f56, 0x8cc4f3e8), RAPIDJSON_UINT64_C2(0xc9e5d72d, 0x90a2741e), // 10^254
+        RAPIDJSON_UINT64_C2(0x88658996, 0x17fb1871), RAPIDJSON_UINT64_C2(0x7e2fa67c, 0x7a658892), // 10^255
+        RAPIDJSON_UINT64_C2(0xaa7eebfb, 0x9df9de8d), RAPIDJSON_UINT64_C2(0xddbb901b, 0x98feeab7), // 10^256
+        RAPIDJSON_UINT64_C2(0xd51ea6fa, 0x85785631), RAPIDJSON_UINT64_C2(0x552a7422, 0x7f3ea565), // 10^257
+        RAPIDJSON_UINT64_C2(0x8533285c, 0x936b35de), RAPIDJSON_UINT64_C2(0xd53a8895, 0x8f87275f), // 10^258
+        RAPIDJSON_UINT64_C2(0xa67ff273, 0xb8460356), RAPIDJSON_UINT64_C2(0x8a892aba, 0xf368f137), // 10^259
+        RAPIDJSON_UINT64_C2(0xd01fef10, 0xa657842c), RAPIDJSON_UINT64_C2(0x2d2b7569, 0xb0432d85), // 10^260
+        RAPIDJSON_UINT64_C2(0x8213f56a, 0x67f6b29b), RAPIDJSON_UINT64_C2(0x9c3b2962, 0x0e29fc73), // 10^261
+        RAPIDJSON_UINT64_C2(0xa298f2c5, 0x01f45f42), RAPIDJSON_UINT64_C2(0x8349f3ba, 0x91b47b8f), // 10^262
+        RAPIDJSON_UINT64_C2(0xcb3f2f76, 0x42717713), RAPIDJSON_UINT64_C2(0x241c70a9, 0x36219a73), // 10^263
+        RAPIDJSON_UINT64_C2(0xfe0efb53, 0xd30dd4d7), RAPIDJSON_UINT64_C2(0xed238cd3, 0x83aa0110), // 10^264
+        RAPIDJSON_UINT64_C2(0x9ec95d14, 0x63e8a506), RAPIDJSON_UINT64_C2(0xf4363804, 0x324a40aa), // 10^265
+        RAPIDJSON_UINT64_C2(0xc67bb459, 0x7ce2ce48), RAPIDJSON_UINT64_C2(0xb143c605, 0x3edcd0d5), // 10^266
+        RAPIDJSON_UINT64_C2(0xf81aa16f, 0xdc1b81da), RAPIDJSON_UINT64_C2(0xdd94b786, 0x8e94050a), // 10^267
+        RAPIDJSON_UINT64_C2(0x9b10a4e5, 0xe9913128), RAPIDJSON_UINT64_C2(0xca7cf2b4, 0x191c8326), // 10^268
+        RAPIDJSON_UINT64_C2(0xc1d4ce1f, 0x63f57d72), RAPIDJSON_UINT64_C2(0xfd1c2f61, 0x1f63a3f0), // 10^269
+        RAPIDJSON_UINT64_C2(0xf24a01a7, 0x3cf2dccf), RAPIDJSON_UINT64_C2(0xbc633b39, 0x673c8cec), // 10^270
+        RAPIDJSON_UINT64_C2(0x976e4108, 0x8617ca01), RAPIDJSON_UINT64_C2(0xd5be0503, 0xe085d813), // 10^271
+        RAPIDJSON_UINT64_C2(0xbd49d14a, 0xa79dbc82), RAPIDJSON_UINT64_C2(0x4b2d8644, 0xd8a74e18), // 10^272
+        RAPIDJSON_UINT64_C2(0xec9c459d, 0x51852ba2), RAPIDJSON_UINT64_C2(0xddf8e7d6, 0x0ed1219e), // 10^273
+        RAPIDJSON_UINT64_C2(0x93e1ab82, 0x52f33b45), RAPIDJSON_UINT64_C2(0xcabb90e5, 0xc942b503), // 10^274
+        RAPIDJSON_UINT64_C2(0xb8da1662, 0xe7b00a17), RAPIDJSON_UINT64_C2(0x3d6a751f, 0x3b936243), // 10^275
+        RAPIDJSON_UINT64_C2(0xe7109bfb, 0xa19c0c9d), RAPIDJSON_UINT64_C2(0x0cc51267, 0x0a783ad4), // 10^276
+        RAPIDJSON_UINT64_C2(0x906a617d, 0x450187e2), RAPIDJSON_UINT64_C2(0x27fb2b80, 0x668b24c5), // 10^277
+        RAPIDJSON_UINT64_C2(0xb484f9dc, 0x9641e9da), RAPIDJSON_UINT64_C2(0xb1f9f660, 0x802dedf6), // 10^278
+        RAPIDJSON_UINT64_C2(0xe1a63853, 0xbbd26451), RAPIDJSON_UINT64_C2(0x5e7873f8, 0xa0396973), // 10^279
+        RAPIDJSON_UINT64_C2(0x8d07e334, 0x55637eb2), RAPIDJSON_UINT64_C2(0xdb0b487b, 0x6423e1e8), // 10^280
+        RAPIDJSON_UINT64_C2(0xb049dc01, 0x6abc5e5f), RAPIDJSON_UINT64_C2(0x91ce1a9a, 0x3d2cda62), // 10^281
+        RAPIDJSON_UINT64_C2(0xdc5c5301, 0xc56b75f7), RAPIDJSON_UINT64_C2(0x7641a140, 0xcc7810fb), // 10^282
+        RAPIDJSON_UINT64_C2(0x89b9b3e1, 0x1b6329ba), RAPIDJSON_UINT64_C2(0xa9e904c8, 0x7fcb0a9d), // 10^283
+        RAPIDJSON_UINT64_C2(0xac2820d9, 0x623bf429), RAPIDJSON_UINT64_C2(0x546345fa, 0x9fbdcd44), // 10^284
+        RAPIDJSON_UINT64_C2(0xd732290f, 0xbacaf133), RAPIDJSON_UINT64_C2(0xa97c1779, 0x47ad4095), // 10^285
+        RAPIDJSON_UINT64_C2(0x867f59a9, 0xd4bed6c0), RAPIDJSON_UINT64_C2(0x49ed8eab, 0xcccc485d), // 10^286
+        RAPIDJSON_UINT64_C2(0xa81f3014, 0x49ee8c70), RAPIDJSON_UINT64_C2(0x5c68f256, 0xbfff5a74), // 10^287
+        RAPIDJSON_UINT64_C2(0xd226fc19, 0x5c6a2f8c), RAPIDJSON_UINT64_C2(0x73832eec, 0x6fff3111), // 10^288
+        RAPIDJSON_UINT64_C2(0x83585d8f, 0xd9c25db7), RAPIDJSON_UINT64_C2(0xc831fd53, 0xc5ff7eab), // 10^289
+        RAPIDJSON_UINT64_C2(0xa42e74f3, 0xd032f525), RAPIDJSON_UINT64_C2(0xba3e7ca8, 0xb77f5e55), // 10^290
+        RAPIDJSON_UINT64_C2(0xcd3a1230, 0xc43fb26f), RAPIDJSON_UINT64_C2(0x28ce1bd2, 0xe55f35eb), // 10^291
+        RAPIDJSON_UINT64_C2(0x80444b5e, 0x7aa7cf85), RAPIDJSON_UINT64_C2(0x7980d163, 0xcf5b81b3), // 10^292
+        RAPIDJSON_UINT64_C2(0xa0555e36, 0x1951c366), RAPIDJSON_UINT64_C2(0xd7e105bc, 0xc332621f), // 10^293
+        RAPIDJSON_UINT64_C2(0xc86ab5c3, 0x9fa63440), RAPIDJSON_UINT64_C2(0x8dd9472b, 0xf3fefaa7), // 10^294
+        RAPIDJSON_UINT64_C2(0xfa856334, 0x878fc150), RAPIDJSON_UINT64_C2(0xb14f98f6, 0xf0feb951), // 10^295
+        RAPIDJSON_UINT64_C2(0x9c935e00, 0xd4b9d8d2), RAPIDJSON_UINT64_C2(0x6ed1bf9a, 0x569f33d3), // 10^296
+        RAPIDJSON_UINT64_C2(0xc3b83581, 0x09e84f07), RAPIDJSON_UINT64_C2(0x0a862f80, 0xec4700c8), // 10^297
+        RAPIDJSON_UINT64_C2(0xf4a642e1, 0x4c6262c8), RAPIDJSON_UINT64_C2(0xcd27bb61, 0x2758c0fa), // 10^298
+        RAPIDJSON_UINT64_C2(0x98e7e9cc, 0xcfbd7dbd), RAPIDJSON_UINT64_C2(0x8038d51c, 0xb897789c), // 10^299
+        RAPIDJSON_UINT64_C2(0xbf21e440, 0x03acdd2c), RAPIDJSON_UINT64_C2(0xe0470a63, 0xe6bd56c3), // 10^300
+        RAPIDJSON_UINT64_C2(0xeeea5d50, 0x04981478), RAPIDJSON_UINT64_C2(0x1858ccfc, 0xe06cac74), // 10^301
+        RAPIDJSON_UINT64_C2(0x95527a52, 0x02df0ccb), RAPIDJSON_UINT64_C2(0x0f37801e, 0x0c43ebc8), // 10^302
+        RAPIDJSON_UINT64_C2(0xbaa718e6, 0x8396cffd), RAPIDJSON_UINT64_C2(0xd3056025, 0x8f54e6ba), // 10^303
+        RAPIDJSON_UINT64_C2(0xe950df20, 0x247c83fd), RAPIDJSON_UINT64_C2(0x47c6b82e, 0xf32a2069), // 10^304
+        RAPIDJSON_UINT64_C2(0x91d28b74, 0x16cdd27e), RAPIDJSON_UINT64_C2(0x4cdc331d, 0x57fa5441), // 10^305
+        RAPIDJSON_UINT64_C2(0xb6472e51, 0x1c81471d), RAPIDJSON_UINT64_C2(0xe0133fe4, 0xadf8e952), // 10^306
+        RAPIDJSON_UINT64_C2(0xe3d8f9e5, 0x63a198e5), RAPIDJSON_UINT64_C2(0x58180fdd, 0xd97723a6), // 10^307
+        RAPIDJSON_UINT64_C2(0x8e679c2f, 0x5e44ff8f), RAPIDJSON_UINT64_C2(0x570f09ea, 0xa7ea7648), // 10^308
+        RAPIDJSON_UINT64_C2(0xb201833b, 0x35d63f73), RAPIDJSON_UINT64_C2(0x2cd2cc65, 0x51e513da), // 10^309
+        RAPIDJSON_UINT64_C2(0xde81e40a, 0x034bcf4f), RAPIDJSON_UINT64_C2(0xf8077f7e, 0xa65e58d1), // 10^310
+        RAPIDJSON_UINT64_C2(0x8b112e86, 0x420f6191), RAPIDJSON_UINT64_C2(0xfb04afaf, 0x27faf782), // 10^311
+        RAPIDJSON_UINT64_C2(0xadd57a27, 0xd29339f6), RAPIDJSON_UINT64_C2(0x79c5db9a, 0xf1f9b563), // 10^312
+        RAPIDJSON_UINT64_C2(0xd94ad8b1, 0xc7380874), RAPIDJSON_UINT64_C2(0x18375281, 0xae7822bc), // 10^313
+        RAPIDJSON_UINT64_C2(0x87cec76f, 0x1c830548), RAPIDJSON_UINT64_C2(0x8f229391, 0x0d0b15b5), // 10^314
+        RAPIDJSON_UINT64_C2(0xa9c2794a, 0xe3a3c69a), RAPIDJSON_UINT64_C2(0xb2eb3875, 0x504ddb22), // 10^315
+        RAPIDJSON_UINT64_C2(0xd433179d, 0x9c8cb841), RAPIDJSON_UINT64_C2(0x5fa60692, 0xa46151eb), // 10^316
+        RAPIDJSON_UINT64_C2(0x849feec2, 0x81d7f328), RAPIDJSON_UINT64_C2(0xdbc7c41b, 0xa6bcd333), // 10^317
+        RAPIDJSON_UINT64_C2(0xa5c7ea73, 0x224deff3), RAPIDJSON_UINT64_C2(0x12b9b522, 0x906c0800), // 10^318
+        RAPIDJSON_UINT64_C2(0xcf39e50f, 0xeae16bef), RAPIDJSON_UINT64_C2(0xd768226b, 0x34870a00), // 10^319
+        RAPIDJSON_UINT64_C2(0x81842f29, 0xf2cce375), RAPIDJSON_UINT64_C2(0xe6a11583, 0x00d46640), // 10^320
+        RAPIDJSON_UINT64_C2(0xa1e53af4, 0x6f801c53), RAPIDJSON_UINT64_C2(0x60495ae3, 0xc1097fd0), // 10^321
+        RAPIDJSON_UINT64_C2(0xca5e89b1, 0x8b602368), RAPIDJSON_UINT64_C2(0x385bb19c, 0xb14bdfc4), // 10^322
+        RAPIDJSON_UINT64_C2(0xfcf62c1d, 0xee382c42), RAPIDJSON_UINT64_C2(0x46729e03, 0xdd9ed7b5), // 10^323
+        RAPIDJSON_UINT64_C2(0x9e19db92, 0xb4e31ba9), RAPIDJSON_UINT64_C2(0x6c07a2c2, 0x6a8346d1), // 10^324
+        RAPIDJSON_UINT64_C2(0xc5a05277, 0x621be293), RAPIDJSON_UINT64_C2(0xc7098b73, 0x05241885), // 10^325
+        RAPIDJSON_UINT64_C2(0xf7086715, 0x3aa2db38), RAPIDJSON_UINT64_C2(0xb8cbee4f, 0xc66d1ea7), // 10^326
+    };
+    RAPIDJSON_ASSERT(e >= kPow10Significand128MinExponent && e <= kPow10Significand128MaxExponent);
+    const size_t index = static_cast<size_t>(e - kPow10Significand128MinExponent) * 2;
+    *lo = kSignificands[index + 1];
+    return kSignificands[index];
+}
+
 } // namespace internal
 RAPIDJSON_NAMESPACE_END
 
@@ -18,6 +18,12 @@
 #include "../allocators.h"
 #include "../stream.h"
 #include "stack.h"
+#include <algorithm>
+
+#if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42) || defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+#include "simd.h"
+#include <emmintrin.h>
+#endif
 
 #ifdef __clang__
 RAPIDJSON_DIAG_PUSH
@@ -109,6 +115,12 @@ class GenericRegexSearch;
     \note This is a Thompson NFA engine, implemented with reference to 
         Cox, Russ. "Regular Expression Matching Can Be Simple And Fast (but is slow in Java, Perl, PHP, Python, Ruby,...).", 
         https://swtch.com/~rsc/regexp/regexp1.html 
+
+    \note After parsing, the codepoints are split into classes which no state tells
+        apart, and the literal prefix of all matches is extracted. GenericRegexSearch
+        uses them to build a DFA lazily and to skip to candidate positions.
+        A GenericRegex is not modified by searching, so it can be shared by threads
+        each using its own GenericRegexSearch.
 */
 template <typename Encoding, typename Allocator = CrtAllocator>
 class GenericRegex {
@@ -120,11 +132,13 @@ public:
     GenericRegex(const Ch* source, Allocator* allocator = 0) : 
         ownAllocator_(allocator ? 0 : RAPIDJSON_NEW(Allocator)()), allocator_(allocator ? allocator : ownAllocator_), 
         states_(allocator_, 256), ranges_(allocator_, 256), root_(kRegexInvalidState), stateCount_(), rangeCount_(), 
-        anchorBegin_(), anchorEnd_()
+        anchorBegin_(), anchorEnd_(), boundaries_(allocator_, 0), prefix_(allocator_, 0), classCount_(1)
     {
         GenericStringStream<Encoding> ss(source);
         DecodedStream<GenericStringStream<Encoding>, Encoding> ds(ss);
         Parse(ds);
+        if (IsValid())
+            Analyze();
     }
 
     ~GenericRegex()
@@ -163,6 +177,14 @@ private:
         unsigned codepoint;
     };
 
+    //! Output stream encoding the literal prefix.
+    struct PrefixStream {
+        typedef typename Encoding::Ch Ch;
+        PrefixStream(Stack<Allocator>& s) : s_(s) {}
+        void Put(Ch c) { *s_.template Push<Ch>() = c; }
+        Stack<Allocator>& s_;
+    };
+
     struct Frag {
         Frag(SizeType s, SizeType o, SizeType m) : start(s), out(o), minIndex(m) {}
         SizeType start;
@@ -319,6 +341,59 @@ private:
         }
     }
 
+    //! Computes the codepoint classes and the literal prefix.
+    void Analyze() {
+        // A literal c or a range [start, end] accepts the same for all codepoints between boundaries.
+        for (SizeType i = 0; i < stateCount_; i++) {
+            const State& s = GetState(i);
+            if (s.out1 != kRegexInvalidState || s.out == kRegexInvalidState || s.codepoint == kAnyCharacterClass)
+                continue;
+            if (s.codepoint == kRangeCharacterClass) {
+                for (SizeType r = s.rangeStart; r != kRegexInvalidRange; r = GetRange(r).next)
+                    AddBoundaries(GetRange(r).start & ~kRangeNegationFlag, GetRange(r).end);
+            }
+            else
+                AddBoundaries(s.codepoint, s.codepoint);
+        }
+        unsigned* begin = boundaries_.template Bottom<unsigned>();
+        unsigned* end = boundaries_.template End<unsigned>();
+        std::sort(begin, end);
+        boundaries_.template Pop<unsigned>(static_cast<size_t>(end - std::unique(begin, end)));
+        classCount_ = static_cast<SizeType>(boundaries_.GetSize() / sizeof(unsigned)) + 1;
+        for (unsigned c = 0; c < 128; c++)
+            asciiClasses_[c] = FindClass(c);
+
+        // Follow the literals from root until a split or a character class.
+        PrefixStream ps(prefix_);
+        for (SizeType i = root_; ;) {
+            const State& s = GetState(i);
+            if (s.out1 != kRegexInvalidState || s.out == kRegexInvalidState ||
+                s.codepoint == kAnyCharacterClass || s.codepoint == kRangeCharacterClass)
+                break;
+            Encoding::Encode(ps, s.codepoint);
+            i = s.out;
+        }
+    }
+
+    void AddBoundaries(unsigned start, unsigned end) {
+        *boundaries_.template Push<unsigned>() = start;
+        if (end + 1 != 0)
+            *boundaries_.template Push<unsigned>() = end + 1;
+    }
+
+    SizeType FindClass(unsigned codepoint) const {
+        const unsigned* begin = boundaries_.template Bottom<unsigned>();
+        return static_cast<SizeType>(std::upper_bound(begin, boundaries_.template End<unsigned>(), codepoint) - begin);
+    }
+
+    //! Class of a codepoint, in [0, classCount_).
+    SizeType GetClass(unsigned codepoint) const {
+        return codepoint < 128 ? asciiClasses_[codepoint] : FindClass(codepoint);
+    }
+
+    const Ch* GetPrefix() const { return prefix_.template Bottom<Ch>(); }
+    size_t GetPrefixLength() const { return prefix_.GetSize() / sizeof(Ch); }
+
     SizeType NewState(SizeType out, SizeType out1, unsigned codepoint) {
         State* s = states_.template Push<State>();
         s->out = out;
@@ -601,17 +676,120 @@ private:
     // For SearchWithAnchoring()
     bool anchorBegin_;
     bool anchorEnd_;
+
+    // For the DFA and the prefilter of GenericRegexSearch
+    Stack<Allocator> boundaries_;       //!< Sorted codepoints starting a class (unsigned)
+    Stack<Allocator> prefix_;           //!< Encoded literal prefix of all matches (Ch)
+    SizeType classCount_;
+    SizeType asciiClasses_[128];
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// FindRegexLiteral
+
+//! Finds the first occurrence of a literal in a null-terminated string.
+/*! \param s Null-terminated string.
+    \param literal Code units to find, without '\0'.
+    \param length Number of code units of \c literal, at least one.
+    \param ascii Set to whether all code units before the occurrence are ASCII.
+    \return The first occurrence, or 0 if there is none.
+*/
+template <typename Ch>
+inline const Ch* FindRegexLiteral(const Ch* s, const Ch* literal, size_t length, bool* ascii) {
+    RAPIDJSON_ASSERT(length > 0);
+    *ascii = true;
+    for (; *s; ++s) {
+        if (*s == literal[0]) {
+            size_t i = 1;
+            while (i < length && s[i] == literal[i]) // s[i] == '\0' ends the comparison
+                i++;
+            if (i == length)
+                return s;
+        }
+        if (static_cast<unsigned>(*s) >= 0x80)
+            *ascii = false;
+    }
+    return 0;
+}
+
+#if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42) || defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+
+//! Finds the first occurrence of a literal with SSE2 instructions, testing 16 bytes at once for its first byte.
+inline const char* FindRegexLiteral(const char* s, const char* literal, size_t length, bool* ascii) {
+    RAPIDJSON_ASSERT(length > 0);
+    *ascii = true;
+    const __m128i first = _mm_set1_epi8(literal[0]);
+    const __m128i zero = _mm_setzero_si128();
+    // Aligned block containing s (unaligned load may cross page boundary and cause crash)
+    const char* block = reinterpret_cast<const char*>(reinterpret_cast<size_t>(s) & ~static_cast<size_t>(15));
+    uint32_t valid = 0xFFFFu << (s - block);
+    for (;; block += 16, valid = 0xFFFFu) {
+        const __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+        const uint32_t terminator = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero))) & valid;
+        if (terminator)
+            valid &= (terminator & (0u - terminator)) - 1; // before the first '\0'
+        const uint32_t high = static_cast<uint32_t>(_mm_movemask_epi8(x)) & valid;
+        for (uint32_t candidates = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, first))) & valid;
+             candidates != 0; candidates &= candidates - 1)
+        {
+            const unsigned offset = SimdFirstSet(candidates);
+            const char* p = block + offset;
+            size_t i = 1;
+            while (i < length && p[i] == literal[i]) // p[i] == '\0' ends the comparison
+                i++;
+            if (i == length) {
+                if (high & ((1u << offset) - 1))
+                    *ascii = false;
+                return p;
+            }
+        }
+        if (high)
+            *ascii = false;
+        if (terminator)
+            return 0;
+    }
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericRegexSearch
+
+//! Searches a GenericRegex in strings.
+/*!
+    The NFA is turned into a DFA lazily: each set of NFA states reached is cached
+    as a DFA state, with its transitions on the codepoint classes of the regex
+    filled the first time they are taken. So the NFA is only simulated once per
+    new transition, and repeated searches with the same GenericRegexSearch reuse
+    the DFA built by the previous ones.
+
+    The cache is bounded by \c cacheSize bytes. When a new DFA state does not fit,
+    the search continues by simulating the NFA. A \c cacheSize of 0 always
+    simulates the NFA.
+
+    When all matches begin with a literal, Search(const Ch*) looks for its first
+    occurrence (with SSE2 for UTF-8 if enabled) before decoding any character.
+
+    \note A GenericRegexSearch is not thread-safe, since searching updates the cache.
+*/
 template <typename RegexType, typename Allocator = CrtAllocator>
 class GenericRegexSearch {
 public:
     typedef typename RegexType::EncodingType Encoding;
     typedef typename Encoding::Ch Ch;
 
-    GenericRegexSearch(const RegexType& regex, Allocator* allocator = 0) : 
+    static const size_t kDefaultCacheSize = 64 * 1024; //!< Default maximum bytes of the DFA cache
+
+    //! Constructor.
+    /*! \param regex Valid regex to search.
+        \param allocator Allocator for the NFA states and the DFA cache. A CrtAllocator is created if it is null.
+        \param cacheSize Maximum bytes of the DFA cache.
+    */
+    GenericRegexSearch(const RegexType& regex, Allocator* allocator = 0, size_t cacheSize = kDefaultCacheSize) : 
         regex_(regex), allocator_(allocator), ownAllocator_(0),
-        state0_(allocator, 0), state1_(allocator, 0), stateSet_()
+        state0_(allocator, 0), state1_(allocator, 0), stateSet_(),
+        dfaStates_(allocator, 0), dfaSets_(allocator, 0), dfaNext_(allocator, 0), dfaTable_(allocator, 0),
+        cacheSize_(cacheSize)
     {
         RAPIDJSON_ASSERT(regex_.IsValid());
         if (!allocator_)
@@ -619,6 +797,7 @@ public:
         stateSet_ = static_cast<unsigned*>(allocator_->Malloc(GetStateSetSize()));
         state0_.template Reserve<SizeType>(regex_.stateCount_);
         state1_.template Reserve<SizeType>(regex_.stateCount_);
+        dfaStart_[0] = dfaStart_[1] = kRegexInvalidState;
     }
 
     ~GenericRegexSearch() {
@@ -642,48 +821,176 @@ public:
     }
 
     bool Search(const Ch* s) {
+        if (!regex_.anchorBegin_ && regex_.GetPrefixLength() != 0) {
+            bool ascii;
+            const Ch* p = FindRegexLiteral(s, regex_.GetPrefix(), regex_.GetPrefixLength(), &ascii);
+            if (!p)
+                return false;
+            // A match cannot begin before p. Skip there unless an invalid
+            // character before it would have stopped the search.
+            if (ascii)
+                s = p;
+        }
         GenericStringStream<Encoding> is(s);
         return Search(is);
     }
 
+    //! Bytes used by the DFA cache.
+    size_t GetCacheSize() const {
+        return dfaStates_.GetSize() + dfaSets_.GetSize() + dfaNext_.GetSize() + dfaTable_.GetSize();
+    }
+
 private:
     typedef typename RegexType::State State;
     typedef typename RegexType::Range Range;
 
+    //! DFA state: a set of NFA states.
+    struct DfaState {
+        size_t set;         //!< Index of the first NFA state in dfaSets_
+        SizeType count;     //!< Number of NFA states, 0 for the dead state
+        uint32_t hash;
+        bool matched;       //!< Whether the transition into it reached the match state
+        bool anchorBegin;
+    };
+
     template <typename InputStream>
     bool SearchWithAnchoring(InputStream& is, bool anchorBegin, bool anchorEnd) {
         DecodedStream<InputStream, Encoding> ds(is);
 
-        state0_.Clear();
-        Stack<Allocator> *current = &state0_, *next = &state1_;
-        const size_t stateSetSize = GetStateSetSize();
-        std::memset(stateSet_, 0, stateSetSize);
+        SizeType d = dfaStart_[anchorBegin];
+        if (d == kRegexInvalidState) {
+            std::memset(stateSet_, 0, GetStateSetSize());
+            state0_.Clear();
+            const bool matched = AddState(state0_, regex_.root_);
+            d = dfaStart_[anchorBegin] = AddDfaState(state0_, matched, anchorBegin);
+            if (d == kRegexInvalidState)
+                return SearchNFA(ds, matched, anchorBegin, anchorEnd);
+        }
 
-        bool matched = AddState(*current, regex_.root_);
-        unsigned codepoint;
-        while (!current->Empty() && (codepoint = ds.Take()) != 0) {
-            std::memset(stateSet_, 0, stateSetSize);
-            next->Clear();
-            matched = false;
-            for (const SizeType* s = current->template Bottom<SizeType>(); s != current->template End<SizeType>(); ++s) {
-                const State& sr = regex_.GetState(*s);
-                if (sr.codepoint == codepoint ||
-                    sr.codepoint == RegexType::kAnyCharacterClass || 
-                    (sr.codepoint == RegexType::kRangeCharacterClass && MatchRange(sr.rangeStart, codepoint)))
-                {
-                    matched = AddState(*next, sr.out) || matched;
+        for (;;) {
+            const DfaState& state = GetDfaState(d);
+            unsigned codepoint;
+            if (state.count == 0 || (codepoint = ds.Take()) == 0)
+                return state.matched;
+
+            SizeType* next = dfaNext_.template Bottom<SizeType>() + d * regex_.classCount_ + regex_.GetClass(codepoint);
+            if (*next == kRegexInvalidState) {
+                const SizeType* set = dfaSets_.template Bottom<SizeType>() + state.set;
+                const bool matched = Step(set, set + state.count, state0_, codepoint, anchorBegin);
+                const SizeType n = AddDfaState(state0_, matched, anchorBegin);
+                if (n == kRegexInvalidState) { // Cache is full
                     if (!anchorEnd && matched)
                         return true;
+                    return SearchNFA(ds, matched, anchorBegin, anchorEnd);
                 }
-                if (!anchorBegin)
-                    AddState(*next, regex_.root_);
+                next = dfaNext_.template Bottom<SizeType>() + d * regex_.classCount_ + regex_.GetClass(codepoint);
+                *next = n;
             }
+            d = *next;
+            if (!anchorEnd && GetDfaState(d).matched)
+                return true;
+        }
+    }
+
+    //! Simulates the NFA from the states in state0_.
+    template <typename InputStream>
+    bool SearchNFA(DecodedStream<InputStream, Encoding>& ds, bool matched, bool anchorBegin, bool anchorEnd) {
+        Stack<Allocator> *current = &state0_, *next = &state1_;
+        unsigned codepoint;
+        while (!current->Empty() && (codepoint = ds.Take()) != 0) {
+            matched = Step(current->template Bottom<SizeType>(), current->template End<SizeType>(), *next, codepoint, anchorBegin);
+            if (!anchorEnd && matched)
+                return true;
             internal::Swap(current, next);
         }
+        return matched;
+    }
 
+    //! Sets next to the states reached from [begin, end) on a codepoint.
+    /*! \return Whether the match state is reached. */
+    bool Step(const SizeType* begin, const SizeType* end, Stack<Allocator>& next, unsigned codepoint, bool anchorBegin) {
+        std::memset(stateSet_, 0, GetStateSetSize());
+        next.Clear();
+        bool matched = false;
+        for (const SizeType* s = begin; s != end; ++s) {
+            const State& sr = regex_.GetState(*s);
+            if (sr.codepoint == codepoint ||
+                sr.codepoint == RegexType::kAnyCharacterClass || 
+                (sr.codepoint == RegexType::kRangeCharacterClass && MatchRange(sr.rangeStart, codepoint)))
+                matched = AddState(next, sr.out) || matched;
+        }
+        if (!anchorBegin && begin != end)
+            AddState(next, regex_.root_);
         return matched;
     }
 
+    const DfaState& GetDfaState(SizeType index) const {
+        RAPIDJSON_ASSERT(index < dfaStates_.GetSize() / sizeof(DfaState));
+        return dfaStates_.template Bottom<DfaState>()[index];
+    }
+
+    //! Finds or adds the DFA state of a set of NFA states.
+    /*! \param set NFA states, sorted in place.
+        \return Index of the DFA state, or kRegexInvalidState if the cache is full.
+    */
+    SizeType AddDfaState(Stack<Allocator>& set, bool matched, bool anchorBegin) {
+        SizeType* begin = set.template Bottom<SizeType>();
+        SizeType* end = set.template End<SizeType>();
+        std::sort(begin, end);
+        const SizeType count = static_cast<SizeType>(end - begin);
+        uint32_t hash = 2166136261u ^ (matched ? 1u : 0u) ^ (anchorBegin ? 2u : 0u); // FNV-1a
+        for (const SizeType* s = begin; s != end; ++s)
+            hash = (hash ^ *s) * 16777619u;
+
+        const size_t tableSize = dfaTable_.GetSize() / sizeof(SizeType);
+        if (tableSize != 0) {
+            const SizeType* table = dfaTable_.template Bottom<SizeType>();
+            for (size_t i = hash & (tableSize - 1); table[i] != kRegexInvalidState; i = (i + 1) & (tableSize - 1)) {
+                const DfaState& s = GetDfaState(table[i]);
+                if (s.hash == hash && s.count == count && s.matched == matched && s.anchorBegin == anchorBegin &&
+                    std::equal(begin, end, dfaSets_.template Bottom<SizeType>() + s.set))
+                    return table[i];
+            }
+        }
+
+        // Keep the table at most half full
+        const SizeType index = static_cast<SizeType>(dfaStates_.GetSize() / sizeof(DfaState));
+        const size_t newTableSize = (static_cast<size_t>(index) + 1) * 2 > tableSize ? (tableSize ? tableSize * 2 : 16) : tableSize;
+        const size_t size = sizeof(DfaState) + (count + regex_.classCount_ + newTableSize - tableSize) * sizeof(SizeType);
+        if (GetCacheSize() + size > cacheSize_)
+            return kRegexInvalidState;
+
+        DfaState* s = dfaStates_.template Push<DfaState>();
+        s->set = dfaSets_.GetSize() / sizeof(SizeType);
+        s->count = count;
+        s->hash = hash;
+        s->matched = matched;
+        s->anchorBegin = anchorBegin;
+        if (count)
+            std::memcpy(dfaSets_.template Push<SizeType>(count), begin, count * sizeof(SizeType));
+        SizeType* next = dfaNext_.template Push<SizeType>(regex_.classCount_);
+        std::fill(next, next + regex_.classCount_, kRegexInvalidState);
+
+        if (newTableSize != tableSize) {
+            dfaTable_.Clear();
+            SizeType* table = dfaTable_.template Push<SizeType>(newTableSize);
+            std::fill(table, table + newTableSize, kRegexInvalidState);
+            for (SizeType i = 0; i <= index; i++)
+                InsertDfaState(i, newTableSize);
+        }
+        else
+            InsertDfaState(index, tableSize);
+        return index;
+    }
+
+    void InsertDfaState(SizeType index, size_t tableSize) {
+        SizeType* table = dfaTable_.template Bottom<SizeType>();
+        size_t i = GetDfaState(index).hash & (tableSize - 1);
+        while (table[i] != kRegexInvalidState)
+            i = (i + 1) & (tableSize - 1);
+        table[i] = index;
+    }
+
     size_t GetStateSetSize() const {
         return (regex_.stateCount_ + 31) / 32 * 4;
     }
@@ -721,6 +1028,14 @@ private:
     Stack<Allocator> state0_;
     Stack<Allocator> state1_;
     uint32_t* stateSet_;
+
+    // Lazy DFA
+    Stack<Allocator> dfaStates_;    //!< DfaState
+    Stack<Allocator> dfaSets_;      //!< SizeType, NFA states of all DFA states
+    Stack<Allocator> dfaNext_;      //!< SizeType, transitions of each DFA state per codepoint class, kRegexInvalidState if not built
+    Stack<Allocator> dfaTable_;     //!< SizeType, open addressing hash table of DFA states
+    SizeType dfaStart_[2];          //!< Start DFA state without and with anchorBegin
+    size_t cacheSize_;
 };
 
 typedef GenericRegex<UTF8<> > Regex;
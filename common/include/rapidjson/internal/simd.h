@@ -0,0 +1,154 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+// 
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_INTERNAL_SIMD_H_
+#define RAPIDJSON_INTERNAL_SIMD_H_
+
+#include "../rapidjson.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward)
+#endif
+
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+#include <immintrin.h>
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+namespace internal {
+
+// Bit scans over the masks of the SIMD scanners, available for every instruction set.
+
+//! Index of the lowest set bit. \pre mask != 0
+inline unsigned SimdFirstSet(uint32_t mask) {
+    RAPIDJSON_ASSERT(mask != 0);
+#if defined(_MSC_VER)
+    unsigned long offset;
+    _BitScanForward(&offset, mask);
+    return static_cast<unsigned>(offset);
+#elif defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned offset = 0;
+    for (; !(mask & 1); mask >>= 1)
+        offset++;
+    return offset;
+#endif
+}
+
+//! Index of the lowest set bit. \pre mask != 0
+inline unsigned SimdFirstSet(uint64_t mask) {
+    RAPIDJSON_ASSERT(mask != 0);
+#if defined(_MSC_VER) && defined(_M_AMD64)
+    unsigned long offset;
+    _BitScanForward64(&offset, mask);
+    return static_cast<unsigned>(offset);
+#elif defined(_MSC_VER)
+    if (static_cast<uint32_t>(mask) != 0)
+        return SimdFirstSet(static_cast<uint32_t>(mask));
+    return SimdFirstSet(static_cast<uint32_t>(mask >> 32)) + 32;
+#elif defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned offset = 0;
+    for (; !(mask & 1); mask >>= 1)
+        offset++;
+    return offset;
+#endif
+}
+
+//! Number of set bits.
+inline unsigned SimdPopCount(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_AMD64)
+    return static_cast<unsigned>(__popcnt64(mask));
+#elif defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_popcountll(mask));
+#else
+    unsigned count = 0;
+    for (; mask != 0; mask &= mask - 1)
+        count++;
+    return count;
+#endif
+}
+
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+
+// Wide SIMD primitives shared by the reader and the writer.
+// Each mask has bit i set when byte p[i] of the block matches.
+
+#ifdef RAPIDJSON_AVX512
+
+static const size_t kSimdBlockSize = 64;
+typedef uint64_t SimdMask;
+
+//! Mask of JSON whitespace (space, \n, \r, \t) in a 64-byte block.
+inline SimdMask SimdWhitespaceMask(const char* p) {
+    const __m512i s = _mm512_loadu_si512(reinterpret_cast<const void*>(p));
+    return _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8(' '))
+         | _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\n'))
+         | _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\r'))
+         | _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\t'));
+}
+
+//! Mask of characters ending an unescaped string run ('\"', '\\' and control characters) in a 64-byte block.
+inline SimdMask SimdStringSpecialMask(const char* p) {
+    const __m512i s = _mm512_loadu_si512(reinterpret_cast<const void*>(p));
+    return _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\"'))
+         | _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\\'))
+         | _mm512_cmplt_epu8_mask(s, _mm512_set1_epi8(0x20));
+}
+
+#else // RAPIDJSON_AVX2
+
+static const size_t kSimdBlockSize = 32;
+typedef uint32_t SimdMask;
+
+//! Mask of JSON whitespace (space, \n, \r, \t) in a 32-byte block.
+inline SimdMask SimdWhitespaceMask(const char* p) {
+    const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i x = _mm256_cmpeq_epi8(s, _mm256_set1_epi8(' '));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\n')));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\r')));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\t')));
+    return static_cast<SimdMask>(_mm256_movemask_epi8(x));
+}
+
+//! Mask of characters ending an unescaped string run ('\"', '\\' and control characters) in a 32-byte block.
+inline SimdMask SimdStringSpecialMask(const char* p) {
+    const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i sp = _mm256_set1_epi8(0x1F);
+    const __m256i t1 = _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\"'));
+    const __m256i t2 = _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\\'));
+    const __m256i t3 = _mm256_cmpeq_epi8(_mm256_max_epu8(s, sp), sp); // s < 0x20 <=> max(s, 0x1F) == 0x1F
+    return static_cast<SimdMask>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(t1, t2), t3)));
+}
+
+#endif // RAPIDJSON_AVX512
+
+//! Rounds \c p down to its block boundary.
+/*! Loading the aligned block containing \c p never crosses into another page, so the
+    unbounded scanners start there and shift the leading bytes out of the mask
+    instead of testing them one by one.
+*/
+inline const char* SimdAlignDown(const char* p) {
+    return reinterpret_cast<const char*>(reinterpret_cast<size_t>(p) & ~(kSimdBlockSize - 1));
+}
+
+#endif // RAPIDJSON_AVX2 || RAPIDJSON_AVX512
+
+} // namespace internal
+RAPIDJSON_NAMESPACE_END
+
+#endif // RAPIDJSON_INTERNAL_SIMD_H_
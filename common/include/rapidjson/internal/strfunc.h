@@ -45,6 +45,22 @@ inline SizeType StrLen(const wchar_t* s) {
     return SizeType(std::wcslen(s));
 }
 
+//! FNV-1a hash of the bytes of a string.
+/*! \param s String, which does not need to be null-terminated.
+    \param length Number of characters in the string.
+*/
+template <typename Ch>
+inline SizeType StrHash(const Ch* s, SizeType length) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+    const unsigned char* end = p + length * sizeof(Ch);
+    uint32_t h = 2166136261u;
+    for (; p != end; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return static_cast<SizeType>(h);
+}
+
 //! Returns number of code points in a encoded string.
 template<typename Encoding>
 bool CountStringCodePoint(const typename Encoding::Ch* s, SizeType length, SizeType* outCount) {
@@ -0,0 +1,395 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_INTERNAL_STRUCTURAL_H_
+#define RAPIDJSON_INTERNAL_STRUCTURAL_H_
+
+#include "stack.h"
+#include "simd.h"
+#include <cstring>
+
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+#include <immintrin.h>
+#elif defined(RAPIDJSON_SSE42)
+#include <nmmintrin.h>
+#elif defined(RAPIDJSON_SSE2)
+#include <emmintrin.h>
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+namespace internal {
+
+// Stage 1 of the structural index parse (kParseStructuralIndexFlag).
+// The input is classified 64 bytes at a time into bit masks, one bit per byte,
+// with escapes and string contents resolved over the whole block. The parser
+// only needs the index where it would otherwise scan, so the offsets collected are:
+//
+//  - the first non-whitespace character after whitespace outside strings,
+//  - closing quotes, '\\' and control characters inside strings.
+//
+// So from any whitespace outside a string the next index entry is the next
+// token, and from any position inside a string it is the end of the unescaped run.
+// Tokens that directly follow each other are read by the parser as usual.
+
+//! Character classes of a 64-byte block.
+struct StructuralBlock {
+    uint64_t quote;         //!< '\"'
+    uint64_t backslash;     //!< '\\'
+    uint64_t whitespace;    //!< ' ', '\n', '\r', '\t'
+    uint64_t control;       //!< < 0x20
+};
+
+#if defined(RAPIDJSON_AVX512)
+
+inline void ClassifyStructuralBlock(const char* p, StructuralBlock& b) {
+    const __m512i s = _mm512_loadu_si512(reinterpret_cast<const void*>(p));
+    b.quote = _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\"'));
+    b.backslash = _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\\'));
+    b.whitespace = _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8(' '))
+         | _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\n'))
+         | _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\r'))
+         | _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\t'));
+    b.control = _mm512_cmplt_epu8_mask(s, _mm512_set1_epi8(0x20));
+}
+
+#elif defined(RAPIDJSON_AVX2)
+
+inline void ClassifyStructuralBlock(const char* p, StructuralBlock& b) {
+    b.quote = b.backslash = b.whitespace = b.control = 0;
+    for (unsigned i = 0; i < 64; i += 32) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        const __m256i sp = _mm256_set1_epi8(0x1F);
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(s, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\n')));
+        ws = _mm256_or_si256(ws, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\r')));
+        ws = _mm256_or_si256(ws, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\t')));
+        b.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, _mm256_set1_epi8('\"'))))) << i;
+        b.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, _mm256_set1_epi8('\\'))))) << i;
+        b.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << i;
+        b.control |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(s, sp), sp)))) << i; // s < 0x20 <=> max(s, 0x1F) == 0x1F
+    }
+}
+
+#elif defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
+
+inline void ClassifyStructuralBlock(const char* p, StructuralBlock& b) {
+    b.quote = b.backslash = b.whitespace = b.control = 0;
+    for (unsigned i = 0; i < 64; i += 16) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const __m128i sp = _mm_set1_epi8(0x1F);
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(s, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(s, _mm_set1_epi8('\n')));
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(s, _mm_set1_epi8('\r')));
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(s, _mm_set1_epi8('\t')));
+        b.quote |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(s, _mm_set1_epi8('\"')))) << i;
+        b.backslash |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(s, _mm_set1_epi8('\\')))) << i;
+        b.whitespace |= static_cast<uint64_t>(_mm_movemask_epi8(ws)) << i;
+        b.control |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(s, sp), sp))) << i; // s < 0x20 <=> max(s, 0x1F) == 0x1F
+    }
+}
+
+#else
+
+inline void ClassifyStructuralBlock(const char* p, StructuralBlock& b) {
+    b.quote = b.backslash = b.whitespace = b.control = 0;
+    for (unsigned i = 0; i < 64; i++) {
+        const unsigned char c = static_cast<unsigned char>(p[i]);
+        const uint64_t bit = static_cast<uint64_t>(1) << i;
+        switch (c) {
+        case '\"': b.quote |= bit; break;
+        case '\\': b.backslash |= bit; break;
+        case ' ': b.whitespace |= bit; break;
+        case '\n': case '\r': case '\t': b.whitespace |= bit; b.control |= bit; break;
+        default: if (c < 0x20) b.control |= bit; break;
+        }
+    }
+}
+
+#endif
+
+//! Turns the character classes of consecutive blocks into masks of index entries.
+/*! The carries between blocks (pending escape, open string, preceding boundary)
+    are kept in the scanner, so blocks must be fed in order.
+*/
+class StructuralScanner {
+public:
+    StructuralScanner() : prevEscaped_(0), prevInString_(0), prevWhitespace_(0) {}
+
+    uint64_t Next(const StructuralBlock& b) {
+        uint64_t quote;
+        const uint64_t inString = Strings(b, quote);
+
+        const uint64_t whitespace = b.whitespace & ~inString;
+        const uint64_t token = ~b.whitespace & ((whitespace << 1) | prevWhitespace_);
+        prevWhitespace_ = whitespace >> 63;
+
+        return token | (quote & ~inString) | ((b.backslash | b.control) & inString);
+    }
+
+    //! Mask of the characters in strings, from each opening quote up to (excluding) its closing quote.
+    /*! \param b Character classes of the next block.
+        \param quote Receives the mask of unescaped quotes.
+        \note Only one of Next() and Strings() must be called per block.
+    */
+    uint64_t Strings(const StructuralBlock& b, uint64_t& quote) {
+        // Characters escaped by an odd-length run of backslashes.
+        const uint64_t evenBits = RAPIDJSON_UINT64_C2(0x55555555, 0x55555555);
+        const uint64_t backslash = b.backslash & ~prevEscaped_;
+        const uint64_t followsEscape = (backslash << 1) | prevEscaped_;
+        const uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+        const uint64_t evenSequences = oddStarts + backslash;
+        prevEscaped_ = evenSequences < backslash ? 1u : 0u;   // carry out of the block
+        const uint64_t escaped = (evenBits ^ (evenSequences << 1)) & followsEscape;
+
+        quote = b.quote & ~escaped;
+        const uint64_t inString = PrefixXor(quote) ^ prevInString_;
+        prevInString_ = (inString >> 63) ? ~static_cast<uint64_t>(0) : 0;
+        return inString;
+    }
+
+private:
+    static uint64_t PrefixXor(uint64_t x) {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    uint64_t prevEscaped_;
+    uint64_t prevInString_;
+    uint64_t prevWhitespace_;
+};
+
+//! Build the structural index of a JSON text.
+/*! Pushes the offsets (as \c uint32_t) of all index entries of \c json onto
+    \c index, followed by \c length as a sentinel.
+    \param json JSON text, does not need to be null-terminated.
+    \param length Length of \c json in bytes, must be less than 2^32-1.
+    \param index Stack receiving the offsets.
+*/
+template <typename Allocator>
+inline void BuildStructuralIndex(const char* json, size_t length, Stack<Allocator>& index) {
+    RAPIDJSON_ASSERT(length < 0xFFFFFFFFu);
+    StructuralScanner scanner;
+    StructuralBlock b;
+    char tail[64];
+
+    for (size_t offset = 0; offset < length; offset += 64) {
+        const char* p = json + offset;
+        if (length - offset < 64) {
+            // Pad the last block with whitespace rather than reading past the end.
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, p, length - offset);
+            p = tail;
+        }
+        ClassifyStructuralBlock(p, b);
+        uint64_t mask = scanner.Next(b);
+
+        const size_t count = 64;
+        uint32_t* out = index.template Push<uint32_t>(count);
+        uint32_t* q = out;
+        for (; mask != 0; mask &= mask - 1)
+            *q++ = static_cast<uint32_t>(offset + SimdFirstSet(mask));
+        index.template Pop<uint32_t>(count - static_cast<size_t>(q - out));
+    }
+
+    *index.template Push<uint32_t>() = static_cast<uint32_t>(length);
+}
+
+// Splitting of concatenated JSON texts.
+// Between two root values the depth of brackets outside strings is zero, so a
+// position is a boundary when it is outside a string at depth zero and is either
+// whitespace or directly follows a closing bracket. Brackets are matched by
+// ('c' | 0x20): '[' and ']' differ from '{' and '}' only in bit 5.
+
+#if defined(RAPIDJSON_AVX512)
+
+inline void ClassifyBracketBlock(const char* p, uint64_t& open, uint64_t& close) {
+    const __m512i s = _mm512_or_si512(_mm512_loadu_si512(reinterpret_cast<const void*>(p)), _mm512_set1_epi8(0x20));
+    open = _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('{'));
+    close = _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('}'));
+}
+
+#elif defined(RAPIDJSON_AVX2)
+
+inline void ClassifyBracketBlock(const char* p, uint64_t& open, uint64_t& close) {
+    open = close = 0;
+    for (unsigned i = 0; i < 64; i += 32) {
+        const __m256i s = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), _mm256_set1_epi8(0x20));
+        open |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, _mm256_set1_epi8('{'))))) << i;
+        close |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, _mm256_set1_epi8('}'))))) << i;
+    }
+}
+
+#elif defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
+
+inline void ClassifyBracketBlock(const char* p, uint64_t& open, uint64_t& close) {
+    open = close = 0;
+    for (unsigned i = 0; i < 64; i += 16) {
+        const __m128i s = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), _mm_set1_epi8(0x20));
+        open |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(s, _mm_set1_epi8('{')))) << i;
+        close |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(s, _mm_set1_epi8('}')))) << i;
+    }
+}
+
+#else
+
+inline void ClassifyBracketBlock(const char* p, uint64_t& open, uint64_t& close) {
+    open = close = 0;
+    for (unsigned i = 0; i < 64; i++) {
+        const unsigned char c = static_cast<unsigned char>(p[i] | 0x20);
+        open |= static_cast<uint64_t>(c == '{') << i;
+        close |= static_cast<uint64_t>(c == '}') << i;
+    }
+}
+
+#endif
+
+//! Split concatenated JSON texts into chunks of whole root values.
+/*! Pushes (as \c size_t) the first boundary between root values at or after
+    every \c chunkSize bytes from the previous boundary, followed by \c length.
+    The input is not validated: for invalid JSON the boundaries may be anywhere,
+    but parsing the chunks will fail as well.
+    \param json JSON texts, does not need to be null-terminated.
+    \param length Length of \c json in bytes.
+    \param chunkSize Minimum distance between boundaries, must not be 0.
+    \param boundaries Stack receiving the boundaries.
+*/
+template <typename Allocator>
+inline void FindRootBoundaries(const char* json, size_t length, size_t chunkSize, Stack<Allocator>& boundaries) {
+    RAPIDJSON_ASSERT(chunkSize > 0);
+    StructuralScanner scanner;
+    StructuralBlock b;
+    char tail[64];
+    size_t target = chunkSize;
+    int depth = 0;
+
+    for (size_t offset = 0; offset < length && target < length; offset += 64) {
+        const char* p = json + offset;
+        if (length - offset < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, p, length - offset);
+            p = tail;
+        }
+        ClassifyStructuralBlock(p, b);
+        uint64_t open, close, quote;
+        ClassifyBracketBlock(p, open, close);
+        const uint64_t outside = ~scanner.Strings(b, quote);
+        open &= outside;
+        close &= outside;
+
+        if (offset + 64 <= target) {
+            depth += static_cast<int>(SimdPopCount(open)) - static_cast<int>(SimdPopCount(close));
+            continue;
+        }
+
+        // Walk brackets and whitespace in order from the target on.
+        uint64_t mask = open | close | (b.whitespace & outside);
+        for (; mask != 0; mask &= mask - 1) {
+            const unsigned i = SimdFirstSet(mask);
+            const uint64_t bit = static_cast<uint64_t>(1) << i;
+            size_t boundary = 0;
+            if (open & bit)
+                depth++;
+            else if (close & bit) {
+                if (--depth == 0)
+                    boundary = offset + i + 1;
+            }
+            else if (depth == 0)
+                boundary = offset + i;
+
+            if (boundary >= target && boundary < length) {
+                *boundaries.template Push<size_t>() = boundary;
+                target = boundary + chunkSize;
+            }
+        }
+    }
+
+    *boundaries.template Push<size_t>() = length;
+}
+
+//! Skip a value by matching brackets, without validating it.
+/*! The text is read in aligned 64-byte blocks (which never cross a page), so
+    it only has to be null-terminated. Depth changes within a block are summed
+    up unless the block has enough closing brackets to end the value.
+
+    \param p Either the first character of a string, or a position outside
+        strings where \c depth brackets are open.
+    \param depth Number of open brackets at \c p, receives the number of open
+        brackets at the returned position.
+    \param inString Receives whether the returned position is in a string.
+    \return The position after the value, or the position of the first control
+        character other than whitespace (including the terminating null) if
+        the value does not end before it. In the latter case \c depth and
+        \c inString are the state at that position, for the caller to continue
+        with a scalar scan.
+*/
+inline const char* SkipStructuralValue(const char* p, unsigned& depth, bool& inString) {
+    const bool string = depth == 0;
+    RAPIDJSON_ASSERT(!string || *p == '\"');
+    StructuralScanner scanner;
+    StructuralBlock b;
+    const char* block = reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(p) & ~static_cast<uintptr_t>(63));
+    uint64_t valid = ~static_cast<uint64_t>(0) << (p - block);
+    unsigned d = depth;
+
+    for (;; block += 64, valid = ~static_cast<uint64_t>(0)) {
+        ClassifyStructuralBlock(block, b);
+        b.quote &= valid;
+        b.backslash &= valid;
+        uint64_t quote;
+        const uint64_t strings = scanner.Strings(b, quote);
+        const uint64_t stop = b.control & ~b.whitespace & valid;
+        const uint64_t limit = valid & (stop ? (stop & (0 - stop)) - 1 : ~static_cast<uint64_t>(0));
+
+        if (string) {
+            const uint64_t end = quote & ~strings & limit;
+            if (end)
+                return block + SimdFirstSet(end) + 1;
+        }
+        else {
+            uint64_t open, close;
+            ClassifyBracketBlock(block, open, close);
+            open &= ~strings & limit;
+            close &= ~strings & limit;
+            if (SimdPopCount(close) < d)
+                d += SimdPopCount(open) - SimdPopCount(close);
+            else {
+                for (uint64_t mask = open | close; mask != 0; mask &= mask - 1) {
+                    const unsigned i = SimdFirstSet(mask);
+                    if (open & (static_cast<uint64_t>(1) << i))
+                        d++;
+                    else if (--d == 0) {
+                        depth = 0;
+                        inString = false;
+                        return block + i + 1;
+                    }
+                }
+            }
+        }
+
+        if (stop) {
+            const unsigned i = SimdFirstSet(stop);
+            depth = d;
+            inString = ((strings >> i) & 1) != 0;
+            return block + i;
+        }
+    }
+}
+
+} // namespace internal
+RAPIDJSON_NAMESPACE_END
+
+#endif // RAPIDJSON_INTERNAL_STRUCTURAL_H_
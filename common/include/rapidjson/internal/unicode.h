@@ -0,0 +1,446 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_INTERNAL_UNICODE_H_
+#define RAPIDJSON_INTERNAL_UNICODE_H_
+
+#include "../rapidjson.h"
+#include "simd.h"
+
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+#include <immintrin.h>
+#elif defined(RAPIDJSON_SSE42)
+#include <nmmintrin.h>
+#elif defined(RAPIDJSON_SSE2)
+#include <emmintrin.h>
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+namespace internal {
+
+// Bulk UTF-8 validation and UTF-8/UTF-16 transcoding of unescaped string runs,
+// for the reader and the writer. A run ends before '\"', '\\' or a control
+// character. The functions stop early on anything they do not handle, always on
+// a character boundary, and leave it to the per-character code paths, which
+// also report the errors.
+//
+// UTF-8 is validated 16 or 32 bytes at a time with the lookup algorithm of
+// Keiser and Lemire ("Validating UTF-8 in less than one instruction per byte",
+// 2021): three table lookups on nibbles classify each pair of adjacent bytes,
+// and the bytes which must be the 2nd/3rd continuation of a sequence are checked
+// separately. Blocks of ASCII skip the lookups. SSE2 has no byte shuffle, so
+// there only ASCII is vectorized.
+
+//! Length of the valid UTF-8 sequence at \c p, 0 if it is invalid.
+/*! Stops reading at the first byte which is not a continuation, so a null-terminated \c p is never overrun.
+*/
+inline unsigned ValidUTF8Length(const char* p) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    const unsigned c = s[0];
+    if (c < 0x80)
+        return 1;
+    if (c < 0xC2)
+        return 0;
+    if (c < 0xE0)
+        return (s[1] & 0xC0) == 0x80 ? 2 : 0;
+    if (c < 0xF0) {
+        const unsigned lo = c == 0xE0 ? 0xA0u : 0x80u, hi = c == 0xED ? 0x9Fu : 0xBFu;     // Overlong, surrogates
+        return s[1] >= lo && s[1] <= hi && (s[2] & 0xC0) == 0x80 ? 3 : 0;
+    }
+    if (c < 0xF5) {
+        const unsigned lo = c == 0xF0 ? 0x90u : 0x80u, hi = c == 0xF4 ? 0x8Fu : 0xBFu;     // Overlong, above U+10FFFF
+        return s[1] >= lo && s[1] <= hi && (s[2] & 0xC0) == 0x80 && (s[3] & 0xC0) == 0x80 ? 4 : 0;
+    }
+    return 0;
+}
+
+//! Skip valid UTF-8 characters of an unescaped run one at a time.
+inline const char* ScanValidUTF8Scalar(const char* p) {
+    for (;;) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (c < 0x80) {
+            if (c < 0x20 || c == '\"' || c == '\\')
+                return p;
+            ++p;
+        }
+        else if (const unsigned length = ValidUTF8Length(p))
+            p += length;
+        else
+            return p;
+    }
+}
+
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512) || defined(RAPIDJSON_SSE42)
+
+//!@cond RAPIDJSON_HIDDEN_FROM_DOXYGEN
+// Error classes of the lookup tables. The AND of the three lookups is nonzero where a pair of bytes is invalid,
+// except for kUTF8TwoConts, which is expected exactly where the byte must be the 2nd/3rd continuation.
+static const char kUTF8TooShort    = 1 << 0;   // 11______ 0_______, 11______ 11______
+static const char kUTF8TooLong     = 1 << 1;   // 0_______ 10______
+static const char kUTF8Overlong3   = 1 << 2;   // 11100000 100_____
+static const char kUTF8TooLarge    = 1 << 3;   // 11110100 1001____, 11110101+ 10______
+static const char kUTF8Surrogate   = 1 << 4;   // 11101101 101_____
+static const char kUTF8Overlong2   = 1 << 5;   // 1100000_ 10______
+static const char kUTF8TooLarge1000 = 1 << 6;  // 11110101+ 1000____
+static const char kUTF8Overlong4   = 1 << 6;   // 11110000 1000____
+static const char kUTF8TwoConts    = static_cast<char>(1 << 7);    // 10______ 10______
+static const char kUTF8Carry = kUTF8TooShort | kUTF8TooLong | kUTF8TwoConts;
+
+#define RAPIDJSON_UTF8_BYTE1_HIGH \
+    kUTF8TooLong, kUTF8TooLong, kUTF8TooLong, kUTF8TooLong, kUTF8TooLong, kUTF8TooLong, kUTF8TooLong, kUTF8TooLong, \
+    kUTF8TwoConts, kUTF8TwoConts, kUTF8TwoConts, kUTF8TwoConts, \
+    kUTF8TooShort | kUTF8Overlong2, \
+    kUTF8TooShort, \
+    kUTF8TooShort | kUTF8Overlong3 | kUTF8Surrogate, \
+    kUTF8TooShort | kUTF8TooLarge | kUTF8TooLarge1000 | kUTF8Overlong4
+#define RAPIDJSON_UTF8_BYTE1_LOW \
+    kUTF8Carry | kUTF8Overlong3 | kUTF8Overlong2 | kUTF8Overlong4, \
+    kUTF8Carry | kUTF8Overlong2, \
+    kUTF8Carry, kUTF8Carry, \
+    kUTF8Carry | kUTF8TooLarge, \
+    kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, \
+    kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, \
+    kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, \
+    kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000 | kUTF8Surrogate, \
+    kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000, kUTF8Carry | kUTF8TooLarge | kUTF8TooLarge1000
+#define RAPIDJSON_UTF8_BYTE2_HIGH \
+    kUTF8TooShort, kUTF8TooShort, kUTF8TooShort, kUTF8TooShort, kUTF8TooShort, kUTF8TooShort, kUTF8TooShort, kUTF8TooShort, \
+    kUTF8TooLong | kUTF8Overlong2 | kUTF8TwoConts | kUTF8Overlong3 | kUTF8TooLarge1000 | kUTF8Overlong4, \
+    kUTF8TooLong | kUTF8Overlong2 | kUTF8TwoConts | kUTF8Overlong3 | kUTF8TooLarge, \
+    kUTF8TooLong | kUTF8Overlong2 | kUTF8TwoConts | kUTF8Surrogate | kUTF8TooLarge, \
+    kUTF8TooLong | kUTF8Overlong2 | kUTF8TwoConts | kUTF8Surrogate | kUTF8TooLarge, \
+    kUTF8TooShort, kUTF8TooShort, kUTF8TooShort, kUTF8TooShort
+//!@endcond
+
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+
+static const size_t kUnicodeBlockSize = 32;
+typedef __m256i UnicodeBlock;
+
+inline UnicodeBlock UnicodeLoad(const char* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+inline UnicodeBlock UnicodeZero() { return _mm256_setzero_si256(); }
+
+//! Clear the bytes of a block before \c skip.
+inline UnicodeBlock UnicodeClearPrefix(UnicodeBlock s, size_t skip) {
+    static const char kKeep[64] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+    return _mm256_and_si256(s, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kKeep + 32 - skip)));
+}
+
+//! Mask of the non-ASCII bytes.
+inline uint32_t UnicodeHighMask(UnicodeBlock s) { return static_cast<uint32_t>(_mm256_movemask_epi8(s)); }
+
+//! Mask of '\"', '\\' and control characters.
+inline uint32_t UnicodeSpecialMask(UnicodeBlock s) {
+    const __m256i sp = _mm256_set1_epi8(0x1F);
+    const __m256i t1 = _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\"'));
+    const __m256i t2 = _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\\'));
+    const __m256i t3 = _mm256_cmpeq_epi8(_mm256_max_epu8(s, sp), sp); // s < 0x20 <=> max(s, 0x1F) == 0x1F
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(t1, t2), t3)));
+}
+
+//! Mask of the bytes where the UTF-8 sequences of \c s, preceded by \c prev, are invalid.
+inline uint32_t UnicodeUTF8ErrorMask(UnicodeBlock prev, UnicodeBlock s) {
+    const __m256i byte1HighTable = _mm256_setr_epi8(RAPIDJSON_UTF8_BYTE1_HIGH, RAPIDJSON_UTF8_BYTE1_HIGH);
+    const __m256i byte1LowTable = _mm256_setr_epi8(RAPIDJSON_UTF8_BYTE1_LOW, RAPIDJSON_UTF8_BYTE1_LOW);
+    const __m256i byte2HighTable = _mm256_setr_epi8(RAPIDJSON_UTF8_BYTE2_HIGH, RAPIDJSON_UTF8_BYTE2_HIGH);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    const __m256i shifted = _mm256_permute2x128_si256(prev, s, 0x21); // High half of prev, low half of s
+    const __m256i prev1 = _mm256_alignr_epi8(s, shifted, 15);
+    const __m256i prev2 = _mm256_alignr_epi8(s, shifted, 14);
+    const __m256i prev3 = _mm256_alignr_epi8(s, shifted, 13);
+
+    const __m256i special = _mm256_and_si256(_mm256_and_si256(
+        _mm256_shuffle_epi8(byte1HighTable, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+        _mm256_shuffle_epi8(byte1LowTable, _mm256_and_si256(prev1, nibble))),
+        _mm256_shuffle_epi8(byte2HighTable, _mm256_and_si256(_mm256_srli_epi16(s, 4), nibble)));
+
+    // Only 111_____ and 1111____ respectively stay >= 0x80
+    const __m256i must23 = _mm256_or_si256(
+        _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+        _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+    const __m256i error = _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8(static_cast<char>(0x80))), special);
+    return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(error, _mm256_setzero_si256())));
+}
+
+#else // RAPIDJSON_SSE42
+
+static const size_t kUnicodeBlockSize = 16;
+typedef __m128i UnicodeBlock;
+
+inline UnicodeBlock UnicodeLoad(const char* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+inline UnicodeBlock UnicodeZero() { return _mm_setzero_si128(); }
+
+//! Clear the bytes of a block before \c skip.
+inline UnicodeBlock UnicodeClearPrefix(UnicodeBlock s, size_t skip) {
+    static const char kKeep[32] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+    return _mm_and_si128(s, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kKeep + 16 - skip)));
+}
+
+//! Mask of the non-ASCII bytes.
+inline uint32_t UnicodeHighMask(UnicodeBlock s) { return static_cast<uint32_t>(_mm_movemask_epi8(s)); }
+
+//! Mask of '\"', '\\' and control characters.
+inline uint32_t UnicodeSpecialMask(UnicodeBlock s) {
+    const __m128i sp = _mm_set1_epi8(0x1F);
+    const __m128i t1 = _mm_cmpeq_epi8(s, _mm_set1_epi8('\"'));
+    const __m128i t2 = _mm_cmpeq_epi8(s, _mm_set1_epi8('\\'));
+    const __m128i t3 = _mm_cmpeq_epi8(_mm_max_epu8(s, sp), sp); // s < 0x20 <=> max(s, 0x1F) == 0x1F
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(t1, t2), t3)));
+}
+
+//! Mask of the bytes where the UTF-8 sequences of \c s, preceded by \c prev, are invalid.
+inline uint32_t UnicodeUTF8ErrorMask(UnicodeBlock prev, UnicodeBlock s) {
+    const __m128i byte1HighTable = _mm_setr_epi8(RAPIDJSON_UTF8_BYTE1_HIGH);
+    const __m128i byte1LowTable = _mm_setr_epi8(RAPIDJSON_UTF8_BYTE1_LOW);
+    const __m128i byte2HighTable = _mm_setr_epi8(RAPIDJSON_UTF8_BYTE2_HIGH);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+
+    const __m128i prev1 = _mm_alignr_epi8(s, prev, 15);
+    const __m128i prev2 = _mm_alignr_epi8(s, prev, 14);
+    const __m128i prev3 = _mm_alignr_epi8(s, prev, 13);
+
+    const __m128i special = _mm_and_si128(_mm_and_si128(
+        _mm_shuffle_epi8(byte1HighTable, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+        _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(prev1, nibble))),
+        _mm_shuffle_epi8(byte2HighTable, _mm_and_si128(_mm_srli_epi16(s, 4), nibble)));
+
+    // Only 111_____ and 1111____ respectively stay >= 0x80
+    const __m128i must23 = _mm_or_si128(
+        _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+        _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+    const __m128i error = _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8(static_cast<char>(0x80))), special);
+    return ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128()))) & 0xFFFFu;
+}
+
+#endif // RAPIDJSON_AVX2 || RAPIDJSON_AVX512
+
+#undef RAPIDJSON_UTF8_BYTE1_HIGH
+#undef RAPIDJSON_UTF8_BYTE1_LOW
+#undef RAPIDJSON_UTF8_BYTE2_HIGH
+
+//! Skip the valid UTF-8 characters of an unescaped run.
+/*! \param p Null-terminated text, at a character boundary.
+    \return End of the longest prefix of \c p made of valid characters other than '\"', '\\' and control characters.
+*/
+inline const char* ScanValidUTF8(const char* p) {
+    // Start with the aligned block containing p (unaligned load may cross page boundary and cause crash),
+    // with the bytes before p cleared so that they are neither special nor part of a sequence.
+    const char* block = reinterpret_cast<const char*>(reinterpret_cast<size_t>(p) & ~(kUnicodeBlockSize - 1));
+    const size_t skip = static_cast<size_t>(p - block);
+    UnicodeBlock prev = UnicodeZero();
+    UnicodeBlock s = UnicodeClearPrefix(UnicodeLoad(block), skip);
+    uint32_t special = UnicodeSpecialMask(s) & (~0u << skip);
+    uint32_t prevHigh = 0;
+    for (;;) {
+        const uint32_t high = UnicodeHighMask(s);
+        if (RAPIDJSON_UNLIKELY((high | prevHigh) != 0)) {
+            // Up to and including the first special character, which would end a truncated sequence
+            const uint32_t relevant = special ? special ^ (special - 1) : ~0u;
+            if (RAPIDJSON_UNLIKELY(UnicodeUTF8ErrorMask(prev, s) & relevant)) {
+                // Locate the error from the last character boundary before the block, which is
+                // the start of a sequence of the previous block running into this one, if any.
+                const char* q = block > p ? block : p;
+                for (size_t i = 1; i <= 3 && block - i >= p; i++) {
+                    const unsigned char c = static_cast<unsigned char>(*(block - i));
+                    if (c >= 0xC0 && (c >= 0xF0 ? 4u : c >= 0xE0 ? 3u : 2u) > i)
+                        q = block - i;
+                    if (c < 0x80 || c >= 0xC0)
+                        break;
+                }
+                return ScanValidUTF8Scalar(q);
+            }
+        }
+        if (RAPIDJSON_UNLIKELY(special != 0))
+            return block + SimdFirstSet(special);
+        prev = s;
+        prevHigh = high;
+        block += kUnicodeBlockSize;
+        s = UnicodeLoad(block);
+        special = UnicodeSpecialMask(s);
+    }
+}
+
+#elif defined(RAPIDJSON_SSE2)
+
+//! Skip the valid UTF-8 characters of an unescaped run.
+/*! \param p Null-terminated text, at a character boundary.
+    \return End of the longest prefix of \c p made of valid characters other than '\"', '\\' and control characters.
+*/
+inline const char* ScanValidUTF8(const char* p) {
+    const __m128i sp = _mm_set1_epi8(0x1F);
+    const __m128i dq = _mm_set1_epi8('\"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    for (;;) {
+        // Aligned block containing p (unaligned load may cross page boundary and cause crash)
+        const char* block = reinterpret_cast<const char*>(reinterpret_cast<size_t>(p) & ~static_cast<size_t>(15));
+        const __m128i s = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+        const __m128i t1 = _mm_cmpeq_epi8(s, dq);
+        const __m128i t2 = _mm_cmpeq_epi8(s, bs);
+        const __m128i t3 = _mm_cmpeq_epi8(_mm_max_epu8(s, sp), sp); // s < 0x20 <=> max(s, 0x1F) == 0x1F
+        const __m128i x = _mm_or_si128(_mm_or_si128(t1, t2), t3);
+        // Special characters and non-ASCII bytes, the latter being validated one character at a time
+        const uint32_t r = (static_cast<uint32_t>(_mm_movemask_epi8(x) | _mm_movemask_epi8(s)) >> (p - block));
+        if (r == 0) {
+            p = block + 16;
+            continue;
+        }
+        p += SimdFirstSet(r);
+        const unsigned length = static_cast<unsigned char>(*p) >= 0x80 ? ValidUTF8Length(p) : 0;
+        if (length == 0)
+            return p;
+        p += length;
+    }
+}
+
+#else
+
+//! Skip the valid UTF-8 characters of an unescaped run.
+/*! \param p Null-terminated text, at a character boundary.
+    \return End of the longest prefix of \c p made of valid characters other than '\"', '\\' and control characters.
+*/
+inline const char* ScanValidUTF8(const char* p) {
+    return ScanValidUTF8Scalar(p);
+}
+
+#endif
+
+//! Transcode one valid UTF-8 character to UTF-16.
+template <typename Ch>
+inline Ch* TranscodeUTF8ToUTF16(const char*& p, Ch* out) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    const unsigned c = s[0];
+    if (c < 0x80) {
+        *out++ = static_cast<Ch>(c);
+        p += 1;
+    }
+    else if (c < 0xE0) {
+        *out++ = static_cast<Ch>(((c & 0x1Fu) << 6) | (s[1] & 0x3Fu));
+        p += 2;
+    }
+    else if (c < 0xF0) {
+        *out++ = static_cast<Ch>(((c & 0x0Fu) << 12) | ((s[1] & 0x3Fu) << 6) | (s[2] & 0x3Fu));
+        p += 3;
+    }
+    else {
+        const unsigned v = (((c & 0x07u) << 18) | ((s[1] & 0x3Fu) << 12) | ((s[2] & 0x3Fu) << 6) | (s[3] & 0x3Fu)) - 0x10000;
+        *out++ = static_cast<Ch>((v >> 10) | 0xD800);
+        *out++ = static_cast<Ch>((v & 0x3FF) | 0xDC00);
+        p += 4;
+    }
+    return out;
+}
+
+//! Transcode valid UTF-8 to UTF-16.
+/*! \param p Valid UTF-8 text.
+    \param end End of the text.
+    \param out Output of at least <tt>end - p</tt> code units.
+    \return End of the output.
+*/
+template <typename Ch>
+inline Ch* TranscodeUTF8ToUTF16(const char* p, const char* end, Ch* out) {
+#if defined(RAPIDJSON_SIMD) && !defined(RAPIDJSON_NEON)
+    // Widen ASCII 16 bytes at a time
+    if (sizeof(Ch) == 2) {
+        while (end - p >= 16) {
+            const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const uint32_t high = static_cast<uint32_t>(_mm_movemask_epi8(s));
+            if (RAPIDJSON_LIKELY(high == 0)) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(s, _mm_setzero_si128()));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(s, _mm_setzero_si128()));
+                p += 16;
+                out += 16;
+                continue;
+            }
+            for (const char* ascii = p + SimdFirstSet(high); p != ascii; )
+                *out++ = static_cast<Ch>(*p++);
+            // The non-ASCII characters up to the next ASCII byte
+            while (p != end && static_cast<unsigned char>(*p) >= 0x80)
+                out = TranscodeUTF8ToUTF16(p, out);
+        }
+    }
+#endif
+    while (p != end)
+        out = TranscodeUTF8ToUTF16(p, out);
+    return out;
+}
+
+//! Transcode an unescaped run of UTF-16 to UTF-8.
+/*! Stops before '\"', '\\', control characters and surrogates, which are left to the caller.
+    \param p UTF-16 text.
+    \param end End of the text.
+    \param out Output of at least <tt>3 * (end - p)</tt> bytes, advanced to the end of the output.
+    \return End of the transcoded input.
+*/
+template <typename Ch>
+inline const Ch* TranscodeUTF16ToUTF8(const Ch* p, const Ch* end, char*& out) {
+    char* q = out;
+    for (;;) {
+#if defined(RAPIDJSON_SIMD) && !defined(RAPIDJSON_NEON)
+        // Narrow printable ASCII 8 code units at a time
+        if (sizeof(Ch) == 2) {
+            const __m128i sp = _mm_set1_epi16(0x20);
+            const __m128i del = _mm_set1_epi16(0x7F);
+            while (end - p >= 8) {
+                const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                // s < 0x20 or s > 0x7F (unsigned), '\"' or '\\'
+                const __m128i x = _mm_or_si128(
+                    _mm_or_si128(_mm_subs_epu16(sp, s), _mm_subs_epu16(s, del)),
+                    _mm_or_si128(_mm_cmpeq_epi16(s, _mm_set1_epi16('\"')), _mm_cmpeq_epi16(s, _mm_set1_epi16('\\'))));
+                const uint32_t r = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(x, _mm_setzero_si128()))) ^ 0xFFFFu;
+                if (RAPIDJSON_LIKELY(r == 0)) {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(q), _mm_packus_epi16(s, s));
+                    p += 8;
+                    q += 8;
+                    continue;
+                }
+                for (const Ch* ascii = p + SimdFirstSet(r) / 2; p != ascii; )
+                    *q++ = static_cast<char>(*p++);
+                break;
+            }
+        }
+#endif
+        if (p == end)
+            break;
+        const unsigned c = static_cast<unsigned>(*p);
+        if (c < 0x80) {
+            if (c < 0x20 || c == '\"' || c == '\\')
+                break;
+            *q++ = static_cast<char>(c);
+        }
+        else if (c < 0x800) {
+            *q++ = static_cast<char>(0xC0 | (c >> 6));
+            *q++ = static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0xD800 || (c > 0xDFFF && c <= 0xFFFF)) {
+            *q++ = static_cast<char>(0xE0 | (c >> 12));
+            *q++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            *q++ = static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else
+            break;
+        ++p;
+    }
+    out = q;
+    return p;
+}
+
+} // namespace internal
+RAPIDJSON_NAMESPACE_END
+
+#endif // RAPIDJSON_INTERNAL_UNICODE_H_
@@ -119,6 +119,104 @@ private:
 typedef BasicIStreamWrapper<std::istream> IStreamWrapper;
 typedef BasicIStreamWrapper<std::wistream> WIStreamWrapper;
 
+//! Wrapper of \c std::basic_istream reading blocks through its stream buffer.
+/*!
+    Unlike BasicIStreamWrapper, blocks are read with \c sgetn() directly from
+    the \c std::basic_streambuf, and the buffer is exposed through
+    \ref StreamBufferTraits: GenericReader skips whitespace and copies
+    unescaped strings (of \c char streams) in the buffer with SIMD, instead of
+    reading them character by character.
+
+    The stream is read ahead by up to one buffer, and only the \c eofbit of
+    its state is set.
+
+    \tparam StreamType Class derived from \c std::basic_istream.
+    \note implements Stream concept
+*/
+template <typename StreamType>
+class BasicBufferedIStreamWrapper {
+public:
+    typedef typename StreamType::char_type Ch;
+
+    //! Constructor.
+    /*!
+        \param stream stream opened for read.
+        \param buffer user-supplied buffer.
+        \param bufferSize size of buffer in characters. Must >=5 characters.
+    */
+    BasicBufferedIStreamWrapper(StreamType& stream, Ch* buffer, size_t bufferSize) : stream_(stream), buffer_(buffer), bufferSize_(bufferSize), bufferEnd_(buffer_), current_(buffer_), count_(0), eof_(false) {
+        RAPIDJSON_ASSERT(bufferSize >= 5);
+        Read();
+    }
+
+    Ch Peek() const { return *current_; }
+    Ch Take() { Ch c = *current_; if (++current_ >= bufferEnd_) Read(); return c; }
+    size_t Tell() const { return count_ + static_cast<size_t>(current_ - buffer_); }
+
+    // Buffer access, see StreamBufferTraits
+    const Ch* BufferBegin() const { return current_; }
+    const Ch* BufferEnd() const { return bufferEnd_; }
+    void BufferSeek(const Ch* p) {
+        RAPIDJSON_ASSERT(p >= current_ && p <= bufferEnd_);
+        current_ = buffer_ + (p - buffer_);
+        if (current_ == bufferEnd_)
+            Read();
+    }
+
+    // Not implemented
+    void Put(Ch) { RAPIDJSON_ASSERT(false); }
+    void Flush() { RAPIDJSON_ASSERT(false); }
+    Ch* PutBegin() { RAPIDJSON_ASSERT(false); return 0; }
+    size_t PutEnd(Ch*) { RAPIDJSON_ASSERT(false); return 0; }
+
+    // For encoding detection only.
+    const Ch* Peek4() const {
+        return (bufferEnd_ - current_ >= 4) ? current_ : 0;
+    }
+
+private:
+    BasicBufferedIStreamWrapper();
+    BasicBufferedIStreamWrapper(const BasicBufferedIStreamWrapper&);
+    BasicBufferedIStreamWrapper& operator=(const BasicBufferedIStreamWrapper&);
+
+    void Read() {
+        if (eof_) {
+            current_ = bufferEnd_;
+            return;
+        }
+
+        count_ += static_cast<size_t>(bufferEnd_ - buffer_);
+        // The stream buffer only returns fewer characters than requested at the end of the stream.
+        const std::streamsize request = static_cast<std::streamsize>(bufferSize_ - 1);
+        std::streamsize readCount = stream_.rdbuf() ? stream_.rdbuf()->sgetn(buffer_, request) : 0;
+        if (readCount < 0)
+            readCount = 0;
+        if (readCount < request) {
+            eof_ = true;
+            stream_.setstate(std::ios_base::eofbit);
+        }
+        current_ = buffer_;
+        bufferEnd_ = buffer_ + readCount;
+        *bufferEnd_ = '\0';
+    }
+
+    StreamType& stream_;
+    Ch* buffer_;
+    size_t bufferSize_;
+    Ch* bufferEnd_;     //!< End of the read characters, where '\0' is stored.
+    Ch* current_;
+    size_t count_;      //!< Number of characters read before the buffer
+    bool eof_;
+};
+
+template <typename StreamType>
+struct StreamBufferTraits<BasicBufferedIStreamWrapper<StreamType> > {
+    enum { bufferAccess = 1 };
+};
+
+typedef BasicBufferedIStreamWrapper<std::istream> BufferedIStreamWrapper;
+typedef BasicBufferedIStreamWrapper<std::wistream> WBufferedIStreamWrapper;
+
 #if defined(__clang__) || defined(_MSC_VER)
 RAPIDJSON_DIAG_POP
 #endif
@@ -0,0 +1,708 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_LAZYDOCUMENT_H_
+#define RAPIDJSON_LAZYDOCUMENT_H_
+
+/*! \file lazydocument.h */
+
+#include "pointer.h"
+#include <iterator> // std::forward_iterator_tag
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(padded)
+RAPIDJSON_DIAG_OFF(switch-enum)
+#elif defined(_MSC_VER)
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(4127) // conditional expression is constant
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyDocument;
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyMemberIterator;
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyValueIterator;
+
+namespace internal {
+
+//! One value (or member name) of a GenericLazyDocument, in document order.
+struct LazyTapeEntry {
+    SizeType offset;    //!< Position of the first character of the value in the text.
+    SizeType length;    //!< Length of a string, number of elements/members of an array/object.
+    SizeType next;      //!< Index of the entry following the value, i.e. past the contents of an array/object.
+    SizeType string;    //!< 1 + index of the decoded string in the string cache, 0 if not decoded yet.
+};
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyValue
+
+//! Read-only view of a value in a GenericLazyDocument.
+/*! Provides the query API of GenericValue. Type, string length, element and
+    member counts come from the tape; strings and numbers are decoded from the
+    text when they are accessed. Decoded strings are cached in the document.
+
+    A GenericLazyValue is a small handle that is only valid as long as its
+    document is alive and has not been parsed again. A default-constructed
+    handle, or one returned for a member or pointer that does not exist, is
+    not \ref IsValid() "valid" and reports kNullType.
+
+    \note Accessors of a document decode into the document, so unlike
+        GenericValue they must not be used concurrently from several threads.
+    \tparam Encoding Encoding of the text and of decoded strings.
+    \tparam Allocator Allocator of the document for decoded strings.
+    \tparam StackAllocator Allocator of the document for the tape and parsing.
+*/
+template <typename Encoding, typename Allocator = MemoryPoolAllocator<>, typename StackAllocator = CrtAllocator>
+class GenericLazyValue {
+public:
+    typedef typename Encoding::Ch Ch;                                                   //!< Character type derived from Encoding.
+    typedef GenericLazyDocument<Encoding, Allocator, StackAllocator> DocumentType;     //!< Document type of the value.
+    typedef GenericValue<Encoding, Allocator> ValueType;                                //!< DOM value type the value can be materialized to.
+    typedef GenericLazyMemberIterator<Encoding, Allocator, StackAllocator> ConstMemberIterator;  //!< Member iterator for iterating in an object.
+    typedef GenericLazyValueIterator<Encoding, Allocator, StackAllocator> ConstValueIterator;    //!< Value iterator for iterating in an array.
+    typedef ConstMemberIterator MemberIterator;     //!< Same as ConstMemberIterator, the value is read-only.
+    typedef ConstValueIterator ValueIterator;       //!< Same as ConstValueIterator, the value is read-only.
+
+    //! Default constructor creates an invalid value.
+    GenericLazyValue() : doc_(0), index_(0) {}
+
+    //! Whether the value refers to a value of a successfully parsed document.
+    bool IsValid() const { return doc_ != 0 && index_ < doc_->TapeSize(); }
+
+    //!@name Type
+    //@{
+
+    Type GetType() const {
+        if (!IsValid())
+            return kNullType;
+        switch (doc_->Text(index_)[0]) {
+        case 'n': return kNullType;
+        case 'f': return kFalseType;
+        case 't': return kTrueType;
+        case '{': return kObjectType;
+        case '[': return kArrayType;
+        case '"': return kStringType;
+        default:  return kNumberType;
+        }
+    }
+
+    bool IsNull()   const { return GetType() == kNullType; }
+    bool IsFalse()  const { return GetType() == kFalseType; }
+    bool IsTrue()   const { return GetType() == kTrueType; }
+    bool IsBool()   const { Type t = GetType(); return t == kFalseType || t == kTrueType; }
+    bool IsObject() const { return GetType() == kObjectType; }
+    bool IsArray()  const { return GetType() == kArrayType; }
+    bool IsNumber() const { return GetType() == kNumberType; }
+    bool IsString() const { return GetType() == kStringType; }
+
+    // The number subtypes need the number to be decoded.
+    bool IsInt()    const { ValueType v; return DecodeNumber(v) && v.IsInt(); }
+    bool IsUint()   const { ValueType v; return DecodeNumber(v) && v.IsUint(); }
+    bool IsInt64()  const { ValueType v; return DecodeNumber(v) && v.IsInt64(); }
+    bool IsUint64() const { ValueType v; return DecodeNumber(v) && v.IsUint64(); }
+    bool IsDouble() const { ValueType v; return DecodeNumber(v) && v.IsDouble(); }
+    bool IsLosslessDouble() const { ValueType v; return DecodeNumber(v) && v.IsLosslessDouble(); }
+
+    //@}
+
+    //!@name Bool
+    //@{
+
+    bool GetBool() const { RAPIDJSON_ASSERT(IsBool()); return GetType() == kTrueType; }
+
+    //@}
+
+    //!@name Number
+    //@{
+
+    int GetInt() const          { ValueType v; DecodeNumber(v); return v.GetInt(); }
+    unsigned GetUint() const    { ValueType v; DecodeNumber(v); return v.GetUint(); }
+    int64_t GetInt64() const    { ValueType v; DecodeNumber(v); return v.GetInt64(); }
+    uint64_t GetUint64() const  { ValueType v; DecodeNumber(v); return v.GetUint64(); }
+    double GetDouble() const    { ValueType v; DecodeNumber(v); return v.GetDouble(); }
+    float GetFloat() const      { ValueType v; DecodeNumber(v); return v.GetFloat(); }
+
+    //@}
+
+    //!@name String
+    //@{
+
+    //! Get the decoded, null-terminated string. It is valid until the document is parsed again or destroyed.
+    const Ch* GetString() const { RAPIDJSON_ASSERT(IsString()); return doc_->DecodeString(index_); }
+
+    //! Get the length of the decoded string, without decoding it.
+    SizeType GetStringLength() const { RAPIDJSON_ASSERT(IsString()); return doc_->TapeEntry(index_).length; }
+
+    //@}
+
+    //!@name Array
+    //@{
+
+    SizeType Size() const { RAPIDJSON_ASSERT(IsArray()); return doc_->TapeEntry(index_).length; }
+    bool Empty() const { RAPIDJSON_ASSERT(IsArray()); return doc_->TapeEntry(index_).length == 0; }
+
+    //! Get an element by index.
+    /*! \note Elements are not indexed, so this walks the preceding elements
+            (skipping their contents). Use Begin()/End() for iterating.
+    */
+    GenericLazyValue operator[](SizeType index) const {
+        RAPIDJSON_ASSERT(IsArray());
+        RAPIDJSON_ASSERT(index < Size());
+        SizeType i = index_ + 1;
+        while (index-- > 0)
+            i = doc_->TapeEntry(i).next;
+        return GenericLazyValue(doc_, i);
+    }
+
+    ConstValueIterator Begin() const { RAPIDJSON_ASSERT(IsArray()); return ConstValueIterator(GenericLazyValue(doc_, index_ + 1)); }
+    ConstValueIterator End() const { RAPIDJSON_ASSERT(IsArray()); return ConstValueIterator(GenericLazyValue(doc_, doc_->TapeEntry(index_).next)); }
+
+    //@}
+
+    //!@name Object
+    //@{
+
+    SizeType MemberCount() const { RAPIDJSON_ASSERT(IsObject()); return doc_->TapeEntry(index_).length; }
+    bool ObjectEmpty() const { RAPIDJSON_ASSERT(IsObject()); return doc_->TapeEntry(index_).length == 0; }
+
+    ConstMemberIterator MemberBegin() const { RAPIDJSON_ASSERT(IsObject()); return ConstMemberIterator(GenericLazyValue(doc_, index_ + 1)); }
+    ConstMemberIterator MemberEnd() const { RAPIDJSON_ASSERT(IsObject()); return ConstMemberIterator(GenericLazyValue(doc_, doc_->TapeEntry(index_).next)); }
+
+    //! Find member by name.
+    /*! Names without escapes are compared against the text directly, others are decoded.
+        \note Linear time complexity.
+    */
+    ConstMemberIterator FindMember(const Ch* name) const {
+        return FindMember(name, internal::StrLen(name));
+    }
+
+    //! Find member by name and length of name (may contain null characters).
+    ConstMemberIterator FindMember(const Ch* name, SizeType length) const {
+        RAPIDJSON_ASSERT(IsObject());
+        const SizeType end = doc_->TapeEntry(index_).next;
+        SizeType i = index_ + 1;
+        while (i != end && !doc_->NameEquals(i, name, length))
+            i = doc_->TapeEntry(i + 1).next;
+        return ConstMemberIterator(GenericLazyValue(doc_, i));
+    }
+
+    //! Find member by name given as a GenericValue.
+    template <typename SourceAllocator>
+    ConstMemberIterator FindMember(const GenericValue<Encoding, SourceAllocator>& name) const {
+        RAPIDJSON_ASSERT(name.IsString());
+        return FindMember(name.GetString(), name.GetStringLength());
+    }
+
+    bool HasMember(const Ch* name) const { return FindMember(name) != MemberEnd(); }
+
+    //! Get a value from an object by name.
+    /*! \note Like GenericValue, asserts that the member exists; returns an invalid value otherwise.
+    */
+    GenericLazyValue operator[](const Ch* name) const {
+        ConstMemberIterator m = FindMember(name);
+        RAPIDJSON_ASSERT(m != MemberEnd());
+        return m != MemberEnd() ? m->value : GenericLazyValue();
+    }
+
+    //@}
+
+    //!@name JSON Pointer
+    //@{
+
+    //! Resolve a JSON Pointer relative to this value.
+    /*! Same semantics as GenericPointer::Get().
+        \param pointer A valid JSON Pointer.
+        \param unresolvedTokenIndex If not null, receives the index of the first token that could not be resolved.
+        \return The value, or an invalid value if the pointer cannot be resolved.
+    */
+    template <typename T, typename PointerAllocator>
+    GenericLazyValue Get(const GenericPointer<T, PointerAllocator>& pointer, size_t* unresolvedTokenIndex = 0) const {
+        typedef typename GenericPointer<T, PointerAllocator>::Token Token;
+        RAPIDJSON_ASSERT(pointer.IsValid());
+        GenericLazyValue v = *this;
+        const Token* tokens = pointer.GetTokens();
+        for (const Token* t = tokens; t != tokens + pointer.GetTokenCount(); ++t) {
+            switch (v.GetType()) {
+            case kObjectType:
+                {
+                    ConstMemberIterator m = v.FindMember(t->name, t->length);
+                    if (m == v.MemberEnd())
+                        break;
+                    v = m->value;
+                }
+                continue;
+            case kArrayType:
+                if (t->index == kPointerInvalidIndex || t->index >= v.Size())
+                    break;
+                v = v[t->index];
+                continue;
+            default:
+                break;
+            }
+
+            // Error: unresolved token
+            if (unresolvedTokenIndex)
+                *unresolvedTokenIndex = static_cast<size_t>(t - tokens);
+            return GenericLazyValue();
+        }
+        return v;
+    }
+
+    //@}
+
+    //!@name Decoding
+    //@{
+
+    //! Generate events of this value to a Handler, by parsing its text.
+    /*! \return Whether the handler accepted all events.
+    */
+    template <typename Handler>
+    bool Accept(Handler& handler) const {
+        RAPIDJSON_ASSERT(IsValid());
+        return doc_->Decode(index_, handler);
+    }
+
+    //! Decode this value (with all its contents) into a DOM value.
+    /*! \param value Receives the decoded value.
+        \param allocator Allocator for the contents of \c value.
+    */
+    void Materialize(ValueType& value, Allocator& allocator) const {
+        GenericDocument<Encoding, Allocator, StackAllocator> d(&allocator);
+        d.Populate(*this);
+        value.Swap(d);
+    }
+
+    //! Generator for GenericDocument::Populate(), same as Accept().
+    template <typename Handler>
+    bool operator()(Handler& handler) const { return Accept(handler); }
+
+    //@}
+
+private:
+    template <typename, typename, typename> friend class GenericLazyDocument;
+    template <typename, typename, typename> friend class GenericLazyMemberIterator;
+    template <typename, typename, typename> friend class GenericLazyValueIterator;
+
+    GenericLazyValue(const DocumentType* doc, SizeType index) : doc_(doc), index_(index) {}
+
+    bool DecodeNumber(ValueType& v) const {
+        if (!IsNumber())
+            return false;
+        typename DocumentType::NumberHandler handler(v);
+        return doc_->Decode(index_, handler);
+    }
+
+    const DocumentType* doc_;
+    SizeType index_;
+};
+
+//! GenericLazyValue with UTF8 encoding
+typedef GenericLazyValue<UTF8<> > LazyValue;
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyMemberIterator
+
+//! Name-value pair of an object in a GenericLazyDocument.
+template <typename Encoding, typename Allocator, typename StackAllocator>
+struct GenericLazyMember {
+    GenericLazyValue<Encoding, Allocator, StackAllocator> name;     //!< name of member (must be a string)
+    GenericLazyValue<Encoding, Allocator, StackAllocator> value;    //!< value of member.
+};
+
+//! (Constant) forward iterator over the members of a GenericLazyValue object.
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyMemberIterator {
+    typedef GenericLazyValue<Encoding, Allocator, StackAllocator> LazyValueType;
+    friend class GenericLazyValue<Encoding, Allocator, StackAllocator>;
+
+public:
+    typedef GenericLazyMember<Encoding, Allocator, StackAllocator> Member;
+
+    /** \name std::iterator_traits support */
+    //@{
+    typedef const Member    value_type;
+    typedef const Member*   pointer;
+    typedef const Member&   reference;
+    typedef std::ptrdiff_t  difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+    //@}
+
+    //! Default constructor (singular value)
+    GenericLazyMemberIterator() : member_() {}
+
+    GenericLazyMemberIterator& operator++() { Set(member_.name.doc_->TapeEntry(member_.value.index_).next); return *this; }
+    GenericLazyMemberIterator operator++(int) { GenericLazyMemberIterator old(*this); ++*this; return old; }
+
+    bool operator==(const GenericLazyMemberIterator& that) const { return member_.name.index_ == that.member_.name.index_; }
+    bool operator!=(const GenericLazyMemberIterator& that) const { return member_.name.index_ != that.member_.name.index_; }
+
+    reference operator*() const { return member_; }
+    pointer operator->() const { return &member_; }
+
+private:
+    explicit GenericLazyMemberIterator(const LazyValueType& name) : member_() {
+        member_.name = member_.value = name;
+        Set(name.index_);
+    }
+
+    void Set(SizeType nameIndex) {
+        member_.name.index_ = nameIndex;
+        member_.value.index_ = nameIndex + 1;
+    }
+
+    Member member_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyValueIterator
+
+//! (Constant) forward iterator over the elements of a GenericLazyValue array.
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyValueIterator {
+    typedef GenericLazyValue<Encoding, Allocator, StackAllocator> LazyValueType;
+    friend class GenericLazyValue<Encoding, Allocator, StackAllocator>;
+
+public:
+    /** \name std::iterator_traits support */
+    //@{
+    typedef const LazyValueType     value_type;
+    typedef const LazyValueType*    pointer;
+    typedef const LazyValueType&    reference;
+    typedef std::ptrdiff_t          difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+    //@}
+
+    //! Default constructor (singular value)
+    GenericLazyValueIterator() : value_() {}
+
+    GenericLazyValueIterator& operator++() { value_.index_ = value_.doc_->TapeEntry(value_.index_).next; return *this; }
+    GenericLazyValueIterator operator++(int) { GenericLazyValueIterator old(*this); ++*this; return old; }
+
+    bool operator==(const GenericLazyValueIterator& that) const { return value_.index_ == that.value_.index_; }
+    bool operator!=(const GenericLazyValueIterator& that) const { return value_.index_ != that.value_.index_; }
+
+    reference operator*() const { return value_; }
+    pointer operator->() const { return &value_; }
+
+private:
+    explicit GenericLazyValueIterator(const LazyValueType& value) : value_(value) {}
+
+    LazyValueType value_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyDocument
+
+//! A document for on-demand access to JSON text.
+/*! Parsing validates the whole text, exactly like GenericDocument::Parse(),
+    but only records a tape of value offsets instead of building a DOM.
+    Strings and numbers are decoded when they are accessed, and any subtree
+    can be materialized into a GenericValue or fed to a Handler. Reading a
+    few values of a large text is therefore much cheaper than building its DOM.
+
+    The text is not copied: it must stay alive and unchanged as long as the
+    document is used.
+
+    \tparam Encoding Encoding of the text and of decoded strings.
+    \tparam Allocator Allocator for decoded strings.
+    \tparam StackAllocator Allocator for the tape and for parsing.
+*/
+template <typename Encoding, typename Allocator = MemoryPoolAllocator<>, typename StackAllocator = CrtAllocator>
+class GenericLazyDocument : public GenericLazyValue<Encoding, Allocator, StackAllocator> {
+public:
+    typedef typename Encoding::Ch Ch;                                               //!< Character type derived from Encoding.
+    typedef GenericLazyValue<Encoding, Allocator, StackAllocator> LazyValueType;   //!< Value type of the document.
+    typedef GenericValue<Encoding, Allocator> ValueType;                            //!< DOM value type values can be materialized to.
+    typedef Allocator AllocatorType;                                                //!< Allocator type from template parameter.
+
+    //! Constructor
+    /*! \param allocator        Optional allocator for decoded strings.
+        \param stackAllocator   Optional allocator for the tape and parsing.
+    */
+    GenericLazyDocument(Allocator* allocator = 0, StackAllocator* stackAllocator = 0) :
+        json_(0), allocator_(allocator), ownAllocator_(0),
+        tape_(stackAllocator, kDefaultTapeCapacity), stack_(stackAllocator, kDefaultStackCapacity), strings_(stackAllocator, kDefaultStackCapacity),
+        reader_(stackAllocator), parseResult_(), fullPrecision_(false)
+    {
+        this->doc_ = this;
+        if (!allocator_)
+            ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
+    }
+
+    ~GenericLazyDocument() {
+        ClearStrings();
+        RAPIDJSON_DELETE(ownAllocator_);
+    }
+
+    //!@name Parse from text
+    //!@{
+
+    //! Parse JSON text from a read-only string
+    /*! \tparam parseFlags Combination of \ref ParseFlag (must not contain \ref kParseInsituFlag).
+        \param str Read-only zero-terminated string to be parsed. It is referenced, not copied.
+    */
+    template <unsigned parseFlags>
+    GenericLazyDocument& Parse(const Ch* str) {
+        RAPIDJSON_ASSERT(!(parseFlags & kParseInsituFlag));
+        ClearStrings();
+        tape_.Clear();
+        json_ = str;
+        fullPrecision_ = (parseFlags & kParseFullPrecisionFlag) != 0;
+
+        // The tape builder needs the stream to be read directly by the recursive parser, see TapeBuilder.
+        GenericStringStream<Encoding> s(str);
+        TapeBuilder builder(*this, s);
+        parseResult_ = reader_.template Parse<parseFlags & ~static_cast<unsigned>(kParseIterativeFlag | kParseStructuralIndexFlag)>(s, builder);
+        stack_.Clear();
+        if (parseResult_.IsError())
+            tape_.Clear();
+        return *this;
+    }
+
+    //! Parse JSON text from a read-only string (with \ref kParseDefaultFlags)
+    GenericLazyDocument& Parse(const Ch* str) {
+        return Parse<kParseDefaultFlags>(str);
+    }
+
+    //!@}
+
+    //!@name Handling parse errors
+    //!@{
+
+    //! Whether a parse error has occurred in the last parsing.
+    bool HasParseError() const { return parseResult_.IsError(); }
+
+    //! Get the \ref ParseErrorCode of last parsing.
+    ParseErrorCode GetParseError() const { return parseResult_.Code(); }
+
+    //! Get the position of last parsing error in input, 0 otherwise.
+    size_t GetErrorOffset() const { return parseResult_.Offset(); }
+
+    //! Implicit conversion to get the last parse result
+    operator ParseResult() const { return parseResult_; }
+    //!@}
+
+    //! Get the allocator of decoded strings.
+    Allocator& GetAllocator() {
+        RAPIDJSON_ASSERT(allocator_);
+        return *allocator_;
+    }
+
+private:
+    template <typename, typename, typename> friend class GenericLazyValue;
+    template <typename, typename, typename> friend class GenericLazyMemberIterator;
+    template <typename, typename, typename> friend class GenericLazyValueIterator;
+
+    typedef internal::LazyTapeEntry Entry;
+
+    // Prohibit copying, values refer to the document
+    GenericLazyDocument(const GenericLazyDocument&);
+    GenericLazyDocument& operator=(const GenericLazyDocument&);
+
+    // Records the tape, called by the reader during Parse().
+    // The offsets are derived from the position of the stream when the event is
+    // generated: strings and numbers are parsed on a local copy of the stream
+    // (StreamTraits<GenericStringStream>::copyOptimization), so it still points to
+    // their first character; literals and brackets have been consumed already.
+    class TapeBuilder : public BaseReaderHandler<Encoding, TapeBuilder> {
+    public:
+        TapeBuilder(GenericLazyDocument& doc, const GenericStringStream<Encoding>& is) : doc_(doc), is_(is) {}
+
+        bool Null() { Push(4, 0); return true; }
+        bool Bool(bool b) { Push(b ? 4 : 5, 0); return true; }
+        bool Default() { Push(0, 0); return true; }
+        bool String(const Ch*, SizeType length, bool) { Push(0, length); return true; }
+        bool Key(const Ch*, SizeType length, bool) { Push(0, length); return true; }
+        bool StartObject() { return Start(); }
+        bool EndObject(SizeType memberCount) { return End(memberCount); }
+        bool StartArray() { return Start(); }
+        bool EndArray(SizeType elementCount) { return End(elementCount); }
+
+    private:
+        TapeBuilder(const TapeBuilder&);
+        TapeBuilder& operator=(const TapeBuilder&);
+
+        void Push(SizeType consumed, SizeType length) {
+            const SizeType index = doc_.TapeSize();
+            Entry* e = doc_.tape_.template Push<Entry>();
+            e->offset = static_cast<SizeType>(is_.Tell()) - consumed;
+            e->length = length;
+            e->next = index + 1;
+            e->string = 0;
+        }
+
+        bool Start() {
+            *doc_.stack_.template Push<SizeType>() = doc_.TapeSize();
+            Push(1, 0);
+            return true;
+        }
+
+        bool End(SizeType count) {
+            Entry& e = doc_.TapeEntry(*doc_.stack_.template Pop<SizeType>(1));
+            e.length = count;
+            e.next = doc_.TapeSize();
+            return true;
+        }
+
+        GenericLazyDocument& doc_;
+        const GenericStringStream<Encoding>& is_;
+    };
+
+    // Receives a decoded number.
+    class NumberHandler : public BaseReaderHandler<Encoding, NumberHandler> {
+    public:
+        NumberHandler(ValueType& v) : v_(v) {}
+
+        bool Int(int i) { v_.SetInt(i); return true; }
+        bool Uint(unsigned u) { v_.SetUint(u); return true; }
+        bool Int64(int64_t i) { v_.SetInt64(i); return true; }
+        bool Uint64(uint64_t u) { v_.SetUint64(u); return true; }
+        bool Double(double d) { v_.SetDouble(d); return true; }
+
+    private:
+        NumberHandler(const NumberHandler&);
+        NumberHandler& operator=(const NumberHandler&);
+
+        ValueType& v_;
+    };
+
+    // Copies a decoded string into the allocator.
+    class StringHandler : public BaseReaderHandler<Encoding, StringHandler> {
+    public:
+        StringHandler(Allocator& allocator) : str_(0), allocator_(allocator) {}
+
+        bool String(const Ch* str, SizeType length, bool) { str_ = Copy(allocator_, str, length); return true; }
+
+        static const Ch* Copy(Allocator& allocator, const Ch* str, SizeType length) {
+            Ch* s = static_cast<Ch*>(allocator.Malloc((length + 1) * sizeof(Ch)));
+            std::memcpy(s, str, length * sizeof(Ch));
+            s[length] = '\0';
+            return s;
+        }
+
+        const Ch* str_;
+
+    private:
+        StringHandler(const StringHandler&);
+        StringHandler& operator=(const StringHandler&);
+
+        Allocator& allocator_;
+    };
+
+    static const size_t kDefaultStackCapacity = 1024;
+    static const size_t kDefaultTapeCapacity = 64 * sizeof(Entry);
+
+    SizeType TapeSize() const { return static_cast<SizeType>(tape_.GetSize() / sizeof(Entry)); }
+    Entry& TapeEntry(SizeType index) const { return tape_.template Bottom<internal::LazyTapeEntry>()[index]; }
+    const Ch* Text(SizeType index) const { return json_ + TapeEntry(index).offset; }
+
+    // Parse the text of a value again, now generating its events.
+    // The text has been validated with the original flags, so the most permissive flags produce the same events.
+    template <typename Handler>
+    bool Decode(SizeType index, Handler& handler) const {
+        enum { kDecodeFlags = kParseStopWhenDoneFlag | kParseCommentsFlag | kParseTrailingCommasFlag | kParseNanAndInfFlag };
+        GenericStringStream<Encoding> s(Text(index));
+        const ParseResult result = fullPrecision_ ?
+            reader_.template Parse<kDecodeFlags | kParseFullPrecisionFlag>(s, handler) :
+            reader_.template Parse<kDecodeFlags>(s, handler);
+        return !result.IsError();
+    }
+
+    const Ch* DecodeString(SizeType index) const {
+        Entry& e = TapeEntry(index);
+        if (e.string == 0) {
+            const Ch* raw = json_ + e.offset + 1;
+            const Ch* str;
+            if (!HasEscape(raw, e.length))
+                str = StringHandler::Copy(*allocator_, raw, e.length);
+            else {
+                StringHandler handler(*allocator_);
+                Decode(index, handler);
+                str = handler.str_;
+            }
+            *strings_.template Push<const Ch*>() = str;
+            e.string = static_cast<SizeType>(strings_.GetSize() / sizeof(const Ch*));
+        }
+        return strings_.template Bottom<const Ch*>()[e.string - 1];
+    }
+
+    // Compare a member name at index with name, without decoding it if possible.
+    bool NameEquals(SizeType index, const Ch* name, SizeType length) const {
+        const Entry& e = TapeEntry(index);
+        if (e.length != length)
+            return false;
+        // As long as there is no escape the text is the decoded string
+        const Ch* raw = json_ + e.offset + 1;
+        for (SizeType i = 0; i < length; i++) {
+            if (RAPIDJSON_UNLIKELY(raw[i] == '\\'))
+                return std::memcmp(DecodeString(index), name, length * sizeof(Ch)) == 0;
+            if (raw[i] != name[i])
+                return false;
+        }
+        return true;
+    }
+
+    // A string whose first length characters in the text have no escape ends right there.
+    static bool HasEscape(const Ch* raw, SizeType length) {
+        for (SizeType i = 0; i < length; i++)
+            if (raw[i] == '\\')
+                return true;
+        return false;
+    }
+
+    void ClearStrings() {
+        if (Allocator::kNeedFree)
+            for (const Ch** s = strings_.template Bottom<const Ch*>(); s != strings_.template End<const Ch*>(); ++s)
+                Allocator::Free(const_cast<Ch*>(*s));
+        strings_.Clear();
+    }
+
+    const Ch* json_;
+    Allocator* allocator_;
+    Allocator* ownAllocator_;
+    mutable internal::Stack<StackAllocator> tape_;
+    internal::Stack<StackAllocator> stack_;
+    mutable internal::Stack<StackAllocator> strings_;
+    mutable GenericReader<Encoding, Encoding, StackAllocator> reader_;
+    ParseResult parseResult_;
+    bool fullPrecision_;
+};
+
+//! GenericLazyDocument with UTF8 encoding
+typedef GenericLazyDocument<UTF8<> > LazyDocument;
+
+RAPIDJSON_NAMESPACE_END
+
+#if defined(__clang__) || defined(_MSC_VER)
+RAPIDJSON_DIAG_POP
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_LAZYDOCUMENT_H_
@@ -0,0 +1,248 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_MEMORYMAPPEDFILESTREAM_H_
+#define RAPIDJSON_MEMORYMAPPEDFILESTREAM_H_
+
+#include "stream.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define RAPIDJSON_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#define RAPIDJSON_UNDEF_NOMINMAX
+#endif
+#include <windows.h>
+#ifdef RAPIDJSON_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef RAPIDJSON_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#ifdef RAPIDJSON_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef RAPIDJSON_UNDEF_NOMINMAX
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(padded)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+//! File byte stream for input using a memory mapping.
+/*! The whole file is mapped read-only (mmap() with MADV_SEQUENTIAL, or
+    MapViewOfFile() on Windows), so parsing reads the page cache directly
+    without copying through a buffer.
+
+    The mapped text is always followed by a null character, so it can also be
+    parsed as a string with GenericDocument::Parse(GetString()), which uses the
+    faster StringStream code paths.
+
+    With \c copyOnWrite, the mapping is private and writable: the stream then
+    also implements the Put functions for \ref kParseInsituFlag, and
+    GetInsituBuffer() can be passed to GenericDocument::ParseInsitu(). Only the
+    pages modified by parsing are copied, the file itself is never modified.
+
+    \note implements Stream concept
+    \note The file must not be truncated while it is mapped.
+*/
+class MemoryMappedFileStream {
+public:
+    typedef char Ch;    //!< Character type (byte).
+
+    //! Constructor.
+    /*!
+        \param filename Name of the file to map.
+        \param copyOnWrite Map the file privately for in situ parsing.
+        \note Check IsOpen() for success, a file which cannot be mapped is read as an empty stream.
+    */
+    explicit MemoryMappedFileStream(const char* filename, bool copyOnWrite = false) :
+        head_(&empty_), src_(&empty_), dst_(0), length_(0), map_(0), mapSize_(0), buffer_(0), copyOnWrite_(copyOnWrite), open_(false), empty_('\0')
+    {
+        RAPIDJSON_ASSERT(filename != 0);
+        Open(filename);
+    }
+
+    ~MemoryMappedFileStream() {
+        Close();
+    }
+
+    //! Whether the file has been mapped successfully.
+    bool IsOpen() const { return open_; }
+
+    //! Get the mapped text, followed by a null character.
+    const Ch* GetString() const { return head_; }
+
+    //! Get the writable mapped text for GenericDocument::ParseInsitu(). \pre copyOnWrite
+    Ch* GetInsituBuffer() { RAPIDJSON_ASSERT(copyOnWrite_); return head_; }
+
+    //! Get the length of the file in bytes.
+    size_t GetLength() const { return length_; }
+
+    // Read
+    Ch Peek() const { return *src_; }
+    Ch Take() { return *src_++; }
+    size_t Tell() const { return static_cast<size_t>(src_ - head_); }
+
+    // Write (in situ parsing only)
+    void Put(Ch c) { RAPIDJSON_ASSERT(dst_ != 0); *dst_++ = c; }
+    Ch* PutBegin() { RAPIDJSON_ASSERT(copyOnWrite_); return dst_ = src_; }
+    size_t PutEnd(Ch* begin) { return static_cast<size_t>(dst_ - begin); }
+    void Flush() {}
+
+    Ch* Push(size_t count) { Ch* begin = dst_; dst_ += count; return begin; }
+    void Pop(size_t count) { dst_ -= count; }
+
+    // For encoding detection only.
+    const Ch* Peek4() const {
+        return (head_ + length_ - src_ >= 4) ? src_ : 0;
+    }
+
+private:
+    // Prohibit copying, the stream owns the mapping
+    MemoryMappedFileStream(const MemoryMappedFileStream&);
+    MemoryMappedFileStream& operator=(const MemoryMappedFileStream&);
+
+#ifdef _WIN32
+    void Open(const char* filename) {
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && static_cast<ULONGLONG>(size.QuadPart) < static_cast<size_t>(-1)) {
+            length_ = static_cast<size_t>(size.QuadPart);
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            if (length_ == 0)
+                open_ = true;
+            else if (length_ % info.dwPageSize != 0) {
+                // The rest of the last page is zero.
+                HANDLE mapping = CreateFileMappingA(file, 0, copyOnWrite_ ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, 0);
+                if (mapping) {
+                    map_ = MapViewOfFile(mapping, copyOnWrite_ ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+                    CloseHandle(mapping);
+                    if (map_) {
+                        head_ = src_ = static_cast<Ch*>(map_);
+                        open_ = true;
+                    }
+                }
+            }
+            else {
+                // No room for the terminator: read into a buffer instead.
+                buffer_ = static_cast<Ch*>(std::malloc(length_ + 1));
+                size_t count = 0;
+                DWORD read = 0;
+                while (buffer_ && count < length_ && ReadFile(file, buffer_ + count, static_cast<DWORD>((length_ - count) < 0x40000000u ? (length_ - count) : 0x40000000u), &read, 0) && read > 0)
+                    count += read;
+                if (buffer_ && count == length_) {
+                    buffer_[length_] = '\0';
+                    head_ = src_ = buffer_;
+                    open_ = true;
+                }
+            }
+        }
+        CloseHandle(file);
+        if (!open_)
+            length_ = 0;
+    }
+
+    void Close() {
+        if (map_)
+            UnmapViewOfFile(map_);
+        std::free(buffer_);
+    }
+#else
+    void Open(const char* filename) {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= 0 && static_cast<uint64_t>(st.st_size) < static_cast<size_t>(-1)) {
+            length_ = static_cast<size_t>(st.st_size);
+            const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            const int prot = copyOnWrite_ ? PROT_READ | PROT_WRITE : PROT_READ;
+            void* p = MAP_FAILED;
+            if (length_ == 0)
+                open_ = true;
+            else if (length_ % pageSize != 0) {
+                // The rest of the last page is zero.
+                mapSize_ = length_;
+                p = mmap(0, mapSize_, prot, MAP_PRIVATE, fd, 0);
+            }
+            else {
+                // No room for the terminator: reserve one more zero page and map the file in front of it.
+                mapSize_ = length_ + pageSize;
+#ifdef MAP_ANONYMOUS
+                void* reserved = mmap(0, mapSize_, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#else
+                void* reserved = mmap(0, mapSize_, prot, MAP_PRIVATE | MAP_ANON, -1, 0);
+#endif
+                if (reserved != MAP_FAILED) {
+                    p = mmap(reserved, length_, prot, MAP_PRIVATE | MAP_FIXED, fd, 0);
+                    if (p == MAP_FAILED)
+                        munmap(reserved, mapSize_);
+                }
+            }
+            if (p != MAP_FAILED) {
+                map_ = p;
+#ifdef MADV_SEQUENTIAL
+                madvise(map_, length_, MADV_SEQUENTIAL);
+#endif
+                head_ = src_ = static_cast<Ch*>(map_);
+                open_ = true;
+            }
+        }
+        close(fd);
+        if (!open_)
+            length_ = 0;
+    }
+
+    void Close() {
+        if (map_)
+            munmap(map_, mapSize_);
+        std::free(buffer_);
+    }
+#endif
+
+    Ch* head_;          //!< Start of the text.
+    Ch* src_;           //!< Current read position.
+    Ch* dst_;           //!< Current write position (in situ parsing).
+    size_t length_;     //!< Length of the text.
+    void* map_;         //!< Mapped view, 0 if not mapped.
+    size_t mapSize_;    //!< Size of the mapping (POSIX).
+    Ch* buffer_;        //!< Copy of the file when it cannot be mapped with a terminator (Windows).
+    bool copyOnWrite_;
+    bool open_;
+    Ch empty_;          //!< Text of an empty or failed stream.
+};
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __clang__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_MEMORYMAPPEDFILESTREAM_H_
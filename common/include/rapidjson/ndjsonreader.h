@@ -0,0 +1,329 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_NDJSONREADER_H_
+#define RAPIDJSON_NDJSONREADER_H_
+
+/*! \file ndjsonreader.h
+    \brief Parallel reader for newline-delimited (JSON Lines) and concatenated JSON texts.
+    \note Requires C++11 (std::thread).
+*/
+
+#include "document.h"
+#include "internal/structural.h"
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+namespace internal {
+
+//! Split newline-delimited JSON texts into chunks of whole lines.
+/*! Pushes (as \c size_t) the position after the first '\\n' at or after every
+    \c chunkSize bytes from the previous boundary, followed by \c length.
+    JSON strings cannot contain a raw newline, so any newline ends a record.
+*/
+template <typename Allocator>
+inline void FindLineBoundaries(const char* json, size_t length, size_t chunkSize, Stack<Allocator>& boundaries) {
+    RAPIDJSON_ASSERT(chunkSize > 0);
+    for (size_t target = chunkSize; target < length; ) {
+        const char* p = static_cast<const char*>(std::memchr(json + target, '\n', length - target));
+        if (!p)
+            break;
+        const size_t boundary = static_cast<size_t>(p - json) + 1;
+        if (boundary < length)
+            *boundaries.template Push<size_t>() = boundary;
+        target = boundary + chunkSize;
+    }
+    *boundaries.template Push<size_t>() = length;
+}
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericNdjsonReader
+
+//! Parallel reader of a sequence of JSON texts.
+/*! Parses a buffer holding many root values, either one per line (JSON Lines/NDJSON)
+    or simply concatenated (optionally separated by whitespace), on several threads.
+
+    The buffer is split into chunks of about \c chunkSize bytes at record boundaries:
+    for line-delimited input at newlines, for concatenated input by a SIMD scan
+    of strings and brackets (see internal::FindRootBoundaries()). Worker threads
+    parse the chunks into values allocated from one allocator per chunk, while
+    the calling thread hands the values to the callback or handler in input order.
+    At most two chunks per thread are buffered ahead of the calling thread.
+
+    \note Line-delimited input must have one record per line, a record spanning a
+        chunk boundary is a parse error. Comments are not supported between records.
+    \tparam Encoding Encoding of the input and of the values (with 1-byte characters).
+    \tparam Allocator Allocator of the values, one instance per chunk.
+    \tparam StackAllocator Allocator of the parsing stacks.
+*/
+template <typename Encoding = UTF8<>, typename Allocator = MemoryPoolAllocator<>, typename StackAllocator = CrtAllocator>
+class GenericNdjsonReader {
+public:
+    typedef typename Encoding::Ch Ch;                                           //!< Character type derived from Encoding.
+    typedef GenericValue<Encoding, Allocator> ValueType;                        //!< Type of the parsed root values.
+    typedef GenericDocument<Encoding, Allocator, StackAllocator> DocumentType;  //!< Document type for parsing a root value.
+
+    static const size_t kDefaultChunkSize = 1024 * 1024;
+
+    //! Constructor.
+    /*! \param threadCount Number of worker threads, 0 for std::thread::hardware_concurrency().
+        \param chunkSize Minimum size of the chunks the input is split into.
+        \param lineDelimited Whether the input is line-delimited (true) or concatenated (false) JSON.
+    */
+    GenericNdjsonReader(unsigned threadCount = 0, size_t chunkSize = kDefaultChunkSize, bool lineDelimited = true) :
+        threadCount_(threadCount ? threadCount : std::thread::hardware_concurrency()), chunkSize_(chunkSize), lineDelimited_(lineDelimited)
+    {
+        RAPIDJSON_STATIC_ASSERT(sizeof(Ch) == 1);
+        RAPIDJSON_ASSERT(chunkSize > 0);
+        if (threadCount_ == 0)
+            threadCount_ = 1;
+    }
+
+    //! Parse all root values and pass them to a callback in input order.
+    /*! \tparam parseFlags Combination of \ref ParseFlag (must not contain \ref kParseInsituFlag).
+        \tparam Callback Functor with <tt>bool f(ValueType& value)</tt> prototype, called on the calling thread.
+            The value and its contents are freed after the call; use CopyFrom() or
+            Swap() into a value of another allocator to keep it. Returning false stops parsing.
+        \param json Input, must be followed by a null character (not counted in \c length).
+        \param length Length of the input.
+        \param callback Callback receiving the root values.
+        \return The first parse error, with its offset in \c json, or kParseErrorTermination.
+    */
+    template <unsigned parseFlags, typename Callback>
+    ParseResult ParseValues(const Ch* json, size_t length, Callback& callback) {
+        RAPIDJSON_ASSERT(!(parseFlags & kParseInsituFlag));
+        RAPIDJSON_ASSERT(json[length] == '\0');
+
+        internal::Stack<StackAllocator> boundaries(0, 64 * sizeof(size_t));
+        *boundaries.template Push<size_t>() = 0;
+        if (lineDelimited_)
+            internal::FindLineBoundaries(json, length, chunkSize_, boundaries);
+        else
+            internal::FindRootBoundaries(json, length, chunkSize_, boundaries);
+
+        Context context(json, boundaries.template Bottom<size_t>(), boundaries.GetSize() / sizeof(size_t) - 1, threadCount_);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount_ && i < context.chunkCount; i++)
+            threads.push_back(std::thread(&GenericNdjsonReader::template Work<parseFlags>, &context));
+
+        ParseResult result;
+        for (size_t i = 0; i < context.chunkCount && !result.IsError(); i++) {
+            Chunk& chunk = context.chunks[i % context.window];
+            {
+                std::unique_lock<std::mutex> lock(context.mutex);
+                context.ready.wait(lock, [&chunk] { return chunk.done; });
+            }
+
+            for (Record* r = chunk.records.template Bottom<Record>(); r != chunk.records.template End<Record>(); ++r)
+                if (RAPIDJSON_UNLIKELY(!callback(r->value))) {
+                    result.Set(kParseErrorTermination, r->offset);
+                    break;
+                }
+            if (!result.IsError())
+                result = chunk.result;
+            chunk.Clear();
+
+            std::lock_guard<std::mutex> lock(context.mutex);
+            context.consumed++;
+            context.stop = result.IsError();
+            context.ready.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(context.mutex);
+            context.stop = true;
+            context.ready.notify_all();
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+        return result;
+    }
+
+    //! Parse all root values and generate their SAX events in input order.
+    /*! The events of each root value are generated on the calling thread, as if
+        the values were parsed one after the other with \ref kParseStopWhenDoneFlag.
+        \tparam parseFlags Combination of \ref ParseFlag (must not contain \ref kParseInsituFlag).
+        \tparam Handler Type of handler, implementing Handler concept.
+        \param json Input, must be followed by a null character (not counted in \c length).
+        \param length Length of the input.
+        \param handler The handler to receive events.
+        \return The first parse error, with its offset in \c json.
+    */
+    template <unsigned parseFlags, typename Handler>
+    ParseResult Parse(const Ch* json, size_t length, Handler& handler) {
+        HandlerCallback<Handler> callback(handler);
+        return ParseValues<parseFlags>(json, length, callback);
+    }
+
+    //! Parse all root values of a null-terminated string and generate their SAX events in input order.
+    template <unsigned parseFlags, typename Handler>
+    ParseResult Parse(const Ch* json, Handler& handler) {
+        return Parse<parseFlags>(json, internal::StrLen(json), handler);
+    }
+
+    //! Parse all root values of a null-terminated string (with \ref kParseDefaultFlags).
+    template <typename Handler>
+    ParseResult Parse(const Ch* json, Handler& handler) {
+        return Parse<kParseDefaultFlags>(json, handler);
+    }
+
+private:
+    GenericNdjsonReader(const GenericNdjsonReader&);
+    GenericNdjsonReader& operator=(const GenericNdjsonReader&);
+
+    //! A parsed root value and its position in the input.
+    struct Record {
+        ValueType value;
+        size_t offset;
+    };
+
+    //! Results of parsing a chunk.
+    struct Chunk {
+        Chunk() : allocator(0), records(0, 256 * sizeof(Record)), result(), done(false) {}
+        ~Chunk() { Clear(); }
+
+        void Clear() {
+            for (Record* r = records.template Bottom<Record>(); r != records.template End<Record>(); ++r)
+                r->~Record();
+            records.Clear();
+            RAPIDJSON_DELETE(allocator);
+            allocator = 0;
+            result.Clear();
+            done = false;
+        }
+
+        Allocator* allocator;
+        internal::Stack<StackAllocator> records;
+        ParseResult result;
+        bool done;
+    };
+
+    //! State shared by the calling thread and the workers during ParseValues().
+    struct Context {
+        Context(const Ch* j, const size_t* b, size_t count, unsigned threadCount) :
+            json(j), boundaries(b), chunkCount(count), window(2 * static_cast<size_t>(threadCount)), chunks(window),
+            next(0), consumed(0), stop(false) {}
+
+        const Ch* json;
+        const size_t* boundaries;
+        const size_t chunkCount;
+        const size_t window;        //!< Number of chunks parsed ahead, chunk i uses chunks[i % window].
+        std::vector<Chunk> chunks;
+        std::mutex mutex;
+        std::condition_variable ready;
+        size_t next;                //!< Next chunk to parse.
+        size_t consumed;            //!< Number of chunks delivered.
+        bool stop;
+    };
+
+    //! Generator for GenericDocument::Populate() parsing one root value.
+    template <unsigned parseFlags>
+    struct RootParser {
+        RootParser(GenericReader<Encoding, Encoding, StackAllocator>& r, GenericStringStream<Encoding>& s) : reader(r), is(s), result() {}
+
+        template <typename Handler>
+        bool operator()(Handler& handler) {
+            result = reader.template Parse<parseFlags>(is, handler);
+            return !result.IsError();
+        }
+
+        GenericReader<Encoding, Encoding, StackAllocator>& reader;
+        GenericStringStream<Encoding>& is;
+        ParseResult result;
+    };
+
+    //! Callback generating the SAX events of each value.
+    template <typename Handler>
+    struct HandlerCallback {
+        HandlerCallback(Handler& h) : handler(h) {}
+        bool operator()(const ValueType& value) { return value.Accept(handler); }
+        Handler& handler;
+    };
+
+    template <unsigned parseFlags>
+    static void Work(Context* context) {
+        GenericReader<Encoding, Encoding, StackAllocator> reader;
+        for (;;) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(context->mutex);
+                context->ready.wait(lock, [context] {
+                    return context->stop || context->next >= context->chunkCount || context->next < context->consumed + context->window;
+                });
+                if (context->stop || context->next >= context->chunkCount)
+                    return;
+                i = context->next++;
+            }
+
+            Chunk& chunk = context->chunks[i % context->window];
+            ParseChunk<parseFlags>(reader, context->json, context->boundaries[i], context->boundaries[i + 1], chunk);
+
+            std::lock_guard<std::mutex> lock(context->mutex);
+            chunk.done = true;
+            context->ready.notify_all();
+        }
+    }
+
+    // Each root value is parsed on its own, structural index parsing would index the rest of the input every time.
+    template <unsigned parseFlags>
+    static void ParseChunk(GenericReader<Encoding, Encoding, StackAllocator>& reader, const Ch* json, size_t begin, size_t end, Chunk& chunk) {
+        chunk.allocator = RAPIDJSON_NEW(Allocator)();
+        GenericStringStream<Encoding> is(json + begin);
+        RootParser<(parseFlags | kParseStopWhenDoneFlag) & ~static_cast<unsigned>(kParseStructuralIndexFlag)> parser(reader, is);
+        DocumentType d(chunk.allocator);
+        for (;;) {
+            SkipWhitespace(is);
+            const size_t offset = begin + is.Tell();
+            if (offset >= end)
+                break;
+
+            d.Populate(parser);
+            if (parser.result.IsError()) {
+                chunk.result.Set(parser.result.Code(), begin + parser.result.Offset());
+                break;
+            }
+            Record* r = chunk.records.template Push<Record>();
+            new (&r->value) ValueType();
+            r->value.Swap(d);
+            r->offset = offset;
+        }
+    }
+
+    unsigned threadCount_;
+    size_t chunkSize_;
+    bool lineDelimited_;
+};
+
+//! GenericNdjsonReader with UTF8 encoding.
+typedef GenericNdjsonReader<UTF8<> > NdjsonReader;
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_NDJSONREADER_H_
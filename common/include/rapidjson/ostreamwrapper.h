@@ -17,6 +17,8 @@
 
 #include "stream.h"
 #include <iosfwd>
+#include <ios>
+#include <algorithm>
 
 #ifdef __clang__
 RAPIDJSON_DIAG_PUSH
@@ -72,6 +74,90 @@ private:
 typedef BasicOStreamWrapper<std::ostream> OStreamWrapper;
 typedef BasicOStreamWrapper<std::wostream> WOStreamWrapper;
 
+//! Wrapper of \c std::basic_ostream writing blocks through its stream buffer.
+/*!
+    Unlike BasicOStreamWrapper, characters are collected in a buffer and
+    written with \c sputn() directly to the \c std::basic_streambuf. A failed
+    write sets the \c badbit of the stream state.
+
+    \tparam StreamType Class derived from \c std::basic_ostream.
+    \note implements Stream concept
+*/
+template <typename StreamType>
+class BasicBufferedOStreamWrapper {
+public:
+    typedef typename StreamType::char_type Ch;
+
+    //! Constructor.
+    /*!
+        \param stream stream opened for write.
+        \param buffer user-supplied buffer.
+        \param bufferSize size of buffer in characters.
+    */
+    BasicBufferedOStreamWrapper(StreamType& stream, Ch* buffer, size_t bufferSize) : stream_(stream), buffer_(buffer), bufferEnd_(buffer + bufferSize), current_(buffer_) {
+        RAPIDJSON_ASSERT(bufferSize > 0);
+    }
+
+    void Put(Ch c) {
+        if (current_ >= bufferEnd_)
+            Write();
+
+        *current_++ = c;
+    }
+
+    void PutN(Ch c, size_t n) {
+        size_t avail = static_cast<size_t>(bufferEnd_ - current_);
+        while (n > avail) {
+            std::fill(current_, current_ + avail, c);
+            current_ += avail;
+            Write();
+            n -= avail;
+            avail = static_cast<size_t>(bufferEnd_ - current_);
+        }
+
+        std::fill(current_, current_ + n, c);
+        current_ += n;
+    }
+
+    void Flush() {
+        Write();
+        stream_.flush();
+    }
+
+    // Not implemented
+    char Peek() const { RAPIDJSON_ASSERT(false); return 0; }
+    char Take() { RAPIDJSON_ASSERT(false); return 0; }
+    size_t Tell() const { RAPIDJSON_ASSERT(false); return 0; }
+    char* PutBegin() { RAPIDJSON_ASSERT(false); return 0; }
+    size_t PutEnd(char*) { RAPIDJSON_ASSERT(false); return 0; }
+
+private:
+    BasicBufferedOStreamWrapper(const BasicBufferedOStreamWrapper&);
+    BasicBufferedOStreamWrapper& operator=(const BasicBufferedOStreamWrapper&);
+
+    void Write() {
+        if (current_ != buffer_) {
+            const std::streamsize count = static_cast<std::streamsize>(current_ - buffer_);
+            if (!stream_.rdbuf() || stream_.rdbuf()->sputn(buffer_, count) != count)
+                stream_.setstate(std::ios_base::badbit);
+            current_ = buffer_;
+        }
+    }
+
+    StreamType& stream_;
+    Ch* buffer_;
+    Ch* bufferEnd_;
+    Ch* current_;
+};
+
+template<typename StreamType>
+inline void PutN(BasicBufferedOStreamWrapper<StreamType>& stream, typename StreamType::char_type c, size_t n) {
+    stream.PutN(c, n);
+}
+
+typedef BasicBufferedOStreamWrapper<std::ostream> BufferedOStreamWrapper;
+typedef BasicBufferedOStreamWrapper<std::wostream> WBufferedOStreamWrapper;
+
 #ifdef __clang__
 RAPIDJSON_DIAG_POP
 #endif
@@ -0,0 +1,414 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_PARALLELWRITER_H_
+#define RAPIDJSON_PARALLELWRITER_H_
+
+/*! \file parallelwriter.h
+    \brief Parallel writer serializing a value into scatter-gather segments.
+    \note Requires C++11 (std::thread).
+*/
+
+#include "document.h"
+#include "stringbuffer.h"
+#include "writer.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(padded)
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+#ifdef _WIN32
+//! Segment of the output of GenericParallelWriter, with the members of a POSIX struct iovec.
+struct ParallelWriterSegment {
+    void* iov_base; //!< Start of the segment.
+    size_t iov_len; //!< Size of the segment in bytes.
+};
+#else
+//! Segment of the output of GenericParallelWriter, usable with writev().
+typedef struct iovec ParallelWriterSegment;
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericParallelWriter
+
+//! Writer serializing a value on several threads into a list of segments.
+/*! Produces the same compact JSON as Writer, without concatenating it.
+
+    Large arrays and objects are split into ranges of consecutive elements or
+    members, about \c tasksPerThread per thread in total. The split is decided
+    from the numbers of children only, without walking the whole tree: a
+    container with at least as many children as its share of ranges is cut into
+    ranges of equal counts, otherwise each child gets a share in proportion to
+    its own number of children and is split in turn. Worker threads (and the
+    calling thread) take the ranges in order and serialize them with a Writer
+    into one buffer per thread. Brackets, names and scalars between the ranges
+    are written by the calling thread into another buffer.
+
+    The output is the list of pieces of these buffers in order, as segments
+    with the members of struct iovec, so that it can be written with writev()
+    (see WriteTo()) instead of being copied into a single buffer. The buffers
+    are reused by the next Write().
+
+    \code
+    ParallelWriter writer;
+    if (writer.Write(d))
+        writer.WriteTo(fd);
+    \endcode
+
+    \tparam SourceEncoding Encoding of the values.
+    \tparam TargetEncoding Encoding of the output.
+    \tparam StackAllocator Allocator of the buffers and of the writers' stacks, which must be thread-safe.
+    \tparam writeFlags Combination of \ref WriteFlag, as for Writer.
+    \note Balancing relies on the children of a split container having similar
+        sizes, as the records of a large export usually do.
+*/
+template<typename SourceEncoding = UTF8<>, typename TargetEncoding = UTF8<>, typename StackAllocator = CrtAllocator, unsigned writeFlags = kWriteDefaultFlags>
+class GenericParallelWriter {
+public:
+    typedef typename SourceEncoding::Ch Ch;                                                         //!< Character type of the values.
+    typedef GenericStringBuffer<TargetEncoding, StackAllocator> BufferType;                         //!< Buffer of the segments.
+    typedef Writer<BufferType, SourceEncoding, TargetEncoding, StackAllocator, writeFlags> WriterType;  //!< Writer serializing each piece.
+    typedef ParallelWriterSegment Segment;                                                          //!< Segment of the output.
+
+    static const unsigned kDefaultTasksPerThread = 8;
+
+    //! Constructor.
+    /*! \param threadCount Number of threads including the calling one, 0 for std::thread::hardware_concurrency().
+        \param tasksPerThread Number of ranges per thread the largest containers are split into.
+    */
+    GenericParallelWriter(unsigned threadCount = 0, unsigned tasksPerThread = kDefaultTasksPerThread) :
+        threadCount_(threadCount ? threadCount : std::thread::hardware_concurrency()), tasksPerThread_(tasksPerThread),
+        maxDecimalPlaces_(WriterType::kDefaultMaxDecimalPlaces), buffers_(), tasks_(), pieces_(), segments_(), size_()
+    {
+        RAPIDJSON_ASSERT(tasksPerThread > 0);
+        if (threadCount_ == 0)
+            threadCount_ = 1;
+        buffers_.resize(threadCount_ + 1); // The last one holds the pieces written by the calling thread.
+    }
+
+    //! Set the maximum number of decimal places for double output, see Writer::SetMaxDecimalPlaces().
+    void SetMaxDecimalPlaces(int maxDecimalPlaces) {
+        maxDecimalPlaces_ = maxDecimalPlaces;
+    }
+
+    //! Serialize a value.
+    /*! The value must not be modified until Write() returns.
+        \return Whether the writers succeeded, see Writer (e.g. NaN without \ref kWriteNanAndInfFlag).
+            GetSegments() is empty on failure.
+    */
+    template <typename Allocator>
+    bool Write(const GenericValue<SourceEncoding, Allocator>& value) {
+        typedef GenericValue<SourceEncoding, Allocator> ValueType;
+
+        for (size_t i = 0; i < buffers_.size(); i++)
+            buffers_[i].Clear();
+        tasks_.clear();
+        pieces_.clear();
+        segments_.clear();
+        size_ = 0;
+
+        BufferType& glue = buffers_[threadCount_];
+        WriterType writer(glue);
+        writer.SetMaxDecimalPlaces(maxDecimalPlaces_);
+        BeginGlue();
+        if (!Plan(value, static_cast<size_t>(threadCount_) * tasksPerThread_, writer))
+            return false;
+        EndGlue();
+
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < threadCount_ && i < tasks_.size(); i++)
+            threads.push_back(std::thread(&GenericParallelWriter::template Work<ValueType>, this, i, &next));
+        Work<ValueType>(0, &next);
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+
+        for (size_t i = 0; i < tasks_.size(); i++)
+            if (!tasks_[i].succeeded)
+                return false;
+
+        for (size_t i = 0; i < pieces_.size(); i++) {
+            const Piece& p = pieces_[i];
+            if (p.length == 0)
+                continue;
+            Segment s;
+            s.iov_base = const_cast<char*>(reinterpret_cast<const char*>(buffers_[p.buffer].GetString())) + p.offset;
+            s.iov_len = p.length;
+            segments_.push_back(s);
+            size_ += p.length;
+        }
+        return true;
+    }
+
+    //! Get the number of segments of the output.
+    size_t GetSegmentCount() const { return segments_.size(); }
+
+    //! Get the segments of the output, in order.
+    const Segment* GetSegments() const { return segments_.empty() ? 0 : &segments_[0]; }
+
+    //! Get the size of the output in bytes.
+    size_t GetSize() const { return size_; }
+
+    //! Copy the output to a stream, for outputs which cannot take the segments.
+    template <typename OutputStream>
+    void Put(OutputStream& os) const {
+        typedef typename TargetEncoding::Ch TargetCh;
+        for (size_t i = 0; i < segments_.size(); i++) {
+            const TargetCh* p = static_cast<const TargetCh*>(segments_[i].iov_base);
+            for (size_t j = 0; j < segments_[i].iov_len / sizeof(TargetCh); j++)
+                os.Put(p[j]);
+        }
+    }
+
+#ifndef _WIN32
+    //! Write the output to a file descriptor with writev().
+    /*! Partial writes and interruptions are resumed.
+        \return Whether the whole output is written. Otherwise errno is set by writev().
+    */
+    bool WriteTo(int fd) const {
+#if defined(IOV_MAX) && IOV_MAX < 64
+        static const size_t kBatchSize = IOV_MAX;
+#else
+        static const size_t kBatchSize = 64;
+#endif
+        Segment batch[kBatchSize];
+        size_t count = 0;
+        for (size_t next = 0; ; ) {
+            while (count < kBatchSize && next < segments_.size())
+                batch[count++] = segments_[next++];
+            if (count == 0)
+                return true;
+
+            ssize_t written = writev(fd, batch, static_cast<int>(count));
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+
+            // Drop what is written, resuming in the middle of a segment.
+            size_t n = static_cast<size_t>(written), k = 0;
+            for (; k < count && n >= batch[k].iov_len; k++)
+                n -= batch[k].iov_len;
+            if (k < count) {
+                batch[k].iov_base = static_cast<char*>(batch[k].iov_base) + n;
+                batch[k].iov_len -= n;
+            }
+            for (size_t i = k; i < count; i++)
+                batch[i - k] = batch[i];
+            count -= k;
+        }
+    }
+#endif
+
+    //! Free the buffers and the segments.
+    void Clear() {
+        for (size_t i = 0; i < buffers_.size(); i++) {
+            buffers_[i].Clear();
+            buffers_[i].ShrinkToFit();
+        }
+        std::vector<Task>().swap(tasks_);
+        std::vector<Piece>().swap(pieces_);
+        std::vector<Segment>().swap(segments_);
+        size_ = 0;
+    }
+
+private:
+    // Prohibit copying
+    GenericParallelWriter(const GenericParallelWriter&);
+    GenericParallelWriter& operator=(const GenericParallelWriter&);
+
+    //! Range of children of a container, or a whole value if \c end is 0.
+    struct Task {
+        const void* value;
+        SizeType begin;
+        SizeType end;
+        size_t piece;           //!< Index of the piece receiving the output.
+        bool succeeded;
+    };
+
+    //! Part of the output in one of the buffers.
+    struct Piece {
+        size_t buffer;
+        size_t offset;          //!< In bytes.
+        size_t length;          //!< In bytes.
+    };
+
+    template <typename ValueType>
+    static SizeType ChildCount(const ValueType& v) {
+        return v.IsObject() ? v.MemberCount() : v.IsArray() ? v.Size() : 0;
+    }
+
+    //! Split a value into tasks, writing what lies between them with the calling thread's writer.
+    template <typename ValueType>
+    bool Plan(const ValueType& v, size_t share, WriterType& writer) {
+        const SizeType n = ChildCount(v);
+        if (n == 0) {
+            writer.Reset(buffers_[threadCount_]);
+            return v.Accept(writer);
+        }
+        if (share <= 1) {
+            AddTask(&v, 0, 0);
+            return true;
+        }
+
+        BufferType& glue = buffers_[threadCount_];
+        glue.Put(v.IsObject() ? '{' : '[');
+        if (n >= share) {
+            for (size_t r = 0; r < share; r++)
+                AddTask(&v, static_cast<SizeType>(n * r / share), static_cast<SizeType>(n * (r + 1) / share));
+        }
+        else {
+            size_t total = 0;
+            for (SizeType i = 0; i < n; i++)
+                total += 1 + ChildCount(Child(v, i));
+            for (SizeType i = 0; i < n; i++) {
+                if (i > 0)
+                    glue.Put(',');
+                if (v.IsObject() && !WriteName(v.MemberBegin()[i].name, writer))
+                    return false;
+                const ValueType& c = Child(v, i);
+                if (!Plan(c, share * (1 + ChildCount(c)) / total, writer))
+                    return false;
+            }
+        }
+        glue.Put(v.IsObject() ? '}' : ']');
+        return true;
+    }
+
+    template <typename ValueType>
+    static const ValueType& Child(const ValueType& v, SizeType i) {
+        return v.IsObject() ? v.MemberBegin()[i].value : v[i];
+    }
+
+    template <typename ValueType>
+    bool WriteName(const ValueType& name, WriterType& writer) {
+        BufferType& glue = buffers_[threadCount_];
+        writer.Reset(glue);
+        if (!writer.String(name.GetString(), name.GetStringLength()))
+            return false;
+        glue.Put(':');
+        return true;
+    }
+
+    void AddTask(const void* value, SizeType begin, SizeType end) {
+        EndGlue();
+        Task t;
+        t.value = value;
+        t.begin = begin;
+        t.end = end;
+        t.piece = pieces_.size();
+        t.succeeded = false;
+        tasks_.push_back(t);
+
+        Piece p = { 0, 0, 0 };
+        pieces_.push_back(p);
+        BeginGlue();
+    }
+
+    void BeginGlue() {
+        Piece p = { threadCount_, buffers_[threadCount_].GetSize(), 0 };
+        pieces_.push_back(p);
+    }
+
+    void EndGlue() {
+        Piece& p = pieces_.back();
+        p.length = buffers_[threadCount_].GetSize() - p.offset;
+    }
+
+    //! Run tasks in order on a thread, with its own buffer and writer.
+    template <typename ValueType>
+    void Work(size_t thread, std::atomic<size_t>* next) {
+        BufferType& buffer = buffers_[thread];
+        WriterType writer(buffer);
+        writer.SetMaxDecimalPlaces(maxDecimalPlaces_);
+        for (size_t i; (i = next->fetch_add(1)) < tasks_.size(); ) {
+            Task& t = tasks_[i];
+            const ValueType& v = *static_cast<const ValueType*>(t.value);
+            const size_t offset = buffer.GetSize();
+            bool succeeded = true;
+            if (t.end == 0) {
+                writer.Reset(buffer);
+                succeeded = v.Accept(writer);
+            }
+            else {
+                if (t.begin > 0)
+                    buffer.Put(',');
+                for (SizeType j = t.begin; j < t.end && succeeded; j++) {
+                    if (j > t.begin)
+                        buffer.Put(',');
+                    if (v.IsObject()) {
+                        const typename ValueType::Member& m = v.MemberBegin()[j];
+                        writer.Reset(buffer);
+                        succeeded = writer.String(m.name.GetString(), m.name.GetStringLength());
+                        buffer.Put(':');
+                        writer.Reset(buffer);
+                        succeeded = succeeded && m.value.Accept(writer);
+                    }
+                    else {
+                        writer.Reset(buffer);
+                        succeeded = v[j].Accept(writer);
+                    }
+                }
+            }
+            Piece& p = pieces_[t.piece];
+            p.buffer = thread;
+            p.offset = offset;
+            p.length = buffer.GetSize() - offset;
+            t.succeeded = succeeded;
+        }
+    }
+
+    unsigned threadCount_;
+    unsigned tasksPerThread_;
+    int maxDecimalPlaces_;
+    std::vector<BufferType> buffers_;   //!< One per thread, then the calling thread's pieces between tasks.
+    std::vector<Task> tasks_;
+    std::vector<Piece> pieces_;
+    std::vector<Segment> segments_;
+    size_t size_;
+};
+
+//! GenericParallelWriter with UTF8 encoding and default allocator.
+typedef GenericParallelWriter<> ParallelWriter;
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __clang__
+RAPIDJSON_DIAG_POP
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_PARALLELWRITER_H_
@@ -0,0 +1,691 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_PATCH_H_
+#define RAPIDJSON_PATCH_H_
+
+/*! \file patch.h */
+
+#include "pointer.h"
+#include "internal/ieee754.h"
+#include <cstring>
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(padded)
+RAPIDJSON_DIAG_OFF(switch-enum)
+#elif defined(_MSC_VER)
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(4512) // assignment operator could not be generated
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+//! Error code of applying a JSON Patch.
+/*! \ingroup RAPIDJSON_ERRORS
+    \see GenericPatch::Apply, GenericPatch::GetErrorCode
+*/
+enum PatchErrorCode {
+    kPatchErrorNone = 0,                //!< The patch is applied successfully.
+
+    kPatchErrorInvalidPatch,            //!< The patch is not an array of objects.
+    kPatchErrorInvalidOperation,        //!< Missing or unknown "op".
+    kPatchErrorInvalidPointer,          //!< Missing or invalid "path" or "from".
+    kPatchErrorMissingValue,            //!< Missing "value" in add, replace or test.
+    kPatchErrorPathNotFound,            //!< The location of "path" or "from" does not exist.
+    kPatchErrorMoveIntoChild,           //!< "from" of move is a proper prefix of "path".
+    kPatchErrorTestFailed               //!< The value of a test operation is not equal.
+};
+
+namespace internal {
+
+//! Hash and size of a value's subtree, stored in pre-order by GenericPatch.
+struct PatchSubtree {
+    uint64_t hash;  //!< Hash of the subtree, computed as Hasher in schema.h does.
+    SizeType size;  //!< Number of values in the subtree, including itself.
+};
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericPatch
+
+//! Computes and applies JSON Patches. Use Patch for UTF8 encoding and default allocator.
+/*!
+    This class implements RFC 6902 "JavaScript Object Notation (JSON) Patch"
+    (https://tools.ietf.org/html/rfc6902).
+
+    Diff() walks two trees and produces the operations which transform the
+    source into the target, so that only the changes of a large document
+    need to be serialized. Before walking, every subtree of both trees is
+    hashed once, the way Hasher in schema.h does (member order insensitive),
+    and a pair of subtrees with equal hashes is skipped without being
+    compared. Changes are found as follows:
+
+    - Members of objects are matched by name, first at the same position
+      then with FindMember(). Unmatched members produce remove and add.
+    - Arrays are trimmed of their common prefix and suffix. The remaining
+      elements are diffed pairwise, and the extra elements are removed or
+      added, so a single insertion or removal produces a single operation.
+    - Values of different types produce a replace.
+
+    Apply() applies a patch to a value in place, copying the values of
+    the patch with the allocator of the document.
+
+    \code
+    Patch patch;
+    Document delta;
+    patch.Diff(previous, current, delta);   // delta is sent instead of current
+
+    Patch receiver;
+    if (!receiver.Apply(state, delta))      // state now equals current
+        printf("error %d at operation %u\n", receiver.GetErrorCode(), receiver.GetErrorIndex());
+    \endcode
+
+    \tparam ValueType Type of the values, e.g. GenericValue.
+    \tparam Allocator Allocator for the work stacks and the parsed pointers.
+    \note Equal hashes are taken as equal subtrees; with 64-bit hashes
+        a collision omitting a change is not expected in practice.
+    \note Apply() stops at the first failing operation and leaves the
+        operations before it applied. Apply to a copy when the patch
+        must be all-or-nothing.
+*/
+template <typename ValueType, typename Allocator = CrtAllocator>
+class GenericPatch {
+public:
+    typedef typename ValueType::EncodingType EncodingType;  //!< Encoding type from Value
+    typedef typename ValueType::Ch Ch;                      //!< Character type from Value
+    typedef GenericPointer<ValueType, Allocator> PointerType;
+    typedef typename PointerType::Token Token;
+
+    //! Constructor.
+    /*! \param allocator Allocator for the work stacks. If null, a default one is created.
+    */
+    GenericPatch(Allocator* allocator = 0) :
+        allocator_(allocator),
+        source_(allocator, kDefaultStackCapacity),
+        target_(allocator, kDefaultStackCapacity),
+        scratch_(allocator, kDefaultStackCapacity),
+        path_(allocator, kDefaultStackCapacity),
+        errorCode_(kPatchErrorNone),
+        errorIndex_() {}
+
+    //!@name Diff
+    //@{
+
+    //! Computes the patch transforming a value into another.
+    /*!
+        \param source Value before the change.
+        \param target Value after the change.
+        \param patch Set to an array of the operations, empty if both are equal.
+        \param allocator Allocator for the operations and the values copied from \c target.
+    */
+    void Diff(const ValueType& source, const ValueType& target, ValueType& patch, typename ValueType::AllocatorType& allocator) {
+        source_.Clear();
+        target_.Clear();
+        path_.Clear();
+        HashSubtree(source, source_);
+        HashSubtree(target, target_);
+
+        patch.SetArray();
+        DiffValue(source, 0, target, 0, patch, allocator);
+    }
+
+    //! Computes the patch transforming a value into another.
+    /*!
+        \param source Value before the change.
+        \param target Value after the change.
+        \param patch Document set to an array of the operations, with its allocator.
+    */
+    template <typename stackAllocator>
+    void Diff(const ValueType& source, const ValueType& target, GenericDocument<EncodingType, typename ValueType::AllocatorType, stackAllocator>& patch) {
+        Diff(source, target, patch, patch.GetAllocator());
+    }
+
+    //@}
+
+    //!@name Apply
+    //@{
+
+    //! Applies a patch to a value in place.
+    /*!
+        \param root Root value to which the paths of the operations refer.
+        \param patch Array of operations.
+        \param allocator Allocator for the values added to \c root.
+        \return Whether all operations are applied. Otherwise see GetErrorCode() and GetErrorIndex().
+    */
+    bool Apply(ValueType& root, const ValueType& patch, typename ValueType::AllocatorType& allocator) {
+        errorCode_ = kPatchErrorNone;
+        errorIndex_ = 0;
+        if (!patch.IsArray()) {
+            errorCode_ = kPatchErrorInvalidPatch;
+            return false;
+        }
+
+        for (SizeType i = 0; i < patch.Size(); i++) {
+            PatchErrorCode e = ApplyOperation(root, patch[i], allocator);
+            if (e != kPatchErrorNone) {
+                errorCode_ = e;
+                errorIndex_ = i;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //! Applies a patch to a document in place, with the document's allocator.
+    template <typename stackAllocator>
+    bool Apply(GenericDocument<EncodingType, typename ValueType::AllocatorType, stackAllocator>& document, const ValueType& patch) {
+        return Apply(document, patch, document.GetAllocator());
+    }
+
+    //! Whether the last Apply() failed.
+    bool HasError() const { return errorCode_ != kPatchErrorNone; }
+
+    //! Get the error code of the last Apply().
+    PatchErrorCode GetErrorCode() const { return errorCode_; }
+
+    //! Get the index of the operation at which the last Apply() failed.
+    SizeType GetErrorIndex() const { return errorIndex_; }
+
+    //@}
+
+private:
+    // Prohibit copying
+    GenericPatch(const GenericPatch&);
+    GenericPatch& operator=(const GenericPatch&);
+
+    static const size_t kDefaultStackCapacity = 256;
+
+    typedef internal::PatchSubtree Subtree;
+
+    // Generate functions for string literal according to Ch
+#define RAPIDJSON_STRING_(name, ...) \
+    static const ValueType& Get##name##String() {\
+        static const Ch s[] = { __VA_ARGS__, '\0' };\
+        static const ValueType v(s, static_cast<SizeType>(sizeof(s) / sizeof(Ch) - 1));\
+        return v;\
+    }
+
+    RAPIDJSON_STRING_(Op, 'o', 'p')
+    RAPIDJSON_STRING_(Path, 'p', 'a', 't', 'h')
+    RAPIDJSON_STRING_(From, 'f', 'r', 'o', 'm')
+    RAPIDJSON_STRING_(Value, 'v', 'a', 'l', 'u', 'e')
+    RAPIDJSON_STRING_(Add, 'a', 'd', 'd')
+    RAPIDJSON_STRING_(Remove, 'r', 'e', 'm', 'o', 'v', 'e')
+    RAPIDJSON_STRING_(Replace, 'r', 'e', 'p', 'l', 'a', 'c', 'e')
+    RAPIDJSON_STRING_(Move, 'm', 'o', 'v', 'e')
+    RAPIDJSON_STRING_(Copy, 'c', 'o', 'p', 'y')
+    RAPIDJSON_STRING_(Test, 't', 'e', 's', 't')
+
+#undef RAPIDJSON_STRING_
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Hashing
+
+    static uint64_t Hash(uint64_t h, uint64_t d) {
+        static const uint64_t kPrime = RAPIDJSON_UINT64_C2(0x00000100, 0x000001b3);
+        h ^= d;
+        h *= kPrime;
+        return h;
+    }
+
+    static uint64_t HashBuffer(unsigned tag, const void* data, size_t len) {
+        // FNV-1a from http://isthe.com/chongo/tech/comp/fnv/, taking 8 bytes
+        // at a time and folding the high half down, as the multiplication
+        // only carries upwards.
+        uint64_t h = Hash(RAPIDJSON_UINT64_C2(0x84222325, 0xcbf29ce4), tag);
+        const unsigned char* d = static_cast<const unsigned char*>(data);
+        for (; len >= sizeof(uint64_t); d += sizeof(uint64_t), len -= sizeof(uint64_t)) {
+            uint64_t w;
+            std::memcpy(&w, d, sizeof(w));
+            h = Hash(h, w);
+            h ^= h >> 32;
+        }
+        for (size_t i = 0; i < len; i++)
+            h = Hash(h, d[i]);
+        return h;
+    }
+
+    static uint64_t HashString(const ValueType& v) {
+        return HashBuffer(kStringType, v.GetString(), v.GetStringLength() * sizeof(Ch));
+    }
+
+    static bool IsEqual(double a, double b) { return a >= b && a <= b; } // Prevent -Wfloat-equal
+
+    // Integers hash their 64-bit pattern, as operator== compares them, and
+    // so do integral doubles, which compare equal to the same integers. Other
+    // doubles hash their bits under another tag, so they cannot collide with
+    // the integer sharing that bit pattern.
+    static uint64_t HashNumber(const ValueType& v) {
+        uint64_t u;
+        if (!v.IsDouble())
+            u = v.IsUint64() ? v.GetUint64() : static_cast<uint64_t>(v.GetInt64());
+        else {
+            double d = v.GetDouble();
+            if (d >= -9223372036854775808.0 && d < 9223372036854775808.0 && IsEqual(static_cast<double>(static_cast<int64_t>(d)), d))
+                u = static_cast<uint64_t>(static_cast<int64_t>(d));
+            else if (d >= 0.0 && d < 18446744073709551616.0 && IsEqual(static_cast<double>(static_cast<uint64_t>(d)), d))
+                u = static_cast<uint64_t>(d);
+            else
+                return HashBuffer(kNumberType + 1, &d, sizeof(d));
+        }
+        return HashBuffer(kNumberType, &u, sizeof(u));
+    }
+
+    //! Appends the subtrees of v in pre-order and returns the hash of v.
+    static uint64_t HashSubtree(const ValueType& v, internal::Stack<Allocator>& subtrees) {
+        size_t index = subtrees.GetSize() / sizeof(Subtree);
+        subtrees.template Push<Subtree>();
+
+        uint64_t h;
+        switch (v.GetType()) {
+        case kObjectType:
+            h = Hash(0, kObjectType);
+            for (typename ValueType::ConstMemberIterator m = v.MemberBegin(); m != v.MemberEnd(); ++m)
+                h ^= Hash(HashString(m->name), HashSubtree(m->value, subtrees)); // Use xor to achieve member order insensitive
+            break;
+
+        case kArrayType:
+            h = Hash(0, kArrayType);
+            for (typename ValueType::ConstValueIterator e = v.Begin(); e != v.End(); ++e)
+                h = Hash(h, HashSubtree(*e, subtrees)); // Use hash to achieve element order sensitive
+            break;
+
+        case kStringType:
+            h = HashString(v);
+            break;
+
+        case kNumberType:
+            h = HashNumber(v);
+            break;
+
+        default:
+            h = HashBuffer(v.GetType(), 0, 0);
+            break;
+        }
+
+        Subtree* s = subtrees.template Bottom<Subtree>() + index;
+        s->hash = h;
+        s->size = static_cast<SizeType>(subtrees.GetSize() / sizeof(Subtree) - index);
+        return h;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Diff
+
+    // a and b are the values at pre-order indices ia and ib of source_ and target_.
+    void DiffValue(const ValueType& a, SizeType ia, const ValueType& b, SizeType ib, ValueType& patch, typename ValueType::AllocatorType& allocator) {
+        if (source_.template Bottom<Subtree>()[ia].hash == target_.template Bottom<Subtree>()[ib].hash)
+            return;
+
+        if (a.IsObject() && b.IsObject())
+            DiffObject(a, ia, b, ib, patch, allocator);
+        else if (a.IsArray() && b.IsArray())
+            DiffArray(a, ia, b, ib, patch, allocator);
+        else
+            AddOperation(GetReplaceString(), &b, patch, allocator);
+    }
+
+    void DiffObject(const ValueType& a, SizeType ia, const ValueType& b, SizeType ib, ValueType& patch, typename ValueType::AllocatorType& allocator) {
+        // Pre-order index of each member of b, and whether it is matched.
+        const SizeType n = b.MemberCount();
+        const size_t base = scratch_.GetSize() / sizeof(SizeType);
+        SizeType* t = n ? scratch_.template Push<SizeType>(n * 2) : 0; // Nothing to push for an empty object
+        for (SizeType k = 0, ik = ib + 1; k < n; k++) {
+            t[k * 2] = ik;
+            t[k * 2 + 1] = 0;
+            ik += target_.template Bottom<Subtree>()[ik].size;
+        }
+
+        typename ValueType::ConstMemberIterator bm = b.MemberBegin();
+        SizeType j = 0, ij = ia + 1;
+        for (typename ValueType::ConstMemberIterator m = a.MemberBegin(); m != a.MemberEnd(); ++m, ++j) {
+            SizeType k = j;
+            if (k >= n || bm[k].name != m->name)
+                k = static_cast<SizeType>(b.FindMember(m->name) - bm);
+
+            size_t mark = PushToken(m->name.GetString(), m->name.GetStringLength());
+            t = scratch_.template Bottom<SizeType>() + base;
+            if (k < n && !t[k * 2 + 1]) {
+                t[k * 2 + 1] = 1;
+                DiffValue(m->value, ij, bm[k].value, t[k * 2], patch, allocator);
+            }
+            else
+                AddOperation(GetRemoveString(), 0, patch, allocator);
+            PopToken(mark);
+
+            ij += source_.template Bottom<Subtree>()[ij].size;
+        }
+
+        for (SizeType k = 0; k < n; k++) {
+            if (!scratch_.template Bottom<SizeType>()[base + k * 2 + 1]) {
+                size_t mark = PushToken(bm[k].name.GetString(), bm[k].name.GetStringLength());
+                AddOperation(GetAddString(), &bm[k].value, patch, allocator);
+                PopToken(mark);
+            }
+        }
+
+        scratch_.template Pop<SizeType>(n * 2);
+    }
+
+    void DiffArray(const ValueType& a, SizeType ia, const ValueType& b, SizeType ib, ValueType& patch, typename ValueType::AllocatorType& allocator) {
+        // Pre-order index of each element of a then of b.
+        const SizeType n = a.Size(), m = b.Size();
+        const size_t base = scratch_.GetSize() / sizeof(SizeType);
+        SizeType* t = n + m ? scratch_.template Push<SizeType>(n + m) : 0;
+        for (SizeType k = 0, ik = ia + 1; k < n; k++) {
+            t[k] = ik;
+            ik += source_.template Bottom<Subtree>()[ik].size;
+        }
+        for (SizeType k = 0, ik = ib + 1; k < m; k++) {
+            t[n + k] = ik;
+            ik += target_.template Bottom<Subtree>()[ik].size;
+        }
+
+        const Subtree* sa = source_.template Bottom<Subtree>();
+        const Subtree* sb = target_.template Bottom<Subtree>();
+        SizeType prefix = 0, suffix = 0;
+        while (prefix < n && prefix < m && sa[t[prefix]].hash == sb[t[n + prefix]].hash)
+            prefix++;
+        while (suffix < n - prefix && suffix < m - prefix && sa[t[n - 1 - suffix]].hash == sb[t[n + m - 1 - suffix]].hash)
+            suffix++;
+
+        // Indices of the elements before the suffix are the same in a and b
+        // until the extra elements are removed or added.
+        const SizeType na = n - suffix, nb = m - suffix;
+        SizeType k = prefix;
+        for (; k < na && k < nb; k++) {
+            size_t mark = PushToken(k);
+            t = scratch_.template Bottom<SizeType>() + base;
+            DiffValue(a[k], t[k], b[k], t[n + k], patch, allocator);
+            PopToken(mark);
+        }
+        for (SizeType r = na; r > k; r--) {
+            size_t mark = PushToken(r - 1);
+            AddOperation(GetRemoveString(), 0, patch, allocator);
+            PopToken(mark);
+        }
+        for (; k < nb; k++) {
+            size_t mark = PushToken(k);
+            AddOperation(GetAddString(), &b[k], patch, allocator);
+            PopToken(mark);
+        }
+
+        scratch_.template Pop<SizeType>(n + m);
+    }
+
+    //! Appends a reference token to the path, escaping '~' and '/'.
+    //! \return Size of the path before, to be restored by PopToken(size).
+    size_t PushToken(const Ch* name, SizeType length) {
+        size_t size = path_.GetSize();
+        *path_.template Push<Ch>() = '/';
+        for (SizeType i = 0; i < length; i++) {
+            Ch c = name[i];
+            if (c == '~' || c == '/') {
+                Ch* e = path_.template Push<Ch>(2);
+                e[0] = '~';
+                e[1] = c == '~' ? '0' : '1';
+            }
+            else
+                *path_.template Push<Ch>() = c;
+        }
+        return size;
+    }
+
+    size_t PushToken(SizeType index) {
+        char buffer[21];
+        char* end = sizeof(SizeType) == 4 ? internal::u32toa(index, buffer) : internal::u64toa(index, buffer);
+        size_t size = path_.GetSize();
+        Ch* p = path_.template Push<Ch>(static_cast<size_t>(end - buffer) + 1);
+        *p++ = '/';
+        for (const char* c = buffer; c != end; ++c)
+            *p++ = static_cast<Ch>(*c);
+        return size;
+    }
+
+    void PopToken(size_t size) {
+        path_.template Pop<char>(path_.GetSize() - size);
+    }
+
+    static GenericStringRef<Ch> Ref(const ValueType& s) {
+        return GenericStringRef<Ch>(s.GetString(), s.GetStringLength());
+    }
+
+    void AddOperation(const ValueType& op, const ValueType* value, ValueType& patch, typename ValueType::AllocatorType& allocator) {
+        static const Ch kRoot[] = { '\0' };
+        ValueType path(path_.Empty() ? kRoot : path_.template Bottom<Ch>(), static_cast<SizeType>(path_.GetSize() / sizeof(Ch)), allocator);
+        ValueType o(kObjectType);
+        o.AddMember(Ref(GetOpString()), Ref(op), allocator);
+        o.AddMember(Ref(GetPathString()), path, allocator);
+        if (value) {
+            ValueType copy(*value, allocator);
+            o.AddMember(Ref(GetValueString()), copy, allocator);
+        }
+        patch.PushBack(o, allocator);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Apply
+
+    PatchErrorCode ApplyOperation(ValueType& root, const ValueType& operation, typename ValueType::AllocatorType& allocator) {
+        if (!operation.IsObject())
+            return kPatchErrorInvalidPatch;
+
+        typename ValueType::ConstMemberIterator op = operation.FindMember(GetOpString());
+        if (op == operation.MemberEnd() || !op->value.IsString())
+            return kPatchErrorInvalidOperation;
+
+        PointerType path(allocator_);
+        if (!GetPointer(operation, GetPathString(), path))
+            return kPatchErrorInvalidPointer;
+
+        const ValueType& name = op->value;
+        if (name == GetRemoveString()) {
+            ValueType removed;
+            SizeType position;
+            return Remove(root, path, removed, &position);
+        }
+
+        if (name == GetMoveString() || name == GetCopyString()) {
+            PointerType from(allocator_);
+            if (!GetPointer(operation, GetFromString(), from))
+                return kPatchErrorInvalidPointer;
+
+            if (name == GetCopyString()) {
+                const ValueType* v = from.Get(root);
+                if (!v)
+                    return kPatchErrorPathNotFound;
+                ValueType copy(*v, allocator);
+                return Add(root, path, copy, allocator);
+            }
+
+            if (IsPrefix(from, path))
+                return from.GetTokenCount() == path.GetTokenCount() ? (from.Get(root) ? kPatchErrorNone : kPatchErrorPathNotFound) : kPatchErrorMoveIntoChild;
+            ValueType moved;
+            SizeType position;
+            PatchErrorCode e = Remove(root, from, moved, &position);
+            if (e == kPatchErrorNone && (e = Add(root, path, moved, allocator)) != kPatchErrorNone)
+                Restore(root, from, position, moved, allocator); // A failed operation leaves the value unchanged
+            return e;
+        }
+
+        typename ValueType::ConstMemberIterator value = operation.FindMember(GetValueString());
+        if (name == GetAddString() || name == GetReplaceString() || name == GetTestString()) {
+            if (value == operation.MemberEnd())
+                return kPatchErrorMissingValue;
+        }
+        else
+            return kPatchErrorInvalidOperation;
+
+        if (name == GetTestString()) {
+            const ValueType* v = path.Get(root);
+            if (!v)
+                return kPatchErrorPathNotFound;
+            return *v == value->value ? kPatchErrorNone : kPatchErrorTestFailed;
+        }
+
+        ValueType copy(value->value, allocator);
+        if (name == GetAddString())
+            return Add(root, path, copy, allocator);
+
+        ValueType* v = path.Get(root);
+        if (!v)
+            return kPatchErrorPathNotFound;
+        *v = copy;
+        return kPatchErrorNone;
+    }
+
+    bool GetPointer(const ValueType& operation, const ValueType& key, PointerType& pointer) const {
+        typename ValueType::ConstMemberIterator m = operation.FindMember(key);
+        if (m == operation.MemberEnd() || !m->value.IsString())
+            return false;
+        PointerType(m->value.GetString(), m->value.GetStringLength(), allocator_).Swap(pointer);
+        return pointer.IsValid();
+    }
+
+    static bool IsPrefix(const PointerType& prefix, const PointerType& pointer) {
+        if (prefix.GetTokenCount() > pointer.GetTokenCount())
+            return false;
+        for (size_t i = 0; i < prefix.GetTokenCount(); i++) {
+            const Token& a = prefix.GetTokens()[i];
+            const Token& b = pointer.GetTokens()[i];
+            if (a.length != b.length || std::memcmp(a.name, b.name, sizeof(Ch) * a.length) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    //! Resolves the parent of the location of pointer, which must not be the root.
+    static ValueType* GetParent(ValueType& root, const PointerType& pointer) {
+        return PointerType(pointer.GetTokens(), pointer.GetTokenCount() - 1).Get(root);
+    }
+
+    //! Adds value, which is moved, at the location of pointer.
+    static PatchErrorCode Add(ValueType& root, const PointerType& pointer, ValueType& value, typename ValueType::AllocatorType& allocator) {
+        if (pointer.GetTokenCount() == 0) {
+            root = value;
+            return kPatchErrorNone;
+        }
+
+        ValueType* parent = GetParent(root, pointer);
+        const Token& t = pointer.GetTokens()[pointer.GetTokenCount() - 1];
+        if (parent && parent->IsObject()) {
+            typename ValueType::MemberIterator m = parent->FindMember(GenericStringRef<Ch>(t.name, t.length));
+            if (m != parent->MemberEnd())
+                m->value = value;
+            else {
+                ValueType name(t.name, t.length, allocator);
+                parent->AddMember(name, value, allocator);
+            }
+            return kPatchErrorNone;
+        }
+        if (parent && parent->IsArray()) {
+            if (t.length == 1 && t.name[0] == '-') {
+                parent->PushBack(value, allocator);
+                return kPatchErrorNone;
+            }
+            if (t.index == kPointerInvalidIndex || t.index > parent->Size())
+                return kPatchErrorPathNotFound;
+
+            // Append, then rotate into place.
+            parent->PushBack(value, allocator);
+            for (SizeType i = parent->Size() - 1; i > t.index; i--)
+                (*parent)[i].Swap((*parent)[i - 1]);
+            return kPatchErrorNone;
+        }
+        return kPatchErrorPathNotFound;
+    }
+
+    //! Removes the value at the location of pointer, which is moved to removed.
+    /*! \param position Set to the index of the removed member or element in its parent. */
+    static PatchErrorCode Remove(ValueType& root, const PointerType& pointer, ValueType& removed, SizeType* position) {
+        if (pointer.GetTokenCount() == 0) // Cannot remove the root
+            return kPatchErrorPathNotFound;
+
+        ValueType* parent = GetParent(root, pointer);
+        const Token& t = pointer.GetTokens()[pointer.GetTokenCount() - 1];
+        if (parent && parent->IsObject()) {
+            typename ValueType::MemberIterator m = parent->FindMember(GenericStringRef<Ch>(t.name, t.length));
+            if (m == parent->MemberEnd())
+                return kPatchErrorPathNotFound;
+            *position = static_cast<SizeType>(m - parent->MemberBegin());
+            removed = m->value;
+            parent->EraseMember(m);
+            return kPatchErrorNone;
+        }
+        if (parent && parent->IsArray()) {
+            if (t.index == kPointerInvalidIndex || t.index >= parent->Size())
+                return kPatchErrorPathNotFound;
+            *position = t.index;
+            removed = (*parent)[t.index];
+            parent->Erase(parent->Begin() + t.index);
+            return kPatchErrorNone;
+        }
+        return kPatchErrorPathNotFound;
+    }
+
+    //! Puts a value removed by Remove() back at its former position.
+    static void Restore(ValueType& root, const PointerType& pointer, SizeType position, ValueType& value, typename ValueType::AllocatorType& allocator) {
+        ValueType* parent = GetParent(root, pointer);
+        RAPIDJSON_ASSERT(parent != 0);
+        if (parent->IsArray()) {
+            parent->PushBack(value, allocator);
+            for (SizeType i = parent->Size() - 1; i > position; i--)
+                (*parent)[i].Swap((*parent)[i - 1]);
+            return;
+        }
+
+        const Token& t = pointer.GetTokens()[pointer.GetTokenCount() - 1];
+        ValueType name(t.name, t.length, allocator);
+        parent->AddMember(name, value, allocator);
+        // Move the members which followed it to the end, with the object API to keep its member index consistent.
+        for (SizeType i = parent->MemberCount() - 1; i > position; i--) {
+            typename ValueType::MemberIterator m = parent->MemberBegin() + position;
+            ValueType n, v;
+            n.Swap(m->name);
+            v.Swap(m->value);
+            parent->EraseMember(m);
+            parent->AddMember(n, v, allocator);
+        }
+    }
+
+    Allocator* allocator_;
+    internal::Stack<Allocator> source_;     //!< Subtrees of the source in pre-order.
+    internal::Stack<Allocator> target_;     //!< Subtrees of the target in pre-order.
+    internal::Stack<Allocator> scratch_;    //!< Member and element indices of the containers being diffed.
+    internal::Stack<Allocator> path_;       //!< Escaped path of the value being diffed.
+    PatchErrorCode errorCode_;
+    SizeType errorIndex_;
+};
+
+//! GenericPatch for Value (UTF-8, default allocator).
+typedef GenericPatch<Value> Patch;
+
+RAPIDJSON_NAMESPACE_END
+
+#if defined(__clang__) || defined(_MSC_VER)
+RAPIDJSON_DIAG_POP
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_PATCH_H_
@@ -17,6 +17,7 @@
 
 #include "document.h"
 #include "internal/itoa.h"
+#include <algorithm> // std::sort
 
 #ifdef __clang__
 RAPIDJSON_DIAG_PUSH
@@ -1108,6 +1109,326 @@ private:
 //! GenericPointer for Value (UTF-8, default allocator).
 typedef GenericPointer<Value> Pointer;
 
+///////////////////////////////////////////////////////////////////////////////
+// GenericCompiledPointer
+
+//! A JSON Pointer which caches the member positions it resolved.
+/*!
+    For every token, it remembers the index of the member found in the last
+    resolved object. When the next document has the same shape, a member is
+    found by checking the name at the cached index only, instead of searching
+    the object. A cache miss falls back to GenericValue::FindMember() and
+    updates the cache.
+
+    This is useful for evaluating the same pointers over many similar
+    documents. Use GenericCompiledPointerSet to evaluate many pointers over
+    one document.
+
+    \tparam ValueType The value type of the DOM tree. E.g. GenericValue<UTF8<> >
+    \tparam Allocator The allocator type for allocating memory for internal representation.
+
+    \note The cache is updated by the const Get() functions, so a compiled
+    pointer must not be used by multiple threads concurrently. Copy it for
+    each thread instead.
+    \note If an object has duplicate member names, a cached index may select
+    another one of them than GenericPointer::Get() does.
+*/
+template <typename ValueType, typename Allocator = CrtAllocator>
+class GenericCompiledPointer {
+public:
+    typedef GenericPointer<ValueType, Allocator> PointerType;   //!< Pointer type.
+    typedef typename PointerType::Token Token;                  //!< Token type.
+    typedef typename ValueType::Ch Ch;                          //!< Character type from Value
+
+    //! Constructor that parses a string or URI fragment representation.
+    /*!
+        \param source A null-terminated, string or URI fragment representation of JSON pointer.
+        \param allocator User supplied allocator for this pointer. If no allocator is provided, it creates a self-owned one.
+    */
+    explicit GenericCompiledPointer(const Ch* source, Allocator* allocator = 0) : pointer_(source, allocator), allocator_(allocator), ownAllocator_(), slots_() {
+        Init();
+    }
+
+    //! Constructor from a pointer.
+    /*!
+        \param pointer Pointer to be compiled, it is copied.
+        \param allocator User supplied allocator for this pointer. If no allocator is provided, it creates a self-owned one.
+    */
+    explicit GenericCompiledPointer(const PointerType& pointer, Allocator* allocator = 0) : pointer_(pointer, allocator), allocator_(allocator), ownAllocator_(), slots_() {
+        Init();
+    }
+
+    //! Copy constructor, the cache is not copied.
+    /*! The copy shares the user supplied allocator of rhs, if any. Otherwise it creates a self-owned one,
+        so that it stays valid after rhs is destroyed.
+    */
+    GenericCompiledPointer(const GenericCompiledPointer& rhs) : 
+        pointer_(rhs.pointer_, rhs.ownAllocator_ ? 0 : rhs.allocator_), allocator_(rhs.ownAllocator_ ? 0 : rhs.allocator_), ownAllocator_(), slots_()
+    {
+        Init();
+    }
+
+    //! Destructor.
+    ~GenericCompiledPointer() {
+        Allocator::Free(slots_);
+        RAPIDJSON_DELETE(ownAllocator_);
+    }
+
+    //! Get the compiled pointer.
+    const PointerType& GetPointer() const { return pointer_; }
+
+    //! Check whether this is a valid pointer.
+    bool IsValid() const { return pointer_.IsValid(); }
+
+    //! Query a value in a subtree.
+    /*!
+        \param root Root value of a DOM sub-tree to be resolved. It can be any value other than document root.
+        \param unresolvedTokenIndex If the pointer cannot resolve a token in the pointer, this parameter can obtain the index of unresolved token.
+        \return Pointer to the value if it can be resolved. Otherwise null.
+        \see GenericPointer::Get()
+    */
+    ValueType* Get(ValueType& root, size_t* unresolvedTokenIndex = 0) const {
+        RAPIDJSON_ASSERT(IsValid());
+        ValueType* v = &root;
+        for (size_t i = 0; i < pointer_.GetTokenCount(); i++) {
+            if (!(v = Resolve(*v, i))) {
+                if (unresolvedTokenIndex)
+                    *unresolvedTokenIndex = i;
+                return 0;
+            }
+        }
+        return v;
+    }
+
+    //! Query a const value in a const subtree.
+    const ValueType* Get(const ValueType& root, size_t* unresolvedTokenIndex = 0) const {
+        return Get(const_cast<ValueType&>(root), unresolvedTokenIndex);
+    }
+
+    //! Set a value in a subtree, with move semantics.
+    /*!
+        An existing value is found with the cache, otherwise it is created with GenericPointer::Create().
+        \see GenericPointer::Set()
+    */
+    ValueType& Set(ValueType& root, ValueType& value, typename ValueType::AllocatorType& allocator) const {
+        ValueType* v = Get(root);
+        return (v ? *v : pointer_.Create(root, allocator)) = value;
+    }
+
+    //! Set a value in a subtree, with copy semantics.
+    ValueType& Set(ValueType& root, const ValueType& value, typename ValueType::AllocatorType& allocator) const {
+        ValueType* v = Get(root);
+        return (v ? *v : pointer_.Create(root, allocator)).CopyFrom(value, allocator);
+    }
+
+    //! Set a value in a document, with move semantics.
+    template <typename stackAllocator>
+    ValueType& Set(GenericDocument<typename ValueType::EncodingType, typename ValueType::AllocatorType, stackAllocator>& document, ValueType& value) const {
+        return Set(document, value, document.GetAllocator());
+    }
+
+    //! Set a value in a document, with copy semantics.
+    template <typename stackAllocator>
+    ValueType& Set(GenericDocument<typename ValueType::EncodingType, typename ValueType::AllocatorType, stackAllocator>& document, const ValueType& value) const {
+        return Set(document, value, document.GetAllocator());
+    }
+
+private:
+    template <typename, typename> friend class GenericCompiledPointerSet;
+
+    // Prohibit assignment, the pointer cannot be modified after construction.
+    GenericCompiledPointer& operator=(const GenericCompiledPointer&);
+
+    void Init() {
+        if (pointer_.GetTokenCount() == 0)
+            return;
+        if (!allocator_)
+            ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
+        slots_ = static_cast<SizeType*>(allocator_->Malloc(pointer_.GetTokenCount() * sizeof(SizeType)));
+        for (size_t i = 0; i < pointer_.GetTokenCount(); i++)
+            slots_[i] = kPointerInvalidIndex;
+    }
+
+    //! Resolve the i-th token in v, with the cached member index.
+    ValueType* Resolve(ValueType& v, size_t i) const {
+        const Token& t = pointer_.GetTokens()[i];
+        switch (v.GetType()) {
+        case kObjectType:
+            {
+                const SizeType slot = slots_[i];
+                if (slot < v.MemberCount()) {
+                    typename ValueType::MemberIterator m = v.MemberBegin() + slot;
+                    if (m->name.GetStringLength() == t.length && std::memcmp(m->name.GetString(), t.name, t.length * sizeof(Ch)) == 0)
+                        return &m->value;
+                }
+                typename ValueType::MemberIterator m = v.FindMember(GenericStringRef<Ch>(t.name, t.length));
+                if (m == v.MemberEnd())
+                    return 0;
+                slots_[i] = static_cast<SizeType>(m - v.MemberBegin());
+                return &m->value;
+            }
+        case kArrayType:
+            if (t.index == kPointerInvalidIndex || t.index >= v.Size())
+                return 0;
+            return &v[t.index];
+        default:
+            return 0;
+        }
+    }
+
+    PointerType pointer_;       //!< The compiled pointer.
+    Allocator* allocator_;      //!< The current allocator. It is either user-supplied or equal to ownAllocator_.
+    Allocator* ownAllocator_;   //!< Allocator owned by this pointer.
+    SizeType* slots_;           //!< Cached member index for each token, kPointerInvalidIndex if unknown.
+};
+
+//! GenericCompiledPointer for Value (UTF-8, default allocator).
+typedef GenericCompiledPointer<Value> CompiledPointer;
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericCompiledPointerSet
+
+//! A set of JSON Pointers evaluated together in a single walk of a document.
+/*!
+    The pointers are ordered at construction so that pointers with common
+    prefixes are adjacent. Get() resolves each pointer starting from the
+    deepest value shared with the previous one, so a common prefix is resolved
+    once per document instead of once per pointer. Each pointer also caches
+    its member positions as GenericCompiledPointer does.
+
+    \code
+    const Pointer pointers[] = { Pointer("/user/name"), Pointer("/user/id"), Pointer("/tags/0") };
+    CompiledPointerSet set(pointers, 3);
+    const Value* values[3];
+    set.Get(d, values); // values[i] is null if pointers[i] cannot be resolved.
+    \endcode
+
+    \note Like GenericCompiledPointer, it must not be used by multiple threads concurrently.
+*/
+template <typename ValueType, typename Allocator = CrtAllocator>
+class GenericCompiledPointerSet {
+public:
+    typedef GenericPointer<ValueType, Allocator> PointerType;                   //!< Pointer type.
+    typedef GenericCompiledPointer<ValueType, Allocator> CompiledPointerType;   //!< Compiled pointer type.
+
+    //! Constructor.
+    /*!
+        \param pointers Array of valid pointers, they are copied.
+        \param count Number of pointers.
+        \param allocator User supplied allocator for this set. If no allocator is provided, it creates a self-owned one.
+    */
+    GenericCompiledPointerSet(const PointerType* pointers, size_t count, Allocator* allocator = 0) :
+        allocator_(allocator), ownAllocator_(), pointers_(), order_(), common_(), path_(), count_(count)
+    {
+        if (!allocator_)
+            ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
+
+        size_t depth = 0;
+        pointers_ = static_cast<CompiledPointerType*>(allocator_->Malloc(count * sizeof(CompiledPointerType)));
+        order_ = static_cast<size_t*>(allocator_->Malloc(count * 2 * sizeof(size_t)));
+        common_ = order_ + count;
+        for (size_t i = 0; i < count; i++) {
+            RAPIDJSON_ASSERT(pointers[i].IsValid());
+            new (&pointers_[i]) CompiledPointerType(pointers[i], allocator_);
+            order_[i] = i;
+            if (pointers[i].GetTokenCount() > depth)
+                depth = pointers[i].GetTokenCount();
+        }
+
+        std::sort(order_, order_ + count, Less(pointers_));
+        for (size_t k = 0; k < count; k++)
+            common_[k] = k == 0 ? 0 : CommonPrefix(pointers_[order_[k - 1]].GetPointer(), pointers_[order_[k]].GetPointer());
+        path_ = static_cast<ValueType**>(allocator_->Malloc((depth + 1) * sizeof(ValueType*)));
+    }
+
+    //! Destructor.
+    ~GenericCompiledPointerSet() {
+        for (size_t i = 0; i < count_; i++)
+            pointers_[i].~CompiledPointerType();
+        Allocator::Free(pointers_);
+        Allocator::Free(order_);
+        Allocator::Free(path_);
+        RAPIDJSON_DELETE(ownAllocator_);
+    }
+
+    //! Get the number of pointers.
+    size_t GetCount() const { return count_; }
+
+    //! Get a compiled pointer, in construction order.
+    const CompiledPointerType& operator[](size_t index) const { RAPIDJSON_ASSERT(index < count_); return pointers_[index]; }
+
+    //! Query the values of all pointers in a subtree.
+    /*!
+        \param root Root value of a DOM sub-tree to be resolved.
+        \param values Array of GetCount() results in construction order. A result is null if the pointer cannot be resolved.
+    */
+    void Get(ValueType& root, ValueType** values) const {
+        size_t resolved = 0; // Depth of path_ resolved for the previous pointer.
+        path_[0] = &root;
+        for (size_t k = 0; k < count_; k++) {
+            const CompiledPointerType& p = pointers_[order_[k]];
+            const size_t tokenCount = p.GetPointer().GetTokenCount();
+            size_t i = common_[k] < resolved ? common_[k] : resolved;
+            for (; i < tokenCount; i++)
+                if (!(path_[i + 1] = p.Resolve(*path_[i], i)))
+                    break;
+            resolved = i;
+            values[order_[k]] = i == tokenCount ? path_[i] : 0;
+        }
+    }
+
+    //! Query the const values of all pointers in a const subtree.
+    void Get(const ValueType& root, const ValueType** values) const {
+        Get(const_cast<ValueType&>(root), const_cast<ValueType**>(values));
+    }
+
+private:
+    // Prohibit copying
+    GenericCompiledPointerSet(const GenericCompiledPointerSet&);
+    GenericCompiledPointerSet& operator=(const GenericCompiledPointerSet&);
+
+    //! Orders pointer indices lexicographically by tokens, so that a prefix comes right before its extensions.
+    struct Less {
+        Less(const CompiledPointerType* pointers) : pointers_(pointers) {}
+        bool operator()(size_t a, size_t b) const {
+            const PointerType& p = pointers_[a].GetPointer();
+            const PointerType& q = pointers_[b].GetPointer();
+            const size_t i = CommonPrefix(p, q);
+            if (i == p.GetTokenCount() || i == q.GetTokenCount())
+                return p.GetTokenCount() < q.GetTokenCount();
+            const typename PointerType::Token& s = p.GetTokens()[i];
+            const typename PointerType::Token& t = q.GetTokens()[i];
+            if (s.index != t.index)
+                return s.index < t.index;
+            if (s.length != t.length)
+                return s.length < t.length;
+            return std::memcmp(s.name, t.name, sizeof(typename PointerType::Ch) * s.length) < 0;
+        }
+        const CompiledPointerType* pointers_;
+    };
+
+    //! Number of leading tokens which are equal in both pointers.
+    static size_t CommonPrefix(const PointerType& a, const PointerType& b) {
+        const size_t n = a.GetTokenCount() < b.GetTokenCount() ? a.GetTokenCount() : b.GetTokenCount();
+        size_t i = 0;
+        for (const typename PointerType::Token *s = a.GetTokens(), *t = b.GetTokens(); i < n; i++, s++, t++)
+            if (s->index != t->index || s->length != t->length || (s->length != 0 && std::memcmp(s->name, t->name, sizeof(typename PointerType::Ch) * s->length) != 0))
+                break;
+        return i;
+    }
+
+    Allocator* allocator_;              //!< The current allocator. It is either user-supplied or equal to ownAllocator_.
+    Allocator* ownAllocator_;           //!< Allocator owned by this set.
+    CompiledPointerType* pointers_;     //!< Pointers in construction order.
+    size_t* order_;                     //!< Indices of pointers_ sorted by tokens.
+    size_t* common_;                    //!< Number of tokens shared with the previous pointer in order_.
+    ValueType** path_;                  //!< Values resolved for the tokens of the current pointer.
+    size_t count_;                      //!< Number of pointers.
+};
+
+//! GenericCompiledPointerSet for Value (UTF-8, default allocator).
+typedef GenericCompiledPointerSet<Value> CompiledPointerSet;
+
 //!@name Helper functions for GenericPointer
 //@{
 
@@ -0,0 +1,466 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_POOLEDALLOCATOR_H_
+#define RAPIDJSON_POOLEDALLOCATOR_H_
+
+/*! \file pooledallocator.h
+    \brief Memory pool allocator recycling its chunks across documents and threads.
+    \note Requires C++11 (std::atomic, thread_local).
+*/
+
+#include "allocators.h"
+#include <atomic>
+#include <cstring>
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericChunkPool
+
+//! Thread-safe pool of memory blocks for PooledAllocator.
+/*! Blocks released to the pool are kept for reuse instead of being freed.
+
+    Each thread keeps up to \c threadCacheSize released blocks in a cache of
+    its own, which serves acquisitions without any synchronization. Blocks which
+    do not fit in the cache go to a lock-free list shared by all threads. Blocks
+    are pushed to the shared list with a compare-and-swap and always taken all
+    at once, so the list is not subject to the ABA problem. A thread refilling
+    its cache keeps \c threadCacheSize blocks and puts the rest back.
+
+    Requests larger than the block size are passed to the base allocator.
+    Memory is returned to the base allocator only by Shrink() and the destructor.
+
+    \tparam BaseAllocator Allocator of the blocks, which must be thread-safe. Default is CrtAllocator.
+    \note A thread caches blocks of one pool at a time: once its cache is empty,
+        it is used for the next pool the thread acquires from or releases to.
+    \note A pool must outlive the threads using it, since their caches are
+        returned to the pool when they exit. Default() satisfies this.
+*/
+template <typename BaseAllocator = CrtAllocator>
+class GenericChunkPool {
+public:
+    //! Constructor.
+    /*! \param blockSize Size of the pooled blocks in bytes.
+        \param threadCacheSize Maximum number of blocks cached by each thread, 0 to use the shared list only.
+        \param baseAllocator The allocator for allocating blocks.
+    */
+    explicit GenericChunkPool(size_t blockSize = kDefaultBlockSize, size_t threadCacheSize = kDefaultThreadCacheSize, BaseAllocator* baseAllocator = 0) :
+        blockSize_(RAPIDJSON_ALIGN(blockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : blockSize)), threadCacheSize_(threadCacheSize),
+        baseAllocator_(baseAllocator), ownBaseAllocator_(0), shared_(0), bytesInUse_(0), peakBytesInUse_(0), bytesCached_(0), isDefault_(false)
+    {
+        if (!baseAllocator_)
+            ownBaseAllocator_ = baseAllocator_ = RAPIDJSON_NEW(BaseAllocator)();
+    }
+
+    //! Destructor.
+    /*! Frees the blocks in the shared list and in the cache of the calling thread.
+        Blocks still in use are not freed.
+    */
+    ~GenericChunkPool() {
+        // Default() is destroyed at exit, after the thread caches of the exiting thread.
+        if (!isDefault_) {
+            ThreadCache& cache = GetThreadCache();
+            if (cache.pool == this)
+                Flush(cache);
+        }
+        FreeShared();
+        RAPIDJSON_DELETE(ownBaseAllocator_);
+    }
+
+    //! The pool used by default by PooledAllocator.
+    static GenericChunkPool& Default() {
+        static GenericChunkPool pool((DefaultTag()));
+        return pool;
+    }
+
+    //! Size of the pooled blocks in bytes.
+    size_t GetBlockSize() const { return blockSize_; }
+
+    //! Acquire a block of at least \c size bytes.
+    /*! \return The block, or null if the base allocator failed.
+    */
+    void* Acquire(size_t size) {
+        if (size > blockSize_)
+            return Track(baseAllocator_->Malloc(size), size);
+
+        FreeBlock* block = 0;
+        ThreadCache& cache = GetThreadCache();
+        if (cache.count == 0)
+            cache.pool = this;
+        if (threadCacheSize_ > 0 && cache.pool == this) {
+            if (cache.count == 0)
+                Refill(cache);
+            if ((block = cache.head) != 0) {
+                cache.head = block->next;
+                --cache.count;
+            }
+        }
+        else if ((block = shared_.exchange(0, std::memory_order_acquire)) != 0) {
+            if (FreeBlock* rest = block->next)
+                ReturnShared(rest);
+        }
+
+        if (!block)
+            return Track(baseAllocator_->Malloc(blockSize_), blockSize_);
+        bytesCached_.fetch_sub(blockSize_, std::memory_order_relaxed);
+        return Track(block, blockSize_);
+    }
+
+    //! Release a block acquired with the same \c size.
+    void Release(void* ptr, size_t size) {
+        if (!ptr)
+            return;
+        if (size > blockSize_) {
+            bytesInUse_.fetch_sub(size, std::memory_order_relaxed);
+            baseAllocator_->Free(ptr);
+            return;
+        }
+
+        bytesInUse_.fetch_sub(blockSize_, std::memory_order_relaxed);
+        bytesCached_.fetch_add(blockSize_, std::memory_order_relaxed);
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        ThreadCache& cache = GetThreadCache();
+        if (cache.count == 0)
+            cache.pool = this;
+        if (cache.pool == this && cache.count < threadCacheSize_) {
+            if (cache.count == 0)
+                cache.tail = block;
+            block->next = cache.head;
+            cache.head = block;
+            ++cache.count;
+        }
+        else {
+            block->next = 0;
+            PushShared(block, block);
+        }
+    }
+
+    //! Free the blocks in the shared list and in the cache of the calling thread.
+    /*! The caches of other threads are kept.
+    */
+    void Shrink() {
+        ThreadCache& cache = GetThreadCache();
+        if (cache.pool == this)
+            Flush(cache);
+        FreeShared();
+    }
+
+    //! Bytes of the blocks currently acquired.
+    size_t GetBytesInUse() const { return bytesInUse_.load(std::memory_order_relaxed); }
+
+    //! Highest value of GetBytesInUse() since construction or the last ResetPeak().
+    size_t GetPeakBytesInUse() const { return peakBytesInUse_.load(std::memory_order_relaxed); }
+
+    //! Bytes of the released blocks kept for reuse, in the shared list and the thread caches.
+    size_t GetBytesCached() const { return bytesCached_.load(std::memory_order_relaxed); }
+
+    //! Restart peak tracking from the bytes currently in use.
+    void ResetPeak() { peakBytesInUse_.store(GetBytesInUse(), std::memory_order_relaxed); }
+
+    static const size_t kDefaultBlockSize = RAPIDJSON_ALLOCATOR_DEFAULT_CHUNK_CAPACITY;    //!< Default block size.
+    static const size_t kDefaultThreadCacheSize = 8;    //!< Default number of blocks cached per thread.
+
+private:
+    //! Copy constructor is not permitted.
+    GenericChunkPool(const GenericChunkPool&) /* = delete */;
+    //! Copy assignment operator is not permitted.
+    GenericChunkPool& operator=(const GenericChunkPool&) /* = delete */;
+
+    //! Tag of the constructor of Default().
+    struct DefaultTag {};
+    explicit GenericChunkPool(DefaultTag) : GenericChunkPool() { isDefault_ = true; }
+
+    //! Link of a released block, stored in the block itself.
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    //! Released blocks of a thread.
+    struct ThreadCache {
+        ThreadCache() : pool(0), head(0), tail(0), count(0) {}
+        ~ThreadCache() {
+            if (pool)
+                pool->Flush(*this);
+        }
+
+        GenericChunkPool* pool; //!< Pool of the cached blocks.
+        FreeBlock* head;
+        FreeBlock* tail;        //!< Last block, valid if count > 0.
+        size_t count;
+    };
+
+    static ThreadCache& GetThreadCache() {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+
+    void* Track(void* ptr, size_t size) {
+        if (!ptr)
+            return 0;
+        const size_t inUse = bytesInUse_.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = peakBytesInUse_.load(std::memory_order_relaxed);
+        while (inUse > peak && !peakBytesInUse_.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+            ;
+        return ptr;
+    }
+
+    //! Move up to threadCacheSize_ blocks from the shared list to an empty cache.
+    void Refill(ThreadCache& cache) {
+        FreeBlock* list = shared_.exchange(0, std::memory_order_acquire);
+        if (!list)
+            return;
+        FreeBlock* last = list;
+        size_t count = 1;
+        for (; count < threadCacheSize_ && last->next; count++)
+            last = last->next;
+        if (FreeBlock* rest = last->next) {
+            last->next = 0;
+            ReturnShared(rest);
+        }
+        cache.head = list;
+        cache.tail = last;
+        cache.count = count;
+    }
+
+    //! Move all the blocks of a cache to the shared list.
+    void Flush(ThreadCache& cache) {
+        if (cache.head)
+            PushShared(cache.head, cache.tail);
+        cache.head = 0;
+        cache.tail = 0;
+        cache.count = 0;
+    }
+
+    //! Push a null-terminated list of blocks, ending with \c last, to the shared list.
+    void PushShared(FreeBlock* list, FreeBlock* last) {
+        FreeBlock* head = shared_.load(std::memory_order_relaxed);
+        do {
+            last->next = head;
+        } while (!shared_.compare_exchange_weak(head, list, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    //! Put back the rest of the shared list after taking blocks from it.
+    /*! The shared list is usually still empty, then \c list becomes it without walking to its end.
+        Otherwise the blocks pushed in the meantime, which are few, are taken and linked in front of it.
+    */
+    void ReturnShared(FreeBlock* list) {
+        FreeBlock* head = 0;
+        while (!shared_.compare_exchange_weak(head, list, std::memory_order_release, std::memory_order_relaxed)) {
+            if (!head)
+                continue;
+            if (FreeBlock* pushed = shared_.exchange(0, std::memory_order_acquire)) {
+                FreeBlock* last = pushed;
+                while (last->next)
+                    last = last->next;
+                last->next = list;
+                list = pushed;
+            }
+            head = 0;
+        }
+    }
+
+    //! Free the blocks in the shared list.
+    void FreeShared() {
+        FreeBlock* block = shared_.exchange(0, std::memory_order_acquire);
+        while (block) {
+            FreeBlock* next = block->next;
+            bytesCached_.fetch_sub(blockSize_, std::memory_order_relaxed);
+            baseAllocator_->Free(block);
+            block = next;
+        }
+    }
+
+    const size_t blockSize_;
+    const size_t threadCacheSize_;
+    BaseAllocator* baseAllocator_;      //!< base allocator for allocating blocks.
+    BaseAllocator* ownBaseAllocator_;   //!< base allocator created by this object.
+    std::atomic<FreeBlock*> shared_;    //!< Head of the shared list of released blocks.
+    std::atomic<size_t> bytesInUse_;
+    std::atomic<size_t> peakBytesInUse_;
+    std::atomic<size_t> bytesCached_;
+    bool isDefault_;                    //!< Whether this is Default(), whose destructor must not use the thread cache.
+};
+
+typedef GenericChunkPool<CrtAllocator> ChunkPool;
+
+///////////////////////////////////////////////////////////////////////////////
+// PooledAllocator
+
+//! Memory pool allocator taking its chunks from a GenericChunkPool.
+/*! Allocates like MemoryPoolAllocator, but Clear() and the destructor release
+    the chunks to the pool instead of freeing them. Short-lived documents, e.g.
+    one per message, then reuse the chunks of the previous ones, mostly from the
+    cache of their thread, instead of going to the system allocator.
+
+    An allocator instance is not thread-safe, the pool is: allocators of
+    different threads may share the same pool.
+
+    \tparam BaseAllocator the allocator type of the pool. Default is CrtAllocator.
+    \note implements Allocator concept
+*/
+template <typename BaseAllocator = CrtAllocator>
+class PooledAllocator {
+public:
+    static const bool kNeedFree = false;    //!< Tell users that no need to call Free() with this allocator. (concept Allocator)
+
+    typedef GenericChunkPool<BaseAllocator> PoolType;
+
+    //! Constructor.
+    /*! \param pool The pool of chunks, which must outlive the allocator. Null for PoolType::Default().
+    */
+    explicit PooledAllocator(PoolType* pool = 0) : chunkHead_(0), pool_(pool ? pool : &PoolType::Default()) {}
+
+    //! Destructor.
+    /*! This releases all memory chunks to the pool.
+    */
+    ~PooledAllocator() {
+        Clear();
+    }
+
+    //! Releases all memory chunks to the pool.
+    void Clear() {
+        while (chunkHead_) {
+            ChunkHeader* next = chunkHead_->next;
+            pool_->Release(chunkHead_, RAPIDJSON_ALIGN(sizeof(ChunkHeader)) + chunkHead_->capacity);
+            chunkHead_ = next;
+        }
+    }
+
+    //! Computes the total capacity of allocated memory chunks.
+    /*! \return total capacity in bytes.
+    */
+    size_t Capacity() const {
+        size_t capacity = 0;
+        for (ChunkHeader* c = chunkHead_; c != 0; c = c->next)
+            capacity += c->capacity;
+        return capacity;
+    }
+
+    //! Computes the memory blocks allocated.
+    /*! \return total used bytes.
+    */
+    size_t Size() const {
+        size_t size = 0;
+        for (ChunkHeader* c = chunkHead_; c != 0; c = c->next)
+            size += c->size;
+        return size;
+    }
+
+    //! Get the pool of chunks.
+    PoolType& GetPool() const { return *pool_; }
+
+    //! Allocates a memory block. (concept Allocator)
+    void* Malloc(size_t size) {
+        if (!size)
+            return NULL;
+
+        size = RAPIDJSON_ALIGN(size);
+        if (chunkHead_ == 0 || chunkHead_->size + size > chunkHead_->capacity)
+            if (!AddChunk(size))
+                return NULL;
+
+        void *buffer = reinterpret_cast<char *>(chunkHead_) + RAPIDJSON_ALIGN(sizeof(ChunkHeader)) + chunkHead_->size;
+        chunkHead_->size += size;
+        return buffer;
+    }
+
+    //! Resizes a memory block (concept Allocator)
+    void* Realloc(void* originalPtr, size_t originalSize, size_t newSize) {
+        if (originalPtr == 0)
+            return Malloc(newSize);
+
+        if (newSize == 0)
+            return NULL;
+
+        originalSize = RAPIDJSON_ALIGN(originalSize);
+        newSize = RAPIDJSON_ALIGN(newSize);
+
+        // Do not shrink if new size is smaller than original
+        if (originalSize >= newSize)
+            return originalPtr;
+
+        // Simply expand it if it is the last allocation and there is sufficient space
+        if (originalPtr == reinterpret_cast<char *>(chunkHead_) + RAPIDJSON_ALIGN(sizeof(ChunkHeader)) + chunkHead_->size - originalSize) {
+            size_t increment = static_cast<size_t>(newSize - originalSize);
+            if (chunkHead_->size + increment <= chunkHead_->capacity) {
+                chunkHead_->size += increment;
+                return originalPtr;
+            }
+        }
+
+        // Realloc process: allocate and copy memory, do not free original buffer.
+        if (void* newBuffer = Malloc(newSize)) {
+            if (originalSize)
+                std::memcpy(newBuffer, originalPtr, originalSize);
+            return newBuffer;
+        }
+        else
+            return NULL;
+    }
+
+    //! Frees a memory block (concept Allocator)
+    static void Free(void *ptr) { (void)ptr; } // Do nothing
+
+private:
+    //! Copy constructor is not permitted.
+    PooledAllocator(const PooledAllocator& rhs) /* = delete */;
+    //! Copy assignment operator is not permitted.
+    PooledAllocator& operator=(const PooledAllocator& rhs) /* = delete */;
+
+    //! Acquires a new chunk from the pool.
+    /*! A chunk fills a block of the pool, unless \c size does not fit in one.
+        \param size Minimum capacity of the chunk in bytes.
+        \return true if success.
+    */
+    bool AddChunk(size_t size) {
+        size_t blockSize = RAPIDJSON_ALIGN(sizeof(ChunkHeader)) + size;
+        if (blockSize < pool_->GetBlockSize())
+            blockSize = pool_->GetBlockSize();
+        if (ChunkHeader* chunk = static_cast<ChunkHeader*>(pool_->Acquire(blockSize))) {
+            chunk->capacity = blockSize - RAPIDJSON_ALIGN(sizeof(ChunkHeader));
+            chunk->size = 0;
+            chunk->next = chunkHead_;
+            chunkHead_ = chunk;
+            return true;
+        }
+        else
+            return false;
+    }
+
+    //! Chunk header for perpending to each chunk.
+    /*! Chunks are stored as a singly linked list.
+    */
+    struct ChunkHeader {
+        size_t capacity;    //!< Capacity of the chunk in bytes (excluding the header itself).
+        size_t size;        //!< Current size of allocated memory in bytes.
+        ChunkHeader *next;  //!< Next chunk in the linked list.
+    };
+
+    ChunkHeader *chunkHead_;    //!< Head of the chunk linked-list. Only the head chunk serves allocation.
+    PoolType* pool_;            //!< Pool of the chunks.
+};
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_POOLEDALLOCATOR_H_
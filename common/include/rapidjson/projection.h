@@ -0,0 +1,546 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_PROJECTION_H_
+#define RAPIDJSON_PROJECTION_H_
+
+/*! \file projection.h */
+
+#include "pointer.h"
+#include <cstring>
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(padded)
+#elif defined(_MSC_VER)
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(4127) // conditional expression is constant
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+namespace internal {
+
+//! Token of a pointer added to a GenericProjection.
+struct ProjectionNode {
+    SizeType name;      //!< Offset of the name in the name buffer.
+    SizeType length;    //!< Length of the name.
+    SizeType index;     //!< Array index of the token, kPointerInvalidIndex if the name is not an index.
+    SizeType child;     //!< First child, 0 if none (the root is never a child).
+    SizeType next;      //!< Next sibling, 0 if none.
+    SizeType elements;  //!< 1 + highest array index of the children, 0 if none.
+    bool selected;      //!< Whether the whole value is selected by a pointer.
+};
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericProjection
+
+//! Parser building only the values selected by a set of JSON Pointers.
+/*! The pointers are merged into a tree when they are added, so the projection
+    can be reused for any number of documents, also concurrently if the
+    allocator is thread-safe.
+
+    Parsing sends the SAX events of a reduced document to the handler:
+
+    - A selected value is parsed completely by GenericReader.
+    - An object on the way to a selected value only has the members leading
+      to it, in the order of the text.
+    - An array on the way to a selected value has its elements up to the last
+      selected index, with null in place of the elements which are not selected,
+      so that array indices are preserved.
+    - A number, string or literal found where a pointer expects an object or
+      array is replaced by null.
+
+    So GenericPointer::Get() returns the same value for every selected pointer
+    in the projected document as in the fully parsed one.
+
+    All other values are skipped by matching brackets and quotes, without
+    decoding strings or numbers. For a GenericStringStream or
+    GenericInsituStringStream of UTF-8, this runs 64 bytes at a time with SSE2
+    and later. Skipped values are not validated beyond matching brackets (of any
+    kind) and terminated strings, so errors within them are not reported.
+
+    \code
+    const Pointer pointers[] = { Pointer("/meta/id"), Pointer("/items/0/name") };
+    Projection projection(pointers, 2);
+    Document d;
+    ParseResult ok = projection.Parse(json, d);
+    \endcode
+
+    \tparam Encoding Encoding of the pointers and of the events.
+    \tparam Allocator Allocator of the tree and of the parser stack.
+    \note \ref kParseCommentsFlag is not supported.
+*/
+template <typename Encoding, typename Allocator = CrtAllocator>
+class GenericProjection {
+public:
+    typedef typename Encoding::Ch Ch;   //!< Character type derived from Encoding.
+
+    //! Constructor of an empty projection, which selects nothing but the type of the root.
+    /*! \param allocator Optional allocator of the tree and of the parser stack.
+    */
+    GenericProjection(Allocator* allocator = 0) :
+        allocator_(allocator), nodes_(allocator, kDefaultNodeCapacity * sizeof(Node)), names_(allocator, kDefaultNameCapacity)
+    {
+        AddNode();
+    }
+
+    //! Constructor from an array of pointers.
+    /*! \param pointers Pointers to select, must be valid.
+        \param count Number of pointers.
+        \param allocator Optional allocator of the tree and of the parser stack.
+    */
+    template <typename ValueType, typename PointerAllocator>
+    GenericProjection(const GenericPointer<ValueType, PointerAllocator>* pointers, size_t count, Allocator* allocator = 0) :
+        allocator_(allocator), nodes_(allocator, kDefaultNodeCapacity * sizeof(Node)), names_(allocator, kDefaultNameCapacity)
+    {
+        AddNode();
+        for (size_t i = 0; i < count; i++)
+            Add(pointers[i]);
+    }
+
+    //! Select the value of a pointer.
+    /*! \param pointer Pointer to select, must be valid.
+        \return The projection itself for fluent API.
+    */
+    template <typename ValueType, typename PointerAllocator>
+    GenericProjection& Add(const GenericPointer<ValueType, PointerAllocator>& pointer) {
+        RAPIDJSON_STATIC_ASSERT((internal::IsSame<typename ValueType::Ch, Ch>::Value));
+        RAPIDJSON_ASSERT(pointer.IsValid());
+        SizeType node = 0;
+        const typename GenericPointer<ValueType, PointerAllocator>::Token* t = pointer.GetTokens();
+        for (size_t i = 0; i < pointer.GetTokenCount(); i++, t++) {
+            SizeType child = FindChild(node, t->name, t->length);
+            if (child == 0) {
+                child = AddNode();
+                Node& n = GetNode(child);
+                n.name = static_cast<SizeType>(names_.GetSize() / sizeof(Ch));
+                n.length = t->length;
+                n.index = t->index;
+                if (t->length) // "/" has an empty name
+                    std::memcpy(names_.template Push<Ch>(t->length), t->name, t->length * sizeof(Ch));
+                n.next = GetNode(node).child;
+                GetNode(node).child = child;
+                if (t->index != kPointerInvalidIndex && t->index >= GetNode(node).elements)
+                    GetNode(node).elements = t->index + 1;
+            }
+            node = child;
+        }
+        GetNode(node).selected = true;
+        return *this;
+    }
+
+    //!@name Parse to a handler
+    //!@{
+
+    //! Parse JSON text from an input stream, sending the events of the selected values.
+    /*! \tparam parseFlags Combination of \ref ParseFlag.
+        \tparam SourceEncoding Encoding of input stream
+        \tparam InputStream Type of input stream, implementing Stream concept
+        \tparam Handler Type of handler, implementing Handler concept.
+        \param is Input stream to be parsed.
+        \param handler The handler to receive events.
+        \return Whether the parsing is successful.
+    */
+    template <unsigned parseFlags, typename SourceEncoding, typename InputStream, typename Handler>
+    ParseResult Parse(InputStream& is, Handler& handler) const {
+        RAPIDJSON_ASSERT(!(parseFlags & kParseCommentsFlag));
+        GenericReader<SourceEncoding, Encoding, Allocator> reader(allocator_);
+        if (GetNode(0).selected)
+            return reader.template Parse<parseFlags>(is, handler);
+
+        ParseResult result;
+        SkipWhitespace(is);
+        if (RAPIDJSON_UNLIKELY(is.Peek() == '\0'))
+            result.Set(kParseErrorDocumentEmpty, is.Tell());
+        else if (ParseValue<parseFlags>(reader, is, handler, 0, result) && !(parseFlags & kParseStopWhenDoneFlag)) {
+            SkipWhitespace(is);
+            if (RAPIDJSON_UNLIKELY(is.Peek() != '\0'))
+                result.Set(kParseErrorDocumentRootNotSingular, is.Tell());
+        }
+        return result;
+    }
+
+    //! Parse JSON text from an input stream of the same encoding, sending the events of the selected values.
+    template <unsigned parseFlags, typename InputStream, typename Handler>
+    ParseResult Parse(InputStream& is, Handler& handler) const {
+        return Parse<parseFlags, Encoding>(is, handler);
+    }
+    //!@}
+
+    //!@name Parse to a document
+    //!@{
+
+    //! Parse JSON text from an input stream into a document holding the selected values.
+    /*! The document is populated as by GenericDocument::Populate(): it is only
+        changed if parsing succeeds, and its own parse result is not changed.
+        \tparam parseFlags Combination of \ref ParseFlag.
+        \tparam SourceEncoding Encoding of input stream
+        \tparam InputStream Type of input stream, implementing Stream concept
+        \param is Input stream to be parsed.
+        \param document Document receiving the selected values.
+        \return Whether the parsing is successful.
+    */
+    template <unsigned parseFlags, typename SourceEncoding, typename InputStream, typename DocumentAllocator, typename DocumentStackAllocator>
+    ParseResult ParseStream(InputStream& is, GenericDocument<Encoding, DocumentAllocator, DocumentStackAllocator>& document) const {
+        Generator<parseFlags, SourceEncoding, InputStream> g(*this, is);
+        document.Populate(g);
+        return g.result;
+    }
+
+    //! Parse JSON text from an input stream of the same encoding into a document holding the selected values.
+    template <unsigned parseFlags, typename InputStream, typename DocumentAllocator, typename DocumentStackAllocator>
+    ParseResult ParseStream(InputStream& is, GenericDocument<Encoding, DocumentAllocator, DocumentStackAllocator>& document) const {
+        return ParseStream<parseFlags, Encoding>(is, document);
+    }
+
+    //! Parse JSON text from a read-only string into a document holding the selected values.
+    /*! \tparam parseFlags Combination of \ref ParseFlag (must not contain \ref kParseInsituFlag).
+        \param str Read-only zero-terminated string to be parsed.
+        \param document Document receiving the selected values.
+    */
+    template <unsigned parseFlags, typename DocumentAllocator, typename DocumentStackAllocator>
+    ParseResult Parse(const Ch* str, GenericDocument<Encoding, DocumentAllocator, DocumentStackAllocator>& document) const {
+        RAPIDJSON_ASSERT(!(parseFlags & kParseInsituFlag));
+        GenericStringStream<Encoding> s(str);
+        return ParseStream<parseFlags, Encoding>(s, document);
+    }
+
+    //! Parse JSON text from a read-only string into a document holding the selected values (with \ref kParseDefaultFlags)
+    template <typename DocumentAllocator, typename DocumentStackAllocator>
+    ParseResult Parse(const Ch* str, GenericDocument<Encoding, DocumentAllocator, DocumentStackAllocator>& document) const {
+        return Parse<kParseDefaultFlags>(str, document);
+    }
+    //!@}
+
+private:
+    typedef internal::ProjectionNode Node;
+    static const size_t kDefaultNodeCapacity = 16;
+    static const size_t kDefaultNameCapacity = 256;
+
+    // Prohibit copying
+    GenericProjection(const GenericProjection&);
+    GenericProjection& operator=(const GenericProjection&);
+
+    //! Generator for GenericDocument::Populate().
+    template <unsigned parseFlags, typename SourceEncoding, typename InputStream>
+    struct Generator {
+        Generator(const GenericProjection& p, InputStream& s) : projection(p), is(s), result() {}
+
+        template <typename Handler>
+        bool operator()(Handler& handler) {
+            result = projection.template Parse<parseFlags, SourceEncoding>(is, handler);
+            return !result.IsError();
+        }
+
+        const GenericProjection& projection;
+        InputStream& is;
+        ParseResult result;
+    };
+
+    //! Receives a member name, parsed by the reader as a string value.
+    template <typename Handler>
+    struct NameMatcher : BaseReaderHandler<Encoding, NameMatcher<Handler> > {
+        NameMatcher(const GenericProjection& p, SizeType n, Handler& h) : projection(p), node(n), handler(h) {}
+
+        bool String(const Ch* str, SizeType length, bool copy) {
+            node = projection.FindChild(node, str, length);
+            return node == 0 || handler.Key(str, length, copy);
+        }
+
+        const GenericProjection& projection;
+        SizeType node;      //!< Parent on input, matching child (or 0) on output.
+        Handler& handler;
+    };
+
+    SizeType AddNode() {
+        const SizeType n = static_cast<SizeType>(nodes_.GetSize() / sizeof(Node));
+        Node* node = nodes_.template Push<Node>();
+        node->name = node->length = node->child = node->next = node->elements = 0;
+        node->index = kPointerInvalidIndex;
+        node->selected = false;
+        return n;
+    }
+
+    Node& GetNode(SizeType n) { return nodes_.template Bottom<Node>()[n]; }
+    const Node& GetNode(SizeType n) const { return nodes_.template Bottom<Node>()[n]; }
+
+    SizeType FindChild(SizeType node, const Ch* name, SizeType length) const {
+        for (SizeType c = GetNode(node).child; c != 0; c = GetNode(c).next) {
+            const Node& n = GetNode(c);
+            if (n.length == length && (length == 0 || std::memcmp(names_.template Bottom<Ch>() + n.name, name, length * sizeof(Ch)) == 0))
+                return c;
+        }
+        return 0;
+    }
+
+    SizeType FindIndex(SizeType node, SizeType index) const {
+        for (SizeType c = GetNode(node).child; c != 0; c = GetNode(c).next)
+            if (GetNode(c).index == index)
+                return c;
+        return 0;
+    }
+
+    // Values are parsed by the reader one at a time from the same stream, so error offsets are those of the whole text.
+    // Structural index parsing would index the rest of the input every time.
+    template <unsigned parseFlags, typename Reader, typename InputStream, typename Handler>
+    bool ParseValue(Reader& reader, InputStream& is, Handler& handler, SizeType node, ParseResult& result) const {
+        if (GetNode(node).selected) {
+            result = reader.template Parse<(parseFlags | kParseStopWhenDoneFlag) & ~static_cast<unsigned>(kParseStructuralIndexFlag)>(is, handler);
+            return !result.IsError();
+        }
+
+        switch (is.Peek()) {
+            case '{': return ParseObject<parseFlags>(reader, is, handler, node, result);
+            case '[': return ParseArray<parseFlags>(reader, is, handler, node, result);
+            default:
+                if (!SkipValue(is, result))
+                    return false;
+                if (RAPIDJSON_UNLIKELY(!handler.Null()))
+                    return Terminate(is, result);
+                return true;
+        }
+    }
+
+    template <unsigned parseFlags, typename Reader, typename InputStream, typename Handler>
+    bool ParseObject(Reader& reader, InputStream& is, Handler& handler, SizeType node, ParseResult& result) const {
+        is.Take();  // Skip '{'
+        if (RAPIDJSON_UNLIKELY(!handler.StartObject()))
+            return Terminate(is, result);
+
+        SkipWhitespace(is);
+        SizeType memberCount = 0;
+        if (is.Peek() != '}') {
+            for (;;) {
+                if (RAPIDJSON_UNLIKELY(is.Peek() != '"'))
+                    return Error(kParseErrorObjectMissName, is, result);
+
+                NameMatcher<Handler> name(*this, node, handler);
+                result = reader.template Parse<(parseFlags | kParseStopWhenDoneFlag) & ~static_cast<unsigned>(kParseStructuralIndexFlag | kParseIterativeFlag)>(is, name);
+                if (RAPIDJSON_UNLIKELY(result.IsError()))
+                    return false;
+
+                SkipWhitespace(is);
+                if (RAPIDJSON_UNLIKELY(is.Peek() != ':'))
+                    return Error(kParseErrorObjectMissColon, is, result);
+                is.Take();
+                SkipWhitespace(is);
+                if (RAPIDJSON_UNLIKELY(is.Peek() == '\0'))
+                    return Error(kParseErrorValueInvalid, is, result);
+
+                if (name.node != 0) {
+                    if (!ParseValue<parseFlags>(reader, is, handler, name.node, result))
+                        return false;
+                    memberCount++;
+                }
+                else if (!SkipValue(is, result))
+                    return false;
+
+                SkipWhitespace(is);
+                if (is.Peek() == ',') {
+                    is.Take();
+                    SkipWhitespace(is);
+                    if ((parseFlags & kParseTrailingCommasFlag) && is.Peek() == '}')
+                        break;
+                }
+                else if (is.Peek() == '}')
+                    break;
+                else
+                    return Error(kParseErrorObjectMissCommaOrCurlyBracket, is, result);
+            }
+        }
+        is.Take();  // Skip '}'
+
+        if (RAPIDJSON_UNLIKELY(!handler.EndObject(memberCount)))
+            return Terminate(is, result);
+        return true;
+    }
+
+    template <unsigned parseFlags, typename Reader, typename InputStream, typename Handler>
+    bool ParseArray(Reader& reader, InputStream& is, Handler& handler, SizeType node, ParseResult& result) const {
+        is.Take();  // Skip '['
+        if (RAPIDJSON_UNLIKELY(!handler.StartArray()))
+            return Terminate(is, result);
+
+        const SizeType elements = GetNode(node).elements;
+        SkipWhitespace(is);
+        SizeType elementCount = 0;
+        if (is.Peek() != ']') {
+            for (;;) {
+                // The elements after the last selected one are skipped altogether.
+                if (elementCount == elements) {
+                    if (!SkipNested(is, 1, '[', result))
+                        return false;
+                    break;
+                }
+                if (RAPIDJSON_UNLIKELY(is.Peek() == '\0'))
+                    return Error(kParseErrorValueInvalid, is, result);
+
+                // An element which is not selected is skipped and replaced by null.
+                const SizeType child = FindIndex(node, elementCount);
+                if (child != 0) {
+                    if (!ParseValue<parseFlags>(reader, is, handler, child, result))
+                        return false;
+                }
+                else {
+                    if (!SkipValue(is, result))
+                        return false;
+                    if (RAPIDJSON_UNLIKELY(!handler.Null()))
+                        return Terminate(is, result);
+                }
+                elementCount++;
+
+                SkipWhitespace(is);
+                if (is.Peek() == ',') {
+                    is.Take();
+                    SkipWhitespace(is);
+                    if ((parseFlags & kParseTrailingCommasFlag) && is.Peek() == ']') {
+                        is.Take();
+                        break;
+                    }
+                }
+                else if (is.Peek() == ']') {
+                    is.Take();
+                    break;
+                }
+                else
+                    return Error(kParseErrorArrayMissCommaOrSquareBracket, is, result);
+            }
+        }
+        else
+            is.Take();
+
+        if (RAPIDJSON_UNLIKELY(!handler.EndArray(elementCount)))
+            return Terminate(is, result);
+        return true;
+    }
+
+    template <typename InputStream>
+    static bool Error(ParseErrorCode code, InputStream& is, ParseResult& result) {
+        result.Set(code, is.Tell());
+        return false;
+    }
+
+    template <typename InputStream>
+    static bool Terminate(InputStream& is, ParseResult& result) {
+        return Error(kParseErrorTermination, is, result);
+    }
+
+    //! Skip a value starting at the current position.
+    template <typename InputStream>
+    static bool SkipValue(InputStream& is, ParseResult& result) {
+        const typename InputStream::Ch c = is.Peek();
+        if (c == '"')
+            return SkipNested(is, 0, '"', result);
+        if (c == '{' || c == '[') {
+            is.Take();
+            return SkipNested(is, 1, static_cast<unsigned>(c), result);
+        }
+
+        // Number or literal
+        const size_t start = is.Tell();
+        for (;;) {
+            const typename InputStream::Ch s = is.Peek();
+            if ((s >= '0' && s <= '9') || (s >= 'a' && s <= 'z') || (s >= 'A' && s <= 'Z') || s == '-' || s == '+' || s == '.')
+                is.Take();
+            else
+                break;
+        }
+        if (RAPIDJSON_UNLIKELY(is.Tell() == start))
+            return Error(kParseErrorValueInvalid, is, result);
+        return true;
+    }
+
+    //! Skip to the end of a string (depth 0, at the quote) or of an array or object (after \c depth opening brackets).
+    template <typename InputStream>
+    static bool SkipNested(InputStream& is, unsigned depth, unsigned open, ParseResult& result) {
+        if (depth == 0) {
+            is.Take();  // Skip '\"'
+            return SkipNested(is, 0, true, open, result);
+        }
+        return SkipNested(is, depth, false, open, result);
+    }
+
+#if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42) || defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+    static bool SkipNested(GenericStringStream<UTF8<char> >& is, unsigned depth, unsigned open, ParseResult& result) {
+        return SkipStructural(is, depth, open, result);
+    }
+
+    static bool SkipNested(GenericInsituStringStream<UTF8<char> >& is, unsigned depth, unsigned open, ParseResult& result) {
+        return SkipStructural(is, depth, open, result);
+    }
+
+    template <typename InputStream>
+    static bool SkipStructural(InputStream& is, unsigned depth, unsigned open, ParseResult& result) {
+        bool inString = false;
+        const char* p = internal::SkipStructuralValue(is.src_, depth, inString);
+        is.src_ += p - is.src_;
+        return (depth == 0 && !inString) || SkipNested(is, depth, inString, open, result);
+    }
+#endif
+
+    template <typename InputStream>
+    static bool SkipNested(InputStream& is, unsigned depth, bool inString, unsigned open, ParseResult& result) {
+        for (;;) {
+            const typename InputStream::Ch c = is.Peek();
+            if (RAPIDJSON_UNLIKELY(c == '\0'))
+                return Error(inString ? kParseErrorStringMissQuotationMark :
+                    open == '{' ? kParseErrorObjectMissCommaOrCurlyBracket : kParseErrorArrayMissCommaOrSquareBracket, is, result);
+            is.Take();
+            if (inString) {
+                if (c == '\\') {
+                    if (is.Peek() != '\0')
+                        is.Take();
+                }
+                else if (c == '"') {
+                    inString = false;
+                    if (depth == 0)
+                        return true;
+                }
+            }
+            else if (c == '"')
+                inString = true;
+            else if (c == '{' || c == '[')
+                depth++;
+            else if ((c == '}' || c == ']') && --depth == 0)
+                return true;
+        }
+    }
+
+    Allocator* allocator_;
+    internal::Stack<Allocator> nodes_;
+    internal::Stack<Allocator> names_;
+};
+
+//! GenericProjection with UTF8 encoding
+typedef GenericProjection<UTF8<> > Projection;
+
+RAPIDJSON_NAMESPACE_END
+
+#if defined(__clang__) || defined(_MSC_VER)
+RAPIDJSON_DIAG_POP
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_PROJECTION_H_
@@ -0,0 +1,579 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_PUSHREADER_H_
+#define RAPIDJSON_PUSHREADER_H_
+
+/*! \file pushreader.h
+    \brief Resumable SAX parser which is fed with partial buffers.
+*/
+
+#include "reader.h"
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(padded)
+RAPIDJSON_DIAG_OFF(switch-enum)
+#elif defined(_MSC_VER)
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(4512) // assignment operator could not be generated
+#endif
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+namespace internal {
+
+//! Forwards the string of a member name to Handler::Key().
+template <typename Encoding, typename Handler>
+struct PushReaderKeyHandler : BaseReaderHandler<Encoding, PushReaderKeyHandler<Encoding, Handler> > {
+    explicit PushReaderKeyHandler(Handler& handler) : handler_(handler) {}
+    bool String(const typename Encoding::Ch* str, SizeType length, bool copy) { return handler_.Key(str, length, copy); }
+    Handler& handler_;
+};
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericPushReader
+
+//! SAX-style JSON parser which is fed with partial buffers. Use \ref PushReader for UTF8 encoding and default allocator.
+/*! GenericReader pulls characters from a stream which must be able to supply
+    the whole text. GenericPushReader is instead pushed buffers as they arrive,
+    e.g. from a non-blocking socket. Feed() parses as much as possible and
+    returns at the end of the buffer, even inside a string or a number, and the
+    next Feed() resumes from there. Finish() marks the end of the input.
+
+    Events are sent to the handler as soon as they are complete, with the same
+    semantics as GenericReader. Only the token which spans a buffer boundary is
+    buffered, and the nesting of the open containers is kept in a stack, so
+    memory does not grow with the size of the text. Strings and numbers are
+    decoded by a GenericReader, so number conversion, transcoding and encoding
+    validation are identical.
+
+    \code
+    PushReader reader;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        if (!reader.Feed(buffer, n, handler))
+            break;
+    if (!reader.HasParseError())
+        reader.Finish(handler);
+    \endcode
+
+    Supported flags are \ref kParseValidateEncodingFlag, \ref kParseFullPrecisionFlag,
+    \ref kParseCommentsFlag, \ref kParseNumbersAsStringsFlag, \ref kParseTrailingCommasFlag,
+    \ref kParseNanAndInfFlag and \ref kParseStopWhenDoneFlag. The same flags must be
+    used for all calls until Reset(). With \ref kParseStopWhenDoneFlag, a root
+    value may be followed by another one, so that a stream of concatenated or
+    newline-delimited values can be fed.
+
+    Error offsets are counted in code units from the start of the first buffer.
+
+    \tparam SourceEncoding Encoding of the input buffers.
+    \tparam TargetEncoding Encoding of the parse output.
+    \tparam StackAllocator Allocator type for stack.
+*/
+template <typename SourceEncoding, typename TargetEncoding, typename StackAllocator = CrtAllocator>
+class GenericPushReader {
+public:
+    typedef typename SourceEncoding::Ch Ch; //!< SourceEncoding character type
+
+    //! Constructor.
+    /*! \param stackAllocator Optional allocator for allocating stack memory.
+        \param stackCapacity stack capacity in bytes for storing a single token.
+    */
+    GenericPushReader(StackAllocator* stackAllocator = 0, size_t stackCapacity = kDefaultStackCapacity) :
+        reader_(stackAllocator, stackCapacity), stack_(stackAllocator, 0), token_(stackAllocator, stackCapacity),
+        parseResult_(), offset_(), tokenOffset_(), literal_(), literalLength_(), state_(kRootState), commentReturnState_(kRootState), escape_(), key_(), root_() {}
+
+    //! Parse a partial buffer.
+    /*! \tparam parseFlags Combination of \ref ParseFlag.
+        \tparam Handler Type of handler, implementing Handler concept.
+        \param buffer Next part of the text. It does not need to be null-terminated.
+        \param length Length of the buffer in code units.
+        \param handler The handler to receive events.
+        \return Whether no error has occurred so far.
+    */
+    template <unsigned parseFlags, typename Handler>
+    bool Feed(const Ch* buffer, size_t length, Handler& handler) {
+        if (HasParseError())
+            return false;
+
+        const Ch* p = buffer;
+        const Ch* end = buffer + length;
+        while (p != end) {
+            switch (state_) {
+            case kStringState:
+                p = ContinueString<parseFlags>(p, end, handler);
+                break;
+
+            case kNumberState:
+                p = ContinueNumber<parseFlags>(p, end, handler);
+                break;
+
+            case kLiteralState:
+                p = ContinueLiteral<parseFlags>(buffer, p, end, handler);
+                break;
+
+            case kCommentState:
+                if (*p == '*')
+                    state_ = kBlockCommentState;
+                else if (*p == '/')
+                    state_ = kLineCommentState;
+                else {
+                    SetParseError(kParseErrorUnspecificSyntaxError, Offset(buffer, p));
+                    return false;
+                }
+                ++p;
+                break;
+
+            case kBlockCommentState:
+            case kBlockCommentStarState:
+                for (; p != end; ++p) {
+                    if (*p == '/' && state_ == kBlockCommentStarState) {
+                        state_ = commentReturnState_;
+                        ++p;
+                        break;
+                    }
+                    state_ = *p == '*' ? kBlockCommentStarState : kBlockCommentState;
+                }
+                break;
+
+            case kLineCommentState:
+                for (; p != end; ++p) {
+                    if (*p == '\n') {
+                        state_ = commentReturnState_;
+                        ++p;
+                        break;
+                    }
+                }
+                break;
+
+            default:
+                p = Structural<parseFlags>(buffer, p, end, handler);
+                break;
+            }
+
+            if (!p)
+                return false;
+        }
+
+        offset_ += length;
+        return true;
+    }
+
+    //! Parse a partial buffer (with \ref kParseDefaultFlags)
+    template <typename Handler>
+    bool Feed(const Ch* buffer, size_t length, Handler& handler) {
+        return Feed<kParseDefaultFlags>(buffer, length, handler);
+    }
+
+    //! Mark the end of the input.
+    /*! A number at the end of the text is completed, and an incomplete text is reported as an error.
+        \tparam parseFlags Combination of \ref ParseFlag, the same as for Feed().
+        \tparam Handler Type of handler, implementing Handler concept.
+        \param handler The handler to receive events.
+        \return Whether the whole text has been parsed successfully.
+    */
+    template <unsigned parseFlags, typename Handler>
+    bool Finish(Handler& handler) {
+        if (HasParseError())
+            return false;
+
+        if (state_ == kNumberState || state_ == kStringState) { // An unterminated string is reported by GenericReader.
+            *token_.template Push<Ch>() = '\0';
+            if (!ParseToken<parseFlags>(token_.template Bottom<Ch>(), token_.GetSize() / sizeof(Ch) - 1, handler))
+                return false;
+        }
+        else if (state_ == kLineCommentState)
+            state_ = commentReturnState_;
+
+        ParseErrorCode code;
+        switch (state_) {
+        case kRootState:
+            code = root_ && (parseFlags & kParseStopWhenDoneFlag) ? kParseErrorNone : kParseErrorDocumentEmpty;
+            break;
+        case kDoneState:            code = kParseErrorNone; break;
+        case kCommentState:
+        case kBlockCommentState:
+        case kBlockCommentStarState:
+        case kLineCommentState:     code = kParseErrorUnspecificSyntaxError; break;
+        default:                    code = UnexpectedError(state_); break;
+        }
+        if (code != kParseErrorNone) {
+            SetParseError(code, offset_);
+            return false;
+        }
+        return true;
+    }
+
+    //! Mark the end of the input (with \ref kParseDefaultFlags)
+    template <typename Handler>
+    bool Finish(Handler& handler) {
+        return Finish<kParseDefaultFlags>(handler);
+    }
+
+    //! Prepare for parsing another text.
+    void Reset() {
+        stack_.Clear();
+        token_.Clear();
+        parseResult_.Clear();
+        offset_ = 0;
+        state_ = kRootState;
+        escape_ = key_ = root_ = false;
+    }
+
+    //! Whether a complete root value has been parsed and no token is pending.
+    bool IsComplete() const { return state_ == kDoneState || (state_ == kRootState && root_); }
+
+    //! Get the depth of currently open objects and arrays.
+    size_t GetDepth() const { return stack_.GetSize() / sizeof(Frame); }
+
+    //! Whether a parse error has occurred.
+    bool HasParseError() const { return parseResult_.IsError(); }
+
+    //! Get the \ref ParseErrorCode of the parse error.
+    ParseErrorCode GetParseErrorCode() const { return parseResult_.Code(); }
+
+    //! Get the position of the parse error in the whole input, 0 otherwise.
+    size_t GetErrorOffset() const { return parseResult_.Offset(); }
+
+private:
+    // Prohibit copy constructor & assignment operator.
+    GenericPushReader(const GenericPushReader&);
+    GenericPushReader& operator=(const GenericPushReader&);
+
+    enum State {
+        kRootState,             //!< Before a root value.
+        kDoneState,             //!< After the root value.
+        kValueState,            //!< After ':', or ',' in an array.
+        kElementOrEndState,     //!< After '['.
+        kNameOrEndState,        //!< After '{'.
+        kNameState,             //!< After ',' in an object.
+        kColonState,            //!< After a member name.
+        kCommaOrEndState,       //!< After a value in an object or an array.
+        kStringState,           //!< Inside a string, which is buffered in token_.
+        kNumberState,           //!< Inside a number, which is buffered in token_.
+        kLiteralState,          //!< Inside true, false or null.
+        kCommentState,          //!< After '/'.
+        kBlockCommentState,     //!< Inside a /* */ comment.
+        kBlockCommentStarState, //!< After '*' inside a /* */ comment.
+        kLineCommentState       //!< Inside a // comment.
+    };
+
+    //! An open object or array.
+    struct Frame {
+        SizeType count;         //!< Number of members or elements.
+        bool object;
+    };
+
+    size_t Offset(const Ch* buffer, const Ch* p) const { return offset_ + static_cast<size_t>(p - buffer); }
+
+    void SetParseError(ParseErrorCode code, size_t offset) { parseResult_.Set(code, offset); }
+
+    //! Error for an unexpected character (or the end of input) in a structural state.
+    ParseErrorCode UnexpectedError(State state) const {
+        switch (state) {
+        case kDoneState:        return kParseErrorDocumentRootNotSingular;
+        case kNameOrEndState:
+        case kNameState:        return kParseErrorObjectMissName;
+        case kColonState:       return kParseErrorObjectMissColon;
+        case kCommaOrEndState:  return stack_.template Top<Frame>()->object ? kParseErrorObjectMissCommaOrCurlyBracket : kParseErrorArrayMissCommaOrSquareBracket;
+        case kLiteralState:
+        default:                return kParseErrorValueInvalid;
+        }
+    }
+
+    //! Whether c can continue a number. The token is validated by GenericReader.
+    template <unsigned parseFlags>
+    static bool IsNumberChar(Ch c) {
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+            return true;
+        // NaN, Inf, Infinity
+        return (parseFlags & kParseNanAndInfFlag) && (c == 'N' || c == 'a' || c == 'I' || c == 'n' || c == 'f' || c == 'i' || c == 't' || c == 'y');
+    }
+
+    //! Parse whitespace, comments, brackets, commas, colons and the first character of values.
+    template <unsigned parseFlags, typename Handler>
+    const Ch* Structural(const Ch* buffer, const Ch* p, const Ch* end, Handler& handler) {
+        for (; p != end; ++p) {
+            const Ch c = *p;
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+                continue;
+
+            if ((parseFlags & kParseCommentsFlag) && c == '/') {
+                commentReturnState_ = state_;
+                state_ = kCommentState;
+                return p + 1;
+            }
+
+            switch (state_) {
+            case kRootState:
+            case kValueState:
+            case kElementOrEndState:
+                if (c == ']' && (state_ == kElementOrEndState || (state_ == kValueState && (parseFlags & kParseTrailingCommasFlag) && !stack_.template Top<Frame>()->object)))
+                    return EndContainer<parseFlags>(buffer, p, handler);
+                return StartValue<parseFlags>(buffer, p, end, handler);
+
+            case kNameOrEndState:
+            case kNameState:
+                if (c == '"') {
+                    key_ = true;
+                    return StartString<parseFlags>(buffer, p, end, handler);
+                }
+                if (c == '}' && (state_ == kNameOrEndState || (parseFlags & kParseTrailingCommasFlag)))
+                    return EndContainer<parseFlags>(buffer, p, handler);
+                break;
+
+            case kColonState:
+                if (c == ':') {
+                    state_ = kValueState;
+                    continue;
+                }
+                break;
+
+            case kCommaOrEndState:
+                if (c == ',') {
+                    state_ = stack_.template Top<Frame>()->object ? kNameState : kValueState;
+                    continue;
+                }
+                if (c == (stack_.template Top<Frame>()->object ? '}' : ']'))
+                    return EndContainer<parseFlags>(buffer, p, handler);
+                break;
+
+            default:
+                break;
+            }
+
+            SetParseError(UnexpectedError(state_), Offset(buffer, p));
+            return 0;
+        }
+        return p;
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    const Ch* StartValue(const Ch* buffer, const Ch* p, const Ch* end, Handler& handler) {
+        tokenOffset_ = Offset(buffer, p);
+        switch (*p) {
+        case '{':
+        case '[':
+            {
+                const bool object = *p == '{';
+                if (!(object ? handler.StartObject() : handler.StartArray())) {
+                    SetParseError(kParseErrorTermination, tokenOffset_ + 1);
+                    return 0;
+                }
+                Frame* f = stack_.template Push<Frame>();
+                f->count = 0;
+                f->object = object;
+                state_ = object ? kNameOrEndState : kElementOrEndState;
+                return p + 1;
+            }
+        case '"':
+            key_ = false;
+            return StartString<parseFlags>(buffer, p, end, handler);
+        case 'n': literal_ = "null"; break;
+        case 't': literal_ = "true"; break;
+        case 'f': literal_ = "false"; break;
+        default:
+            if ((*p >= '0' && *p <= '9') || *p == '-' || ((parseFlags & kParseNanAndInfFlag) && (*p == 'N' || *p == 'I'))) {
+                const Ch* q = p + 1;
+                while (q != end && IsNumberChar<parseFlags>(*q))
+                    ++q;
+                if (q != end) // The number is followed by a delimiter in this buffer, decode it in place.
+                    return ParseToken<parseFlags>(p, static_cast<size_t>(q - p), handler) ? q : 0;
+                Buffer(p, end);
+                state_ = kNumberState;
+                return end;
+            }
+            SetParseError(kParseErrorValueInvalid, tokenOffset_);
+            return 0;
+        }
+        literalLength_ = 1;
+        state_ = kLiteralState;
+        return ContinueLiteral<parseFlags>(buffer, p + 1, end, handler);
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    const Ch* StartString(const Ch* buffer, const Ch* p, const Ch* end, Handler& handler) {
+        tokenOffset_ = Offset(buffer, p);
+        escape_ = false;
+        const Ch* q = FindQuote(p + 1, end);
+        if (q != end) {
+            // The string is complete in this buffer, decode it in place. Validating or transcoding
+            // the encoding may read ahead of the closing quotation mark, so then decode a
+            // null-terminated copy.
+            if (!(parseFlags & kParseValidateEncodingFlag) && internal::IsSame<SourceEncoding, TargetEncoding>::Value)
+                return ParseToken<parseFlags>(p, static_cast<size_t>(q + 1 - p), handler) ? q + 1 : 0;
+            Buffer(p, q + 1);
+            *token_.template Push<Ch>() = '\0';
+            return ParseToken<parseFlags>(token_.template Bottom<Ch>(), token_.GetSize() / sizeof(Ch) - 1, handler) ? q + 1 : 0;
+        }
+        Buffer(p, end);
+        state_ = kStringState;
+        return end;
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    const Ch* ContinueString(const Ch* p, const Ch* end, Handler& handler) {
+        const Ch* q = FindQuote(p, end);
+        if (q == end) {
+            Buffer(p, end);
+            return end;
+        }
+        Buffer(p, q + 1);
+        *token_.template Push<Ch>() = '\0';
+        return ParseToken<parseFlags>(token_.template Bottom<Ch>(), token_.GetSize() / sizeof(Ch) - 1, handler) ? q + 1 : 0;
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    const Ch* ContinueNumber(const Ch* p, const Ch* end, Handler& handler) {
+        const Ch* q = p;
+        while (q != end && IsNumberChar<parseFlags>(*q))
+            ++q;
+        Buffer(p, q);
+        if (q == end)
+            return end;
+        *token_.template Push<Ch>() = '\0';
+        return ParseToken<parseFlags>(token_.template Bottom<Ch>(), token_.GetSize() / sizeof(Ch) - 1, handler) ? q : 0;
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    const Ch* ContinueLiteral(const Ch* buffer, const Ch* p, const Ch* end, Handler& handler) {
+        for (; literal_[literalLength_] != '\0'; ++literalLength_, ++p) {
+            if (p == end)
+                return end;
+            if (*p != static_cast<Ch>(literal_[literalLength_])) {
+                SetParseError(kParseErrorValueInvalid, Offset(buffer, p));
+                return 0;
+            }
+        }
+        if (!(literal_[0] == 'n' ? handler.Null() : handler.Bool(literal_[0] == 't'))) {
+            SetParseError(kParseErrorTermination, Offset(buffer, p));
+            return 0;
+        }
+        ValueEnd<parseFlags>();
+        return p;
+    }
+
+    //! Find the closing quotation mark of a string, starting after the opening one or at a resumed position.
+    const Ch* FindQuote(const Ch* p, const Ch* end) {
+        for (; p != end; ++p) {
+            if (escape_)
+                escape_ = false;
+            else if (*p == '\\')
+                escape_ = true;
+            else if (*p == '"')
+                break;
+        }
+        return p;
+    }
+
+    void Buffer(const Ch* begin, const Ch* end) {
+        const size_t n = static_cast<size_t>(end - begin);
+        if (n > 0)
+            std::memcpy(token_.template Push<Ch>(n), begin, n * sizeof(Ch));
+    }
+
+    //! Decode a complete string or number with GenericReader.
+    /*! \param token The token, which is followed by a null character or a delimiter. */
+    template <unsigned parseFlags, typename Handler>
+    bool ParseToken(const Ch* token, size_t length, Handler& handler) {
+        static const unsigned kTokenFlags = (parseFlags & (kParseValidateEncodingFlag | kParseFullPrecisionFlag | kParseNumbersAsStringsFlag | kParseNanAndInfFlag)) | kParseStopWhenDoneFlag;
+        GenericStringStream<SourceEncoding> s(token);
+        ParseResult r;
+        if (key_) {
+            internal::PushReaderKeyHandler<TargetEncoding, Handler> keyHandler(handler);
+            r = reader_.template Parse<kTokenFlags>(s, keyHandler);
+        }
+        else
+            r = reader_.template Parse<kTokenFlags>(s, handler);
+        token_.Clear();
+
+        if (r.IsError()) {
+            SetParseError(r.Code(), tokenOffset_ + r.Offset());
+            return false;
+        }
+        if (key_) {
+            key_ = false;
+            state_ = kColonState;
+            return true;
+        }
+        if (s.Tell() != length) { // e.g. "1-2"
+            ValueEnd<parseFlags>();
+            SetParseError(UnexpectedError(state_), tokenOffset_ + s.Tell());
+            return false;
+        }
+        ValueEnd<parseFlags>();
+        return true;
+    }
+
+    template <unsigned parseFlags>
+    void ValueEnd() {
+        if (stack_.Empty()) {
+            root_ = true;
+            state_ = (parseFlags & kParseStopWhenDoneFlag) ? kRootState : kDoneState;
+        }
+        else {
+            stack_.template Top<Frame>()->count++;
+            state_ = kCommaOrEndState;
+        }
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    const Ch* EndContainer(const Ch* buffer, const Ch* p, Handler& handler) {
+        const Frame f = *stack_.template Pop<Frame>(1);
+        if (!(f.object ? handler.EndObject(f.count) : handler.EndArray(f.count))) {
+            SetParseError(kParseErrorTermination, Offset(buffer, p) + 1);
+            return 0;
+        }
+        ValueEnd<parseFlags>();
+        return p + 1;
+    }
+
+    static const size_t kDefaultStackCapacity = 256;    //!< Default stack capacity in bytes for storing a single token.
+
+    GenericReader<SourceEncoding, TargetEncoding, StackAllocator> reader_;  //!< Decodes strings and numbers.
+    internal::Stack<StackAllocator> stack_;     //!< Frames of the open objects and arrays.
+    internal::Stack<StackAllocator> token_;     //!< A string or number spanning buffers.
+    ParseResult parseResult_;
+    size_t offset_;                             //!< Offset of the current buffer in the whole input.
+    size_t tokenOffset_;                        //!< Offset of the current token in the whole input.
+    const char* literal_;                       //!< The literal being matched.
+    size_t literalLength_;                      //!< Number of characters of literal_ matched.
+    State state_;
+    State commentReturnState_;                  //!< State to return after a comment.
+    bool escape_;                               //!< Whether the last buffered character of a string is an escaping backslash.
+    bool key_;                                  //!< Whether the current string is a member name.
+    bool root_;                                 //!< Whether a root value has been parsed.
+};
+
+//! PushReader with UTF8 encoding and default allocator.
+typedef GenericPushReader<UTF8<>, UTF8<> > PushReader;
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#if defined(__clang__) || defined(_MSC_VER)
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_PUSHREADER_H_
@@ -319,6 +319,40 @@
 #define RAPIDJSON_GETPOINTER(type, p) (p)
 #endif
 
+///////////////////////////////////////////////////////////////////////////////
+// RAPIDJSON_USE_MEMBERSINDEX
+
+//! Maintain a hash index of the members of large objects.
+/*!
+    \ingroup RAPIDJSON_CONFIG
+
+    By default \c GenericValue::FindMember(), and therefore \c HasMember() and
+    \c operator[], scan the members of an object linearly. Define this macro to 1
+    to let objects with at least \ref RAPIDJSON_MEMBERSINDEX_THRESHOLD members keep
+    an open-addressing hash table of their member names, so that these lookups
+    take expected constant time.
+
+    The table is allocated with the value's allocator and referenced from a small
+    header in front of the members block. It is built when an object reaches the
+    threshold (while parsing, copying or in \c AddMember()) and kept up to date by
+    \c RemoveMember() and \c EraseMember(). Lookups never modify the value, so a
+    const document may still be read from several threads.
+*/
+#ifndef RAPIDJSON_USE_MEMBERSINDEX
+#define RAPIDJSON_USE_MEMBERSINDEX 0
+#endif
+
+/*! \def RAPIDJSON_MEMBERSINDEX_THRESHOLD
+    \ingroup RAPIDJSON_CONFIG
+    \brief Minimum number of members of an object before its members index is built.
+
+    Only used when \ref RAPIDJSON_USE_MEMBERSINDEX is 1. Smaller objects are
+    searched linearly, which is faster than hashing for a handful of members.
+*/
+#ifndef RAPIDJSON_MEMBERSINDEX_THRESHOLD
+#define RAPIDJSON_MEMBERSINDEX_THRESHOLD 32
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // RAPIDJSON_SSE2/RAPIDJSON_SSE42/RAPIDJSON_NEON/RAPIDJSON_SIMD
 
@@ -345,10 +379,25 @@
 
     \c RAPIDJSON_SSE42 takes precedence over SSE2, if both are defined.
 
+    On processors with AVX2 or AVX-512BW, whitespace skipping and string
+    scanning can process 32 or 64 bytes per step instead:
+    \code
+    // Enable AVX2 optimization (requires e.g. -mavx2 or /arch:AVX2).
+    #define RAPIDJSON_AVX2
+
+    // Enable AVX-512BW optimization (requires e.g. -mavx512bw or /arch:AVX512).
+    #define RAPIDJSON_AVX512
+    \endcode
+
+    \c RAPIDJSON_AVX512 takes precedence over AVX2, and both take precedence
+    over SSE4.2 and SSE2. The selection is made at compile time, so the
+    resulting binary only runs on processors supporting the chosen extension.
+
     If any of these symbols is defined, RapidJSON defines the macro
     \c RAPIDJSON_SIMD to indicate the availability of the optimized code.
 */
 #if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42) \
+    || defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512) \
     || defined(RAPIDJSON_NEON) || defined(RAPIDJSON_DOXYGEN_RUNNING)
 #define RAPIDJSON_SIMD
 #endif
@@ -23,13 +23,17 @@
 #include "internal/meta.h"
 #include "internal/stack.h"
 #include "internal/strtod.h"
+#include "internal/structural.h"
+#include "internal/unicode.h"
 #include <limits>
 
 #if defined(RAPIDJSON_SIMD) && defined(_MSC_VER)
 #include <intrin.h>
 #pragma intrinsic(_BitScanForward)
 #endif
-#ifdef RAPIDJSON_SSE42
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+#include "internal/simd.h"
+#elif defined(RAPIDJSON_SSE42)
 #include <nmmintrin.h>
 #elif defined(RAPIDJSON_SSE2)
 #include <emmintrin.h>
@@ -153,6 +157,7 @@ enum ParseFlag {
     kParseNumbersAsStringsFlag = 64,    //!< Parse all numbers (ints/doubles) as strings.
     kParseTrailingCommasFlag = 128, //!< Allow trailing commas at the end of objects and arrays.
     kParseNanAndInfFlag = 256,      //!< Allow parsing NaN, Inf, Infinity, -Inf and -Infinity as doubles.
+    kParseStructuralIndexFlag = 512,    //!< Index the structural characters of (Insitu)StringStream input in a SIMD pass before parsing. Ignored with kParseCommentsFlag.
     kParseDefaultFlags = RAPIDJSON_PARSE_DEFAULT_FLAGS  //!< Default parse flags. Can be customized by defining RAPIDJSON_PARSE_DEFAULT_FLAGS
 };
 
@@ -256,12 +261,11 @@ private:
 ///////////////////////////////////////////////////////////////////////////////
 // SkipWhitespace
 
-//! Skip the JSON white spaces in a stream.
-/*! \param is A input stream for skipping white spaces.
-    \note This function has SSE2/SSE4.2 specialization.
-*/
 template<typename InputStream>
-void SkipWhitespace(InputStream& is) {
+void SkipWhitespace(InputStream& is, internal::TrueType);
+
+template<typename InputStream>
+void SkipWhitespace(InputStream& is, internal::FalseType) {
     internal::StreamLocalCopy<InputStream> copy(is);
     InputStream& s(copy.s);
 
@@ -270,13 +274,62 @@ void SkipWhitespace(InputStream& is) {
         s.Take();
 }
 
+//! Skip the JSON white spaces in a stream.
+/*! \param is A input stream for skipping white spaces.
+    \note This function has SSE2/SSE4.2 specialization, and skips in the buffer of streams with \ref StreamBufferTraits.
+*/
+template<typename InputStream>
+void SkipWhitespace(InputStream& is) {
+    SkipWhitespace(is, internal::BoolType<StreamBufferTraits<InputStream>::bufferAccess != 0>());
+}
+
 inline const char* SkipWhitespace(const char* p, const char* end) {
     while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
         ++p;
     return p;
 }
 
-#ifdef RAPIDJSON_SSE42
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+//! Skip whitespace with AVX2/AVX-512BW instructions, testing 32/64 8-byte characters at once.
+inline const char *SkipWhitespace_SIMD(const char* p) {
+    // Fast return for single non-whitespace
+    if (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+        ++p;
+    else
+        return p;
+
+    // Start with the aligned block containing p, ignoring the bytes before it
+    const char* block = internal::SimdAlignDown(p);
+    internal::SimdMask r = static_cast<internal::SimdMask>(~internal::SimdWhitespaceMask(block)) >> (p - block);
+    if (r != 0)
+        return p + internal::SimdFirstSet(r);
+
+    // The rest of string using SIMD
+    for (p = block + internal::kSimdBlockSize;; p += internal::kSimdBlockSize) {
+        r = static_cast<internal::SimdMask>(~internal::SimdWhitespaceMask(p));
+        if (r != 0)     // some of characters is non-whitespace
+            return p + internal::SimdFirstSet(r);
+    }
+}
+
+inline const char *SkipWhitespace_SIMD(const char* p, const char* end) {
+    // Fast return for single non-whitespace
+    if (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        ++p;
+    else
+        return p;
+
+    // The middle of string using SIMD
+    for (; end - p >= static_cast<ptrdiff_t>(internal::kSimdBlockSize); p += internal::kSimdBlockSize) {
+        const internal::SimdMask r = static_cast<internal::SimdMask>(~internal::SimdWhitespaceMask(p));
+        if (r != 0)     // some of characters is non-whitespace
+            return p + internal::SimdFirstSet(r);
+    }
+
+    return SkipWhitespace(p, end);
+}
+
+#elif defined(RAPIDJSON_SSE42)
 //! Skip whitespace with SSE 4.2 pcmpistrm instruction, testing 16 8-byte characters at once.
 inline const char *SkipWhitespace_SIMD(const char* p) {
     // Fast return for single non-whitespace
@@ -514,6 +567,105 @@ template<> inline void SkipWhitespace(EncodedInputStream<UTF8<>, MemoryStream>&
 }
 #endif // RAPIDJSON_SIMD
 
+template<typename Ch>
+inline const Ch* SkipBufferedWhitespace(const Ch* p, const Ch* end) {
+    while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        ++p;
+    return p;
+}
+
+inline const char* SkipBufferedWhitespace(const char* p, const char* end) {
+#ifdef RAPIDJSON_SIMD
+    return SkipWhitespace_SIMD(p, end);
+#else
+    return SkipWhitespace(p, end);
+#endif
+}
+
+//! Skip white spaces in the buffer of a stream with \ref StreamBufferTraits, a block at a time.
+template<typename InputStream>
+void SkipWhitespace(InputStream& is, internal::TrueType) {
+    const typename InputStream::Ch c = is.Peek();
+    if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+        return;
+
+    for (;;) {
+        const typename InputStream::Ch* p = is.BufferBegin();
+        const typename InputStream::Ch* end = is.BufferEnd();
+        if (p == end)
+            return;
+        p = SkipBufferedWhitespace(p, end);
+        is.BufferSeek(p);
+        if (p != end)
+            return;
+    }
+}
+
+//! Find the first '\"', '\\' or control character in [p, end), or end.
+inline const char* ScanBufferedUnescapedString(const char* p, const char* end) {
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+    for (; end - p >= static_cast<ptrdiff_t>(internal::kSimdBlockSize); p += internal::kSimdBlockSize) {
+        const internal::SimdMask r = internal::SimdStringSpecialMask(p);
+        if (r != 0)
+            return p + internal::SimdFirstSet(r);
+    }
+#elif defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
+    const __m128i dq = _mm_set1_epi8('\"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    const __m128i sp = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i t1 = _mm_cmpeq_epi8(s, dq);
+        const __m128i t2 = _mm_cmpeq_epi8(s, bs);
+        const __m128i t3 = _mm_cmpeq_epi8(_mm_max_epu8(s, sp), sp); // s < 0x20 <=> max(s, 0x1F) == 0x1F
+        const int r = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(t1, t2), t3));
+        if (r != 0)
+            return p + internal::SimdFirstSet(static_cast<uint32_t>(r));
+    }
+#endif
+    while (p != end && *p != '\"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+        ++p;
+    return p;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// StructuralIndexStream
+
+//! A string stream with a structural index of its remaining text.
+/*! Used by GenericReader for \ref kParseStructuralIndexFlag. Whitespace and
+    unescaped string runs are skipped by jumping to the next index entry
+    (see internal::BuildStructuralIndex()) instead of scanning them.
+    \tparam Stream StringStream or InsituStringStream.
+    \note implements Stream concept
+*/
+template <typename Stream>
+struct StructuralIndexStream : Stream {
+    typedef typename Stream::Ch Ch;
+
+    StructuralIndexStream(const Stream& s, const uint32_t* index) : Stream(s), base_(s.src_), index_(index) {}
+
+    //! Position of the first index entry at or after the current position.
+    const Ch* NextIndexed() {
+        while (base_ + *index_ < this->src_)
+            ++index_;
+        return base_ + *index_;
+    }
+
+    const Ch* base_;            //!< Position the index offsets are relative to.
+    const uint32_t* index_;     //!< Current index entry, terminated by the offset of the end of text.
+};
+
+template <typename Stream>
+struct StreamTraits<StructuralIndexStream<Stream> > : StreamTraits<Stream> {};
+
+//! Skip white spaces by jumping to the next index entry.
+template<typename Stream>
+inline void SkipWhitespace(StructuralIndexStream<Stream>& is) {
+    const typename Stream::Ch c = is.Peek();
+    if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+        is.src_ += is.NextIndexed() - is.src_;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // GenericReader
 
@@ -543,7 +695,7 @@ public:
         \param stackCapacity stack capacity in bytes for storing a single decoded string.  (Only use for non-destructive parsing)
     */
     GenericReader(StackAllocator* stackAllocator = 0, size_t stackCapacity = kDefaultStackCapacity) :
-        stack_(stackAllocator, stackCapacity), parseResult_(), state_(IterativeParsingStartState) {}
+        stack_(stackAllocator, stackCapacity), structuralIndex_(stackAllocator, 0), parseResult_(), state_(IterativeParsingStartState) {}
 
     //! Parse JSON text.
     /*! \tparam parseFlags Combination of \ref ParseFlag.
@@ -555,6 +707,9 @@ public:
     */
     template <unsigned parseFlags, typename InputStream, typename Handler>
     ParseResult Parse(InputStream& is, Handler& handler) {
+        if (parseFlags & kParseStructuralIndexFlag)
+            return StructuralIndexParse<parseFlags>(is, handler);
+
         if (parseFlags & kParseIterativeFlag)
             return IterativeParse<parseFlags>(is, handler);
 
@@ -695,6 +850,42 @@ private:
 
     void ClearStack() { stack_.Clear(); }
 
+    // Two-stage parsing: index the whole text, then run the normal parser over a StructuralIndexStream.
+    // Only contiguous UTF-8 text can be indexed, other streams are parsed directly.
+    template <unsigned parseFlags, typename InputStream, typename Handler>
+    ParseResult StructuralIndexParse(InputStream& is, Handler& handler) {
+        return Parse<parseFlags & ~static_cast<unsigned>(kParseStructuralIndexFlag)>(is, handler);
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    ParseResult StructuralIndexParse(StringStream& is, Handler& handler) {
+        return StructuralIndexParseString<parseFlags>(is, handler);
+    }
+
+    template <unsigned parseFlags, typename Handler>
+    ParseResult StructuralIndexParse(InsituStringStream& is, Handler& handler) {
+        return StructuralIndexParseString<parseFlags>(is, handler);
+    }
+
+    template <unsigned parseFlags, typename Stream, typename Handler>
+    ParseResult StructuralIndexParseString(Stream& is, Handler& handler) {
+        // Comments are not recognized by the index; offsets are 32-bit.
+        if (parseFlags & kParseCommentsFlag)
+            return Parse<parseFlags & ~static_cast<unsigned>(kParseStructuralIndexFlag)>(is, handler);
+        const size_t length = std::strlen(is.src_);
+        if (length >= 0xFFFFFFFFu)
+            return Parse<parseFlags & ~static_cast<unsigned>(kParseStructuralIndexFlag)>(is, handler);
+
+        structuralIndex_.Clear();
+        structuralIndex_.template Reserve<uint32_t>(length / 16 + 65);
+        internal::BuildStructuralIndex(is.src_, length, structuralIndex_);
+
+        StructuralIndexStream<Stream> s(is, structuralIndex_.template Bottom<uint32_t>());
+        Parse<parseFlags & ~static_cast<unsigned>(kParseStructuralIndexFlag)>(s, handler);
+        is.src_ = s.src_;
+        return parseResult_;
+    }
+
     // clear stack on any exit from ParseStream, e.g. due to exception
     struct ClearStackOnExit {
         explicit ClearStackOnExit(GenericReader& r) : r_(r) {}
@@ -944,6 +1135,13 @@ private:
             return stack_.template Pop<Ch>(length_);
         }
 
+        //! Remove the last \c count characters.
+        void Pop(SizeType count) {
+            RAPIDJSON_ASSERT(count <= length_);
+            stack_.template Pop<Ch>(count);
+            length_ -= count;
+        }
+
     private:
         StackStream(const StackStream&);
         StackStream& operator=(const StackStream&);
@@ -1003,6 +1201,9 @@ private:
             // Scan and copy string before "\\\"" or < 0x20. This is an optional optimzation.
             if (!(parseFlags & kParseValidateEncodingFlag))
                 ScanCopyUnescapedString(is, os);
+            else
+                ScanValidateUnescapedString(is, os, static_cast<SEncoding*>(0), static_cast<TEncoding*>(0));
+            ScanTranscodeUnescapedString(is, os, static_cast<SEncoding*>(0), static_cast<TEncoding*>(0));
 
             Ch c = is.Peek();
             if (RAPIDJSON_UNLIKELY(c == '\\')) {    // Escape
@@ -1054,11 +1255,171 @@ private:
     }
 
     template<typename InputStream, typename OutputStream>
-    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(InputStream&, OutputStream&) {
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(InputStream& is, OutputStream& os) {
+        ScanCopyUnescapedString(is, os, internal::BoolType<StreamBufferTraits<InputStream>::bufferAccess != 0 && sizeof(typename InputStream::Ch) == 1>());
+    }
+
+    template<typename InputStream, typename OutputStream, bool bufferAccess>
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(InputStream&, OutputStream&, internal::BoolType<bufferAccess>) {
+            // Do nothing for generic version
+    }
+
+    // Stream with buffer access -> StackStream<char>, copy the buffered part of the run a block at a time.
+    template<typename InputStream>
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(InputStream& is, StackStream<char>& os, internal::TrueType) {
+        for (;;) {
+            const char* p = is.BufferBegin();
+            const char* end = is.BufferEnd();
+            const char* q = ScanBufferedUnescapedString(p, end);
+            if (q == p)
+                return;
+            const size_t length = static_cast<size_t>(q - p);
+            std::memcpy(os.Push(length), p, length);
+            is.BufferSeek(q);
+            if (q != end)
+                return;
+        }
+    }
+
+    // Scan, validate and copy string before "\\\"" or < 0x20 with kParseValidateEncodingFlag. This is an optional optimization.
+    template<typename SEncoding, typename TEncoding, typename InputStream, typename OutputStream>
+    static RAPIDJSON_FORCEINLINE void ScanValidateUnescapedString(InputStream&, OutputStream&, SEncoding*, TEncoding*) {
+            // Do nothing for generic version
+    }
+
+    static RAPIDJSON_FORCEINLINE void ScanValidateUnescapedString(StringStream& is, StackStream<char>& os, UTF8<char>*, UTF8<char>*) {
+        const char* p = is.src_;
+        const SizeType length = static_cast<SizeType>(internal::ScanValidUTF8(p) - p);
+        if (length != 0) {
+            std::memcpy(os.Push(length), p, length);
+            is.src_ = p + length;
+        }
+    }
+
+    static RAPIDJSON_FORCEINLINE void ScanValidateUnescapedString(InsituStringStream& is, InsituStringStream& os, UTF8<char>*, UTF8<char>*) {
+        RAPIDJSON_ASSERT(&is == &os);
+        (void)os;
+
+        const size_t length = static_cast<size_t>(internal::ScanValidUTF8(is.src_) - is.src_);
+        if (is.src_ != is.dst_)
+            std::memmove(is.dst_, is.src_, length);
+        is.src_ += length;
+        is.dst_ += length;
+    }
+
+    // Scan, validate and transcode string before "\\\"" or < 0x20 between different encodings. This is an optional optimization.
+    template<typename SEncoding, typename TEncoding, typename InputStream, typename OutputStream>
+    static RAPIDJSON_FORCEINLINE void ScanTranscodeUnescapedString(InputStream&, OutputStream&, SEncoding*, TEncoding*) {
             // Do nothing for generic version
     }
 
-#if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
+    template<typename CharType>
+    static RAPIDJSON_FORCEINLINE void ScanTranscodeUnescapedString(StringStream& is, StackStream<CharType>& os, UTF8<char>*, UTF16<CharType>*) {
+        // A UTF-8 sequence never transcodes to more code units than it has bytes
+        const char* p = is.src_;
+        const char* end = internal::ScanValidUTF8(p);
+        const SizeType length = static_cast<SizeType>(end - p);
+        if (length != 0) {
+            CharType* begin = static_cast<CharType*>(os.Push(length));
+            os.Pop(length - static_cast<SizeType>(internal::TranscodeUTF8ToUTF16(p, end, begin) - begin));
+            is.src_ = end;
+        }
+    }
+
+    // The structural index already knows where the unescaped run ends ('\"', '\\' or a control character)
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(StructuralIndexStream<StringStream>& is, StackStream<char>& os) {
+        const char* p = is.src_;
+        const SizeType length = static_cast<SizeType>(is.NextIndexed() - p);
+        if (length != 0) {
+            std::memcpy(os.Push(length), p, length);
+            is.src_ = p + length;
+        }
+    }
+
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(StructuralIndexStream<InsituStringStream>& is, StructuralIndexStream<InsituStringStream>& os) {
+        RAPIDJSON_ASSERT(&is == &os);
+        (void)os;
+
+        const size_t length = static_cast<size_t>(is.NextIndexed() - is.src_);
+        if (is.src_ != is.dst_)
+            std::memmove(is.dst_, is.src_, length);
+        is.src_ += length;
+        is.dst_ += length;
+    }
+
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+    // StringStream -> StackStream<char>
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(StringStream& is, StackStream<char>& os) {
+        const char* p = is.src_;
+
+        // Start with the aligned block containing p (unaligned load may cross page boundary and cause crash)
+        const char* block = internal::SimdAlignDown(p);
+        size_t skip = static_cast<size_t>(p - block);
+        for (;; p = block += internal::kSimdBlockSize, skip = 0) {
+            const internal::SimdMask r = internal::SimdStringSpecialMask(block) >> skip;
+            if (RAPIDJSON_UNLIKELY(r != 0)) {   // some of characters is escaped
+                const size_t length = internal::SimdFirstSet(r);
+                if (length != 0) {
+                    std::memcpy(os.Push(length), p, length);
+                    p += length;
+                }
+                break;
+            }
+            std::memcpy(os.Push(internal::kSimdBlockSize - skip), p, internal::kSimdBlockSize - skip);
+        }
+
+        is.src_ = p;
+    }
+
+    // InsituStringStream -> InsituStringStream
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(InsituStringStream& is, InsituStringStream& os) {
+        RAPIDJSON_ASSERT(&is == &os);
+        (void)os;
+
+        if (is.src_ == is.dst_) {
+            SkipUnescapedString(is);
+            return;
+        }
+
+        char* p = is.src_;
+        char *q = is.dst_;
+
+        // Start with the aligned block containing p; source and destination may overlap, hence memmove
+        char* block = const_cast<char*>(internal::SimdAlignDown(p));
+        size_t skip = static_cast<size_t>(p - block);
+        for (;; p = block += internal::kSimdBlockSize, skip = 0) {
+            const internal::SimdMask r = internal::SimdStringSpecialMask(block) >> skip;
+            if (RAPIDJSON_UNLIKELY(r != 0)) {   // some of characters is escaped
+                for (const char* pend = p + internal::SimdFirstSet(r); p != pend; )
+                    *q++ = *p++;
+                break;
+            }
+            std::memmove(q, p, internal::kSimdBlockSize - skip);
+            q += internal::kSimdBlockSize - skip;
+        }
+
+        is.src_ = p;
+        is.dst_ = q;
+    }
+
+    // When read/write pointers are the same for insitu stream, just skip unescaped characters
+    static RAPIDJSON_FORCEINLINE void SkipUnescapedString(InsituStringStream& is) {
+        RAPIDJSON_ASSERT(is.src_ == is.dst_);
+        char* p = is.src_;
+
+        // Start with the aligned block containing p, ignoring the bytes before it
+        char* block = const_cast<char*>(internal::SimdAlignDown(p));
+        internal::SimdMask r = internal::SimdStringSpecialMask(block) >> (p - block);
+
+        // The rest of string using SIMD
+        if (r == 0)
+            for (p = block + internal::kSimdBlockSize; (r = internal::SimdStringSpecialMask(p)) == 0; p += internal::kSimdBlockSize)
+                ;
+        p += internal::SimdFirstSet(r);
+
+        is.src_ = is.dst_ = p;
+    }
+#elif defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
     // StringStream -> StackStream<char>
     static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(StringStream& is, StackStream<char>& os) {
         const char* p = is.src_;
@@ -2209,6 +2570,7 @@ private:
 
     static const size_t kDefaultStackCapacity = 256;    //!< Default stack capacity in bytes for storing a single decoded string.
     internal::Stack<StackAllocator> stack_;  //!< A stack for storing decoded string temporarily during non-destructive parsing.
+    internal::Stack<StackAllocator> structuralIndex_;   //!< Offsets of the structural characters for kParseStructuralIndexFlag.
     ParseResult parseResult_;
     IterativeParsingState state_;
 }; // class GenericReader
@@ -18,6 +18,7 @@
 #include "document.h"
 #include "pointer.h"
 #include "stringbuffer.h"
+#include <algorithm> // std::sort, std::lower_bound
 #include <cmath> // abs, floor
 
 #if !defined(RAPIDJSON_SCHEMA_USE_INTERNALREGEX)
@@ -154,6 +155,13 @@ public:
     virtual void DestroryHasher(void* hasher) = 0;
     virtual void* MallocState(size_t size) = 0;
     virtual void FreeState(void* p) = 0;
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    //! Searches \c str for \c pattern. Overridden by validators to reuse one searcher per pattern.
+    virtual bool IsPatternMatch(const typename SchemaType::RegexType& pattern, const typename SchemaType::Ch* str) {
+        GenericRegexSearch<typename SchemaType::RegexType> rs(pattern);
+        return rs.Search(str);
+    }
+#endif
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -404,6 +412,13 @@ public:
     typedef Schema<SchemaDocumentType> SchemaType;
     typedef GenericValue<EncodingType, AllocatorType> SValue;
     typedef IValidationErrorHandler<Schema> ErrorHandler;
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    typedef internal::GenericRegex<EncodingType, AllocatorType> RegexType;
+#elif RAPIDJSON_SCHEMA_USE_STDREGEX
+    typedef std::basic_regex<Ch> RegexType;
+#else
+    typedef char RegexType;
+#endif
     friend class GenericSchemaDocument<ValueType, AllocatorType>;
 
     Schema(SchemaDocumentType* schemaDocument, const PointerType& p, const ValueType& value, const ValueType& document, AllocatorType* allocator) :
@@ -422,6 +437,8 @@ public:
         patternProperties_(),
         patternPropertyCount_(),
         propertyCount_(),
+        propertyTable_(),
+        propertyTableMask_(),
         minProperties_(),
         maxProperties_(SizeType(~0)),
         additionalProperties_(true),
@@ -470,6 +487,7 @@ public:
                     itr->Accept(h);
                     enum_[enumCount_++] = h.GetHashCode();
                 }
+                std::sort(enum_, enum_ + enumCount_); // binary search in EndValue()
             }
 
         if (schemaDocument) {
@@ -519,6 +537,7 @@ public:
                     properties_[i].name = allProperties[i];
                     properties_[i].schema = typeless_;
                 }
+                CreatePropertyTable();
             }
         }
 
@@ -646,6 +665,7 @@ public:
 
     ~Schema() {
         AllocatorType::Free(enum_);
+        AllocatorType::Free(propertyTable_);
         if (properties_) {
             for (SizeType i = 0; i < propertyCount_; i++)
                 properties_[i].~Property();
@@ -734,12 +754,11 @@ public:
 
         if (enum_) {
             const uint64_t h = context.factory.GetHashCode(context.hasher);
-            for (SizeType i = 0; i < enumCount_; i++)
-                if (enum_[i] == h)
-                    goto foundEnum;
-            context.error_handler.DisallowedValue();
-            RAPIDJSON_INVALID_KEYWORD_RETURN(GetEnumString());
-            foundEnum:;
+            const uint64_t* e = std::lower_bound(enum_, enum_ + enumCount_, h);
+            if (e == enum_ + enumCount_ || *e != h) {
+                context.error_handler.DisallowedValue();
+                RAPIDJSON_INVALID_KEYWORD_RETURN(GetEnumString());
+            }
         }
 
         if (allOf_.schemas)
@@ -860,7 +879,7 @@ public:
             }
         }
 
-        if (pattern_ && !IsPatternMatch(pattern_, str, length)) {
+        if (pattern_ && !IsPatternMatch(context, pattern_, str, length)) {
             context.error_handler.DoesNotMatch(str, length);
             RAPIDJSON_INVALID_KEYWORD_RETURN(GetPatternString());
         }
@@ -893,14 +912,14 @@ public:
         if (patternProperties_) {
             context.patternPropertiesSchemaCount = 0;
             for (SizeType i = 0; i < patternPropertyCount_; i++)
-                if (patternProperties_[i].pattern && IsPatternMatch(patternProperties_[i].pattern, str, len)) {
+                if (patternProperties_[i].pattern && IsPatternMatch(context, patternProperties_[i].pattern, str, len)) {
                     context.patternPropertiesSchemas[context.patternPropertiesSchemaCount++] = patternProperties_[i].schema;
                     context.valueSchema = typeless_;
                 }
         }
 
         SizeType index;
-        if (FindPropertyIndex(ValueType(str, len).Move(), &index)) {
+        if (FindPropertyIndex(str, len, &index)) {
             if (context.patternPropertiesSchemaCount > 0) {
                 context.patternPropertiesSchemas[context.patternPropertiesSchemaCount++] = properties_[index].schema;
                 context.valueSchema = typeless_;
@@ -1070,14 +1089,6 @@ private:
         kTotalSchemaType
     };
 
-#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
-        typedef internal::GenericRegex<EncodingType, AllocatorType> RegexType;
-#elif RAPIDJSON_SCHEMA_USE_STDREGEX
-        typedef std::basic_regex<Ch> RegexType;
-#else
-        typedef char RegexType;
-#endif
-
     struct SchemaArray {
         SchemaArray() : schemas(), count() {}
         ~SchemaArray() { AllocatorType::Free(schemas); }
@@ -1142,9 +1153,9 @@ private:
         return 0;
     }
 
-    static bool IsPatternMatch(const RegexType* pattern, const Ch *str, SizeType) {
-        GenericRegexSearch<RegexType> rs(*pattern);
-        return rs.Search(str);
+    // The validator keeps a GenericRegexSearch per pattern, so that its DFA is reused by later strings.
+    static bool IsPatternMatch(Context& context, const RegexType* pattern, const Ch *str, SizeType) {
+        return context.factory.IsPatternMatch(*pattern, str);
     }
 #elif RAPIDJSON_SCHEMA_USE_STDREGEX
     template <typename ValueType>
@@ -1161,7 +1172,7 @@ private:
         return 0;
     }
 
-    static bool IsPatternMatch(const RegexType* pattern, const Ch *str, SizeType length) {
+    static bool IsPatternMatch(Context&, const RegexType* pattern, const Ch *str, SizeType length) {
         std::match_results<const Ch*> r;
         return std::regex_search(str, str + length, r, *pattern);
     }
@@ -1169,7 +1180,7 @@ private:
     template <typename ValueType>
     RegexType* CreatePattern(const ValueType&) { return 0; }
 
-    static bool IsPatternMatch(const RegexType*, const Ch *, SizeType) { return true; }
+    static bool IsPatternMatch(Context&, const RegexType*, const Ch *, SizeType) { return true; }
 #endif // RAPIDJSON_SCHEMA_USE_STDREGEX
 
     void AddType(const ValueType& type) {
@@ -1218,20 +1229,42 @@ private:
             context.validators[schemas.begin + i] = context.factory.CreateSchemaValidator(*schemas.schemas[i]);
     }
 
-    // O(n)
-    bool FindPropertyIndex(const ValueType& name, SizeType* outIndex) const {
-        SizeType len = name.GetStringLength();
-        const Ch* str = name.GetString();
-        for (SizeType index = 0; index < propertyCount_; index++)
-            if (properties_[index].name.GetStringLength() == len && 
+    // Open-addressing table of property indices (plus one, 0 for an empty slot), at most half full.
+    void CreatePropertyTable() {
+        SizeType size = 2;
+        while (size < propertyCount_ * 2)
+            size *= 2;
+        propertyTableMask_ = size - 1;
+        propertyTable_ = static_cast<SizeType*>(allocator_->Malloc(sizeof(SizeType) * size));
+        std::memset(propertyTable_, 0, sizeof(SizeType) * size);
+        for (SizeType i = 0; i < propertyCount_; i++) {
+            SizeType b = internal::StrHash(properties_[i].name.GetString(), properties_[i].name.GetStringLength()) & propertyTableMask_;
+            while (propertyTable_[b] != 0)
+                b = (b + 1) & propertyTableMask_;
+            propertyTable_[b] = i + 1;
+        }
+    }
+
+    // O(1)
+    bool FindPropertyIndex(const Ch* str, SizeType len, SizeType* outIndex) const {
+        if (!propertyTable_)
+            return false;
+        for (SizeType b = internal::StrHash(str, len) & propertyTableMask_; propertyTable_[b] != 0; b = (b + 1) & propertyTableMask_) {
+            const SizeType index = propertyTable_[b] - 1;
+            if (properties_[index].name.GetStringLength() == len &&
                 (std::memcmp(properties_[index].name.GetString(), str, sizeof(Ch) * len) == 0))
             {
                 *outIndex = index;
                 return true;
             }
+        }
         return false;
     }
 
+    bool FindPropertyIndex(const ValueType& name, SizeType* outIndex) const {
+        return FindPropertyIndex(name.GetString(), name.GetStringLength(), outIndex);
+    }
+
     bool CheckInt(Context& context, int64_t i) const {
         if (!(type_ & ((1 << kIntegerSchemaType) | (1 << kNumberSchemaType)))) {
             DisallowedType(context, GetIntegerString());
@@ -1413,6 +1446,8 @@ private:
     PatternProperty* patternProperties_;
     SizeType patternPropertyCount_;
     SizeType propertyCount_;
+    SizeType* propertyTable_;
+    SizeType propertyTableMask_;
     SizeType minProperties_;
     SizeType maxProperties_;
     bool additionalProperties_;
@@ -1799,6 +1834,11 @@ public:
         currentError_(),
         missingDependents_(),
         valid_(true)
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+        , patternSearches_(allocator, 0)
+        , patternOwner_(0)
+        , patternSearchCount_(0)
+#endif
 #if RAPIDJSON_SCHEMA_VERBOSE
         , depth_(0)
 #endif
@@ -1830,6 +1870,11 @@ public:
         currentError_(),
         missingDependents_(),
         valid_(true)
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+        , patternSearches_(allocator, 0)
+        , patternOwner_(0)
+        , patternSearchCount_(0)
+#endif
 #if RAPIDJSON_SCHEMA_VERBOSE
         , depth_(0)
 #endif
@@ -1839,6 +1884,16 @@ public:
     //! Destructor.
     ~GenericSchemaValidator() {
         Reset();
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+        while (!patternSearches_.Empty()) {
+            RegexSearchType* rs = patternSearches_.template Pop<PatternSearchEntry>(1)->search;
+            if (rs) {
+                rs->~RegexSearchType();
+                StateAllocator::Free(rs);
+            }
+        }
+        patternSearches_.ShrinkToFit();
+#endif
         RAPIDJSON_DELETE(ownStateAllocator_);
     }
 
@@ -2154,11 +2209,15 @@ RAPIDJSON_MULTILINEMACRO_END
 
     // Implementation of ISchemaStateFactory<SchemaType>
     virtual ISchemaValidator* CreateSchemaValidator(const SchemaType& root) {
-        return new (GetStateAllocator().Malloc(sizeof(GenericSchemaValidator))) GenericSchemaValidator(*schemaDocument_, root, documentStack_.template Bottom<char>(), documentStack_.GetSize(),
+        GenericSchemaValidator* v = new (GetStateAllocator().Malloc(sizeof(GenericSchemaValidator))) GenericSchemaValidator(*schemaDocument_, root, documentStack_.template Bottom<char>(), documentStack_.GetSize(),
 #if RAPIDJSON_SCHEMA_VERBOSE
         depth_ + 1,
 #endif
         &GetStateAllocator());
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+        v->patternOwner_ = patternOwner_ ? patternOwner_ : this;
+#endif
+        return v;
     }
 
     virtual void DestroySchemaValidator(ISchemaValidator* validator) {
@@ -2189,10 +2248,60 @@ RAPIDJSON_MULTILINEMACRO_END
         StateAllocator::Free(p);
     }
 
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    virtual bool IsPatternMatch(const typename SchemaType::RegexType& pattern, const Ch* str) {
+        if (patternOwner_)
+            return patternOwner_->IsPatternMatch(pattern, str);
+        if (patternSearches_.Empty())
+            RehashPatternSearches();
+        PatternSearchEntry* e = FindPatternSearch(&pattern);
+        if (!e->pattern) {
+            if ((patternSearchCount_ + 1) * 2 > patternSearches_.GetSize() / sizeof(PatternSearchEntry)) {
+                RehashPatternSearches();
+                e = FindPatternSearch(&pattern);
+            }
+            e->pattern = &pattern;
+            e->search = new (GetStateAllocator().Malloc(sizeof(RegexSearchType))) RegexSearchType(pattern, &GetStateAllocator());
+            ++patternSearchCount_;
+        }
+        return e->search->Search(str);
+    }
+#endif
+
 private:
     typedef typename SchemaType::Context Context;
     typedef GenericValue<UTF8<>, StateAllocator> HashCodeArray;
     typedef internal::Hasher<EncodingType, StateAllocator> HasherType;
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    typedef internal::GenericRegexSearch<typename SchemaType::RegexType, StateAllocator> RegexSearchType;
+
+    struct PatternSearchEntry {
+        const typename SchemaType::RegexType* pattern;
+        RegexSearchType* search;
+    };
+
+    //! Returns the slot of \c pattern in the open-addressing table, or the empty slot where it belongs.
+    PatternSearchEntry* FindPatternSearch(const typename SchemaType::RegexType* pattern) {
+        size_t mask = patternSearches_.GetSize() / sizeof(PatternSearchEntry) - 1;
+        PatternSearchEntry* table = patternSearches_.template Bottom<PatternSearchEntry>();
+        size_t i = (reinterpret_cast<uintptr_t>(pattern) / sizeof(void*)) & mask;
+        while (table[i].pattern && table[i].pattern != pattern)
+            i = (i + 1) & mask;
+        return &table[i];
+    }
+
+    //! Doubles the table (8 slots initially) and reinserts the existing searches.
+    void RehashPatternSearches() {
+        size_t oldCount = patternSearches_.GetSize() / sizeof(PatternSearchEntry);
+        size_t newCount = oldCount ? oldCount * 2 : 8;
+        internal::Stack<StateAllocator> old(&GetStateAllocator(), 0);
+        old.Swap(patternSearches_);
+        std::memset(patternSearches_.template Push<PatternSearchEntry>(newCount), 0, newCount * sizeof(PatternSearchEntry));
+        for (PatternSearchEntry* e = old.template Bottom<PatternSearchEntry>(); e != old.template End<PatternSearchEntry>(); ++e)
+            if (e->pattern)
+                *FindPatternSearch(e->pattern) = *e;
+    }
+#endif
 
     GenericSchemaValidator( 
         const SchemaDocumentType& schemaDocument,
@@ -2216,6 +2325,11 @@ private:
         currentError_(),
         missingDependents_(),
         valid_(true)
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+        , patternSearches_(allocator, 0)
+        , patternOwner_(0)
+        , patternSearchCount_(0)
+#endif
 #if RAPIDJSON_SCHEMA_VERBOSE
         , depth_(depth)
 #endif
@@ -2409,6 +2523,11 @@ private:
     ValueType currentError_;
     ValueType missingDependents_;
     bool valid_;
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    internal::Stack<StateAllocator> patternSearches_;   //!< PatternSearchEntry hash table keyed by pattern, kept until destruction to reuse the DFAs
+    GenericSchemaValidator* patternOwner_;              //!< Validator owning the searches, 0 if this one
+    size_t patternSearchCount_;                         //!< Occupied slots in patternSearches_
+#endif
 #if RAPIDJSON_SCHEMA_VERBOSE
     unsigned depth_;
 #endif
@@ -0,0 +1,548 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip. All rights reserved.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_SNAPSHOT_H_
+#define RAPIDJSON_SNAPSHOT_H_
+
+/*! \file snapshot.h
+    \brief Position-independent binary snapshot of a DOM, used in place without parsing.
+*/
+
+#include "document.h"
+#include "internal/stack.h"
+#include <cstring>
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(padded)
+RAPIDJSON_DIAG_OFF(switch-enum)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+template <typename Encoding>
+class GenericSnapshotValue;
+
+//! Name-value pair in a snapshot object.
+template <typename Encoding>
+struct GenericSnapshotMember {
+    GenericSnapshotValue<Encoding> name;     //!< name of member (must be a string)
+    GenericSnapshotValue<Encoding> value;    //!< value of member.
+
+private:
+    GenericSnapshotMember(const GenericSnapshotMember&);
+    GenericSnapshotMember& operator=(const GenericSnapshotMember&);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericSnapshotValue
+
+//! Read-only value in a snapshot.
+/*! It provides the const query functions of GenericValue, so code which reads
+    a DOM can be templated to read a snapshot as well.
+
+    A value is 16 bytes. Short strings are stored in the value, like the short
+    string optimization of GenericValue. Other strings, elements and members
+    are stored at offsets relative to the value itself, so the snapshot is
+    position-independent and can be used directly from a memory mapping.
+    Values only exist inside a snapshot, they cannot be copied.
+
+    \tparam Encoding Encoding of the strings.
+    \see GenericSnapshot
+*/
+template <typename Encoding>
+class GenericSnapshotValue {
+public:
+    typedef GenericSnapshotMember<Encoding> Member;         //!< Name-value pair in an object.
+    typedef Encoding EncodingType;                          //!< Encoding type from template parameter.
+    typedef typename Encoding::Ch Ch;                       //!< Character type derived from Encoding.
+    typedef const Member* ConstMemberIterator;              //!< Constant member iterator for iterating in object.
+    typedef const GenericSnapshotValue* ConstValueIterator; //!< Constant value iterator for iterating in array.
+
+    //!@name Type
+    //@{
+
+    Type GetType()  const { return static_cast<Type>(flags_ & kTypeMask); }
+    bool IsNull()   const { return GetType() == kNullType; }
+    bool IsFalse()  const { return GetType() == kFalseType; }
+    bool IsTrue()   const { return GetType() == kTrueType; }
+    bool IsBool()   const { return IsFalse() || IsTrue(); }
+    bool IsObject() const { return GetType() == kObjectType; }
+    bool IsArray()  const { return GetType() == kArrayType; }
+    bool IsNumber() const { return GetType() == kNumberType; }
+    bool IsInt()    const { return (flags_ & kIntFlag) != 0; }
+    bool IsUint()   const { return (flags_ & kUintFlag) != 0; }
+    bool IsInt64()  const { return (flags_ & kInt64Flag) != 0; }
+    bool IsUint64() const { return (flags_ & kUint64Flag) != 0; }
+    bool IsDouble() const { return (flags_ & kDoubleFlag) != 0; }
+    bool IsString() const { return GetType() == kStringType; }
+
+    //@}
+
+    //!@name Bool
+    //@{
+
+    bool GetBool() const { RAPIDJSON_ASSERT(IsBool()); return IsTrue(); }
+
+    //@}
+
+    //!@name Object
+    //@{
+
+    //! Get the number of members in the object.
+    SizeType MemberCount() const { RAPIDJSON_ASSERT(IsObject()); return size_; }
+
+    //! Check whether the object is empty.
+    bool ObjectEmpty() const { RAPIDJSON_ASSERT(IsObject()); return size_ == 0; }
+
+    //! Get a value from an object associated with the name.
+    /*! \pre IsObject() == true
+        \return The value, or a null value if the member does not exist (which asserts).
+    */
+    const GenericSnapshotValue& operator[](const Ch* name) const {
+        ConstMemberIterator m = FindMember(name);
+        if (m != MemberEnd())
+            return m->value;
+        RAPIDJSON_ASSERT(false);    // see GenericValue::operator[]
+        static const GenericSnapshotValue nullValue;
+        return nullValue;
+    }
+
+#if RAPIDJSON_HAS_STDSTRING
+    //! Get a value from an object associated with name (string object).
+    const GenericSnapshotValue& operator[](const std::basic_string<Ch>& name) const { return (*this)[name.c_str()]; }
+#endif
+
+    //! Const member iterator
+    /*! \pre IsObject() == true */
+    ConstMemberIterator MemberBegin() const { RAPIDJSON_ASSERT(IsObject()); return reinterpret_cast<const Member*>(Target()); }
+    //! Const \em past-the-end member iterator
+    /*! \pre IsObject() == true */
+    ConstMemberIterator MemberEnd() const { RAPIDJSON_ASSERT(IsObject()); return MemberBegin() + size_; }
+
+    //! Check whether a member exists in the object.
+    bool HasMember(const Ch* name) const { return FindMember(name) != MemberEnd(); }
+
+#if RAPIDJSON_HAS_STDSTRING
+    //! Check whether a member exists in the object with string object.
+    bool HasMember(const std::basic_string<Ch>& name) const { return FindMember(name) != MemberEnd(); }
+#endif
+
+    //! Find member by name.
+    /*! \pre IsObject() == true
+        \return Iterator to member, if it exists. Otherwise returns \ref MemberEnd().
+        \note Linear time complexity, or expected constant time for objects with
+            at least \ref RAPIDJSON_MEMBERSINDEX_THRESHOLD members, which are
+            stored with a hash table.
+    */
+    ConstMemberIterator FindMember(const Ch* name) const {
+        RAPIDJSON_ASSERT(name);
+        return FindMember(name, internal::StrLen(name));
+    }
+
+    //! Find member by name and length.
+    ConstMemberIterator FindMember(const Ch* name, SizeType length) const {
+        RAPIDJSON_ASSERT(IsObject());
+        const Member* members = MemberBegin();
+        if (flags_ & kIndexedFlag) {
+            const uint32_t* buckets = reinterpret_cast<const uint32_t*>(members + size_);
+            const SizeType mask = BucketCount(size_) - 1;
+            for (SizeType b = internal::StrHash(name, length) & mask; buckets[b] != 0; b = (b + 1) & mask)
+                if (members[buckets[b] - 1].name.StringEqual(name, length))
+                    return members + (buckets[b] - 1);
+            return MemberEnd();
+        }
+        const Member* m = members;
+        for (; m != members + size_; ++m)
+            if (m->name.StringEqual(name, length))
+                break;
+        return m;
+    }
+
+#if RAPIDJSON_HAS_STDSTRING
+    //! Find member by string object name.
+    ConstMemberIterator FindMember(const std::basic_string<Ch>& name) const { return FindMember(name.data(), static_cast<SizeType>(name.size())); }
+#endif
+
+    //@}
+
+    //!@name Array
+    //@{
+
+    //! Get the number of elements in array.
+    SizeType Size() const { RAPIDJSON_ASSERT(IsArray()); return size_; }
+
+    //! Check whether the array is empty.
+    bool Empty() const { RAPIDJSON_ASSERT(IsArray()); return size_ == 0; }
+
+    //! Get an element from array by index.
+    /*! \pre IsArray() == true
+        \param index Zero-based index of element.
+    */
+    const GenericSnapshotValue& operator[](SizeType index) const {
+        RAPIDJSON_ASSERT(IsArray());
+        RAPIDJSON_ASSERT(index < size_);
+        return Begin()[index];
+    }
+
+    //! Const element iterator
+    /*! \pre IsArray() == true */
+    ConstValueIterator Begin() const { RAPIDJSON_ASSERT(IsArray()); return reinterpret_cast<const GenericSnapshotValue*>(Target()); }
+    //! Const \em past-the-end element iterator
+    /*! \pre IsArray() == true */
+    ConstValueIterator End() const { return Begin() + size_; }
+
+    //@}
+
+    //!@name Number
+    //@{
+
+    int GetInt() const          { RAPIDJSON_ASSERT(IsInt());   return static_cast<int>(data_.i64); }
+    unsigned GetUint() const    { RAPIDJSON_ASSERT(IsUint());  return static_cast<unsigned>(data_.u64); }
+    int64_t GetInt64() const    { RAPIDJSON_ASSERT(IsInt64()); return data_.i64; }
+    uint64_t GetUint64() const  { RAPIDJSON_ASSERT(IsUint64()); return data_.u64; }
+
+    //! Get the value as double type.
+    /*! \note If the value is 64-bit integer type, it may lose precision. Use \c IsLosslessDouble() to check whether the converison is lossless.
+    */
+    double GetDouble() const {
+        RAPIDJSON_ASSERT(IsNumber());
+        if (flags_ & kDoubleFlag)   return data_.d;
+        if (flags_ & kInt64Flag)    return static_cast<double>(data_.i64);
+        return static_cast<double>(data_.u64);
+    }
+
+    //! Get the value as float type.
+    float GetFloat() const { return static_cast<float>(GetDouble()); }
+
+    //@}
+
+    //!@name String
+    //@{
+
+    //! Get the null-terminated string.
+    const Ch* GetString() const { RAPIDJSON_ASSERT(IsString()); return (flags_ & kInlineFlag) ? reinterpret_cast<const Ch*>(&data_) : reinterpret_cast<const Ch*>(Target()); }
+
+    //! Get the length of string.
+    SizeType GetStringLength() const { RAPIDJSON_ASSERT(IsString()); return size_; }
+
+    //@}
+
+    //! Generate events of this value to a Handler.
+    /*! Strings are passed with \c copy set to false, since they live as long as the snapshot.
+        \tparam Handler type of handler.
+        \param handler An object implementing concept Handler.
+    */
+    template <typename Handler>
+    bool Accept(Handler& handler) const {
+        switch (GetType()) {
+        case kNullType:     return handler.Null();
+        case kFalseType:    return handler.Bool(false);
+        case kTrueType:     return handler.Bool(true);
+
+        case kObjectType:
+            if (RAPIDJSON_UNLIKELY(!handler.StartObject()))
+                return false;
+            for (ConstMemberIterator m = MemberBegin(); m != MemberEnd(); ++m) {
+                if (RAPIDJSON_UNLIKELY(!handler.Key(m->name.GetString(), m->name.GetStringLength(), false)))
+                    return false;
+                if (RAPIDJSON_UNLIKELY(!m->value.Accept(handler)))
+                    return false;
+            }
+            return handler.EndObject(size_);
+
+        case kArrayType:
+            if (RAPIDJSON_UNLIKELY(!handler.StartArray()))
+                return false;
+            for (ConstValueIterator v = Begin(); v != End(); ++v)
+                if (RAPIDJSON_UNLIKELY(!v->Accept(handler)))
+                    return false;
+            return handler.EndArray(size_);
+
+        case kStringType:
+            return handler.String(GetString(), GetStringLength(), false);
+
+        default:
+            RAPIDJSON_ASSERT(GetType() == kNumberType);
+            if (IsDouble())         return handler.Double(data_.d);
+            else if (IsInt())       return handler.Int(static_cast<int>(data_.i64));
+            else if (IsUint())      return handler.Uint(static_cast<unsigned>(data_.u64));
+            else if (IsInt64())     return handler.Int64(data_.i64);
+            else                    return handler.Uint64(data_.u64);
+        }
+    }
+
+private:
+    template <typename, typename> friend class GenericSnapshot;
+
+    enum {
+        kTypeMask = 0x07,       // Type
+        kIntFlag = 0x10,
+        kUintFlag = 0x20,
+        kInt64Flag = 0x40,
+        kUint64Flag = 0x80,
+        kDoubleFlag = 0x100,
+        kIndexedFlag = 0x200,   // Object members are followed by a hash table.
+        kInlineFlag = 0x400     // Short string stored in data_.
+    };
+
+    static const SizeType kMaxInlineLength = sizeof(int64_t) / sizeof(Ch) - 1;
+
+    //! Payload of the value.
+    union Data {
+        int64_t i64;
+        uint64_t u64;
+        double d;
+        int64_t offset;         //!< Offset of the string, elements or members relative to this value.
+    };
+
+    GenericSnapshotValue() : flags_(kNullType), size_(), data_() {}
+
+    // Prohibit copying, offsets are relative to the position of the value.
+    GenericSnapshotValue(const GenericSnapshotValue&);
+    GenericSnapshotValue& operator=(const GenericSnapshotValue&);
+
+    const char* Target() const { return reinterpret_cast<const char*>(this) + data_.offset; }
+
+    bool StringEqual(const Ch* str, SizeType length) const {
+        return size_ == length && std::memcmp(GetString(), str, sizeof(Ch) * length) == 0;
+    }
+
+    //! Number of buckets of the hash table of an indexed object, with a load factor of at most one half.
+    static SizeType BucketCount(SizeType memberCount) {
+        SizeType bucketCount = 16;
+        while (bucketCount < memberCount * 2)
+            bucketCount *= 2;
+        return bucketCount;
+    }
+
+    uint32_t flags_;
+    SizeType size_;             //!< Length of a string, or number of elements or members.
+    Data data_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericSnapshot
+
+//! Binary snapshot of a DOM which is used in place, without parsing or allocation.
+/*! Write() serializes a value, e.g. a parsed GenericDocument, once. Later, the
+    snapshot bytes can be memory mapped (e.g. with MemoryMappedFileStream) and
+    queried through GetRoot() with the same const functions as GenericValue.
+    Loading is then bound by page faults rather than parsing.
+
+    \code
+    // Build
+    FileWriteStream os(fp, buffer, sizeof(buffer));
+    Snapshot::Write(document, os);
+
+    // Load
+    MemoryMappedFileStream ms("rules.snapshot");
+    Snapshot snapshot(ms.GetString(), ms.GetLength());
+    if (snapshot.IsValid())
+        int limit = snapshot.GetRoot()["limits"]["max"].GetInt();
+    \endcode
+
+    The format uses the byte order and alignment of the machine which wrote
+    it. Only the header is checked when a snapshot is opened, so snapshots
+    must come from a trusted source.
+
+    \tparam Encoding Encoding of the strings.
+    \tparam Allocator Allocator type for the buffer used by Write().
+*/
+template <typename Encoding, typename Allocator = CrtAllocator>
+class GenericSnapshot {
+public:
+    typedef GenericSnapshotValue<Encoding> ValueType;   //!< Value type of the snapshot.
+    typedef typename Encoding::Ch Ch;                   //!< Character type derived from Encoding.
+
+    //! Open a snapshot.
+    /*! \param data Snapshot bytes, aligned to 8 bytes. They must outlive the snapshot.
+        \param length Number of bytes.
+        \note Check IsValid() before calling GetRoot().
+    */
+    GenericSnapshot(const void* data, size_t length) : root_() {
+        const Header* h = static_cast<const Header*>(data);
+        if (data && (reinterpret_cast<uintptr_t>(data) & 7) == 0 && length >= sizeof(Header) + sizeof(ValueType) &&
+            std::memcmp(h->magic, kMagic, sizeof(h->magic)) == 0 && h->byteOrder == kByteOrder &&
+            h->chSize == sizeof(Ch) && h->length <= length)
+            root_ = reinterpret_cast<const ValueType*>(h + 1);
+    }
+
+    //! Whether the bytes have the header of a snapshot written on this kind of machine.
+    bool IsValid() const { return root_ != 0; }
+
+    //! Get the root value. \pre IsValid()
+    const ValueType& GetRoot() const { RAPIDJSON_ASSERT(IsValid()); return *root_; }
+
+    //! Write a snapshot of a value.
+    /*! \tparam SourceValueType Type of the value, e.g. GenericDocument or GenericValue with the same encoding.
+        \tparam OutputStream Type of byte output stream.
+        \param value Value to be written.
+        \param os Output stream, e.g. FileWriteStream or StringBuffer.
+        \param allocator Allocator for the temporary buffer holding the whole snapshot.
+    */
+    template <typename SourceValueType, typename OutputStream>
+    static void Write(const SourceValueType& value, OutputStream& os, Allocator* allocator = 0) {
+        internal::Stack<Allocator> buffer(allocator, kDefaultBufferCapacity);
+        Reserve(buffer, sizeof(Header) + sizeof(ValueType));
+        WriteValue(buffer, sizeof(Header), value);
+
+        Header* h = buffer.template Bottom<Header>();
+        std::memcpy(h->magic, kMagic, sizeof(h->magic));
+        h->byteOrder = kByteOrder;
+        h->chSize = sizeof(Ch);
+        h->length = buffer.GetSize();
+
+        const char* p = buffer.template Bottom<char>();
+        const size_t n = buffer.GetSize();
+        PutReserve(os, n);
+        for (size_t i = 0; i < n; i++)
+            PutUnsafe(os, static_cast<typename OutputStream::Ch>(p[i]));
+    }
+
+private:
+    typedef typename ValueType::Member Member;
+
+    struct Header {
+        char magic[8];
+        uint32_t byteOrder;     //!< kByteOrder as written by the machine.
+        uint32_t chSize;        //!< Size of a code unit.
+        uint64_t length;        //!< Length of the snapshot in bytes.
+    };
+
+    static const uint32_t kByteOrder = 0x01020304u;
+    static const size_t kDefaultBufferCapacity = 65536;
+    static const char kMagic[8];
+
+    //! Append zeroed, 8-byte aligned space to the buffer and return its position.
+    static size_t Reserve(internal::Stack<Allocator>& buffer, size_t size) {
+        const size_t position = (buffer.GetSize() + 7u) & ~static_cast<size_t>(7u);
+        const size_t n = position + size - buffer.GetSize();
+        std::memset(buffer.template Push<char>(n), 0, n);
+        return position;
+    }
+
+    static ValueType& At(internal::Stack<Allocator>& buffer, size_t position) {
+        return *reinterpret_cast<ValueType*>(buffer.template Bottom<char>() + position);
+    }
+
+    //! Write a value at \c position, appending what it refers to.
+    template <typename SourceValueType>
+    static void WriteValue(internal::Stack<Allocator>& buffer, size_t position, const SourceValueType& value) {
+        uint32_t flags = static_cast<uint32_t>(value.GetType());
+        switch (value.GetType()) {
+        case kObjectType:
+            {
+                const SizeType size = value.MemberCount();
+                const bool indexed = size >= RAPIDJSON_MEMBERSINDEX_THRESHOLD;
+                const SizeType bucketCount = indexed ? ValueType::BucketCount(size) : 0;
+                const size_t members = Reserve(buffer, size * sizeof(Member) + bucketCount * sizeof(uint32_t));
+                SetTarget(buffer, position, flags | (indexed ? static_cast<uint32_t>(ValueType::kIndexedFlag) : 0u), size, members);
+
+                size_t m = members;
+                for (typename SourceValueType::ConstMemberIterator itr = value.MemberBegin(); itr != value.MemberEnd(); ++itr, m += sizeof(Member)) {
+                    WriteValue(buffer, m, itr->name);
+                    WriteValue(buffer, m + sizeof(ValueType), itr->value);
+                }
+
+                if (indexed) {
+                    const Member* ms = reinterpret_cast<const Member*>(buffer.template Bottom<char>() + members);
+                    uint32_t* buckets = reinterpret_cast<uint32_t*>(const_cast<Member*>(ms + size));
+                    const SizeType mask = bucketCount - 1;
+                    for (SizeType i = 0; i < size; i++) {
+                        SizeType b = internal::StrHash(ms[i].name.GetString(), ms[i].name.GetStringLength()) & mask;
+                        while (buckets[b] != 0)
+                            b = (b + 1) & mask;
+                        buckets[b] = i + 1;
+                    }
+                }
+            }
+            break;
+
+        case kArrayType:
+            {
+                const SizeType size = value.Size();
+                const size_t elements = Reserve(buffer, size * sizeof(ValueType));
+                SetTarget(buffer, position, flags, size, elements);
+                for (SizeType i = 0; i < size; i++)
+                    WriteValue(buffer, elements + i * sizeof(ValueType), value[i]);
+            }
+            break;
+
+        case kStringType:
+            {
+                const SizeType length = value.GetStringLength();
+                if (length <= ValueType::kMaxInlineLength) {
+                    ValueType& v = At(buffer, position);
+                    v.flags_ = flags | ValueType::kInlineFlag;
+                    v.size_ = length;
+                    std::memcpy(&v.data_, value.GetString(), length * sizeof(Ch));
+                    break;
+                }
+                const size_t str = Reserve(buffer, (length + 1) * sizeof(Ch));
+                std::memcpy(buffer.template Bottom<char>() + str, value.GetString(), length * sizeof(Ch));
+                SetTarget(buffer, position, flags, length, str);
+            }
+            break;
+
+        case kNumberType:
+            {
+                ValueType& v = At(buffer, position);
+                if (value.IsInt())      flags |= ValueType::kIntFlag;
+                if (value.IsUint())     flags |= ValueType::kUintFlag;
+                if (value.IsInt64())    flags |= ValueType::kInt64Flag;
+                if (value.IsUint64())   flags |= ValueType::kUint64Flag;
+                if (value.IsDouble()) {
+                    flags |= ValueType::kDoubleFlag;
+                    v.data_.d = value.GetDouble();
+                }
+                else if (value.IsInt64())
+                    v.data_.i64 = value.GetInt64();
+                else
+                    v.data_.u64 = value.GetUint64();
+                v.flags_ = flags;
+            }
+            break;
+
+        default:
+            At(buffer, position).flags_ = flags;
+            break;
+        }
+    }
+
+    static void SetTarget(internal::Stack<Allocator>& buffer, size_t position, uint32_t flags, SizeType size, size_t target) {
+        ValueType& v = At(buffer, position);
+        v.flags_ = flags;
+        v.size_ = size;
+        v.data_.offset = static_cast<int64_t>(target) - static_cast<int64_t>(position);
+    }
+
+    const ValueType* root_;
+};
+
+template <typename Encoding, typename Allocator>
+const char GenericSnapshot<Encoding, Allocator>::kMagic[8] = { 'R', 'J', 'S', 'N', 'A', 'P', '\0', '\1' };
+
+//! GenericSnapshot with UTF8 encoding.
+typedef GenericSnapshot<UTF8<> > Snapshot;
+//! GenericSnapshotValue with UTF8 encoding.
+typedef GenericSnapshotValue<UTF8<> > SnapshotValue;
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __clang__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_SNAPSHOT_H_
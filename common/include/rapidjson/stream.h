@@ -79,6 +79,32 @@ struct StreamTraits {
     enum { copyOptimization = 0 };
 };
 
+//! Provides access to the buffer of a stream reading blocks of characters.
+/*!
+    A stream specializing this with \c bufferAccess = 1 implements
+
+\code
+    //! Current read position in the buffer.
+    const Ch* BufferBegin() const;
+
+    //! End of the buffered characters, where '\0' is stored.
+    //! Equal to BufferBegin() at the end of the stream.
+    const Ch* BufferEnd() const;
+
+    //! Move the read position to p in [BufferBegin(), BufferEnd()].
+    //! The next block is read when p is BufferEnd().
+    void BufferSeek(const Ch* p);
+\endcode
+
+    GenericReader then skips whitespace, and copies unescaped strings of byte
+    streams, directly in the buffer (with SIMD if enabled) rather than
+    character by character. See BasicBufferedIStreamWrapper.
+*/
+template<typename Stream>
+struct StreamBufferTraits {
+    enum { bufferAccess = 0 };
+};
+
 //! Reserve n characters for writing to a stream.
 template<typename Stream>
 inline void PutReserve(Stream& stream, size_t count) {
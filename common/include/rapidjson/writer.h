@@ -21,6 +21,7 @@
 #include "internal/strfunc.h"
 #include "internal/dtoa.h"
 #include "internal/itoa.h"
+#include "internal/unicode.h"
 #include "stringbuffer.h"
 #include <new>      // placement new
 
@@ -28,7 +29,9 @@
 #include <intrin.h>
 #pragma intrinsic(_BitScanForward)
 #endif
-#ifdef RAPIDJSON_SSE42
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+#include "internal/simd.h"
+#elif defined(RAPIDJSON_SSE42)
 #include <nmmintrin.h>
 #elif defined(RAPIDJSON_SSE2)
 #include <emmintrin.h>
@@ -448,9 +451,49 @@ protected:
     }
 
     bool ScanWriteUnescapedString(GenericStringStream<SourceEncoding>& is, size_t length) {
+        ScanTranscodeUnescapedString(is, length, static_cast<SourceEncoding*>(0), static_cast<TargetEncoding*>(0));
         return RAPIDJSON_LIKELY(is.Tell() < length);
     }
 
+    template<typename SEncoding, typename TEncoding>
+    void ScanTranscodeUnescapedString(GenericStringStream<SourceEncoding>&, size_t, SEncoding*, TEncoding*) {
+        // Do nothing for generic version
+    }
+
+    // UTF-16 -> UTF-8: transcode the characters needing no escaping in bulk
+    template<typename CharType>
+    void ScanTranscodeUnescapedString(GenericStringStream<SourceEncoding>& is, size_t length, UTF16<CharType>*, UTF8<char>*) {
+        is.src_ = TranscodeUnescapedString(is.src_, is.head_ + length, *os_);
+    }
+
+    // Through a buffer for any output stream
+    template<typename Stream>
+    static const Ch* TranscodeUnescapedString(const Ch* p, const Ch* end, Stream& os) {
+        while (p != end) {
+            char buffer[3 * 64];
+            char* q = buffer;
+            const Ch* chunkEnd = end - p > 64 ? p + 64 : end;
+            const Ch* stop = internal::TranscodeUTF16ToUTF8(p, chunkEnd, q);
+            for (const char* b = buffer; b != q; ++b)
+                PutUnsafe(os, static_cast<typename Stream::Ch>(*b));
+            p = stop;
+            if (stop != chunkEnd)
+                break;
+        }
+        return p;
+    }
+
+    // Directly into a string buffer, within the space reserved by WriteString()
+    template<typename StreamAllocator>
+    static const Ch* TranscodeUnescapedString(const Ch* p, const Ch* end, GenericStringBuffer<UTF8<char>, StreamAllocator>& os) {
+        const size_t capacity = 3 * static_cast<size_t>(end - p);
+        char* begin = os.PushUnsafe(capacity);
+        char* q = begin;
+        p = internal::TranscodeUTF16ToUTF8(p, end, q);
+        os.Pop(capacity - static_cast<size_t>(q - begin));
+        return p;
+    }
+
     bool WriteStartObject() { os_->Put('{'); return true; }
     bool WriteEndObject()   { os_->Put('}'); return true; }
     bool WriteStartArray()  { os_->Put('['); return true; }
@@ -569,7 +612,44 @@ inline bool Writer<StringBuffer>::WriteDouble(double d) {
     return true;
 }
 
-#if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
+#if defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_AVX512)
+template<>
+inline bool Writer<StringBuffer>::ScanWriteUnescapedString(StringStream& is, size_t length) {
+    if (length < internal::kSimdBlockSize)
+        return RAPIDJSON_LIKELY(is.Tell() < length);
+
+    if (!RAPIDJSON_LIKELY(is.Tell() < length))
+        return false;
+
+    const char* p = is.src_;
+    const char* end = is.head_ + length;
+
+    // The whole string is known to be in bounds, so unaligned blocks are safe up to end.
+    for (; end - p >= static_cast<ptrdiff_t>(internal::kSimdBlockSize); p += internal::kSimdBlockSize) {
+        const internal::SimdMask r = internal::SimdStringSpecialMask(p);
+        if (RAPIDJSON_UNLIKELY(r != 0)) {   // some of characters is escaped
+            const size_t len = internal::SimdFirstSet(r);
+            std::memcpy(os_->PushUnsafe(len), p, len);
+            p += len;
+            is.src_ = p;
+            return RAPIDJSON_LIKELY(is.Tell() < length);
+        }
+        std::memcpy(os_->PushUnsafe(internal::kSimdBlockSize), p, internal::kSimdBlockSize);
+    }
+
+    // The tail using one block ending at end, ignoring the bytes already written
+    if (p != end) {
+        const char* block = end - internal::kSimdBlockSize;
+        const internal::SimdMask r = internal::SimdStringSpecialMask(block) >> (p - block);
+        const size_t len = r != 0 ? internal::SimdFirstSet(r) : static_cast<size_t>(end - p);
+        std::memcpy(os_->PushUnsafe(len), p, len);
+        p += len;
+    }
+
+    is.src_ = p;
+    return RAPIDJSON_LIKELY(is.Tell() < length);
+}
+#elif defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
 template<>
 inline bool Writer<StringBuffer>::ScanWriteUnescapedString(StringStream& is, size_t length) {
     if (length < 16)